@@ -0,0 +1,209 @@
+/**
+ * \file
+ * \brief   Measurement acquisition source file.
+ *
+ * Samples the voltage and current ADC channels in the background. The
+ * acquisition runs in the SysTick interrupt, alternates between the
+ * channels, waits for the analog mux to settle and passes the samples
+ * of each channel through a configurable filter (boxcar, CIC or
+ * exponential, see settings.filterType/filterShift). load_update()
+ * only picks up the latest filter outputs.
+ *
+ * With HAL_DUAL_ADC both channels are converted in the same SPI burst
+ * and the mux stays on the current channel.
+ */
+#include "acquisition.h"
+
+static RAMFUNC void acq_ResetBlock(struct acqChannel *c) {
+    c->nsamples = 0;
+    c->min = UINT16_MAX;
+    c->max = 0;
+}
+
+static RAMFUNC void acq_AddSample(struct acqChannel *c, uint16_t adc) {
+    c->nsamples++;
+    if (adc > c->max)
+        c->max = adc;
+    if (adc < c->min)
+        c->min = adc;
+    if (c->nsamples >= ACQ_BLOCK_SAMPLES) {
+        hal_CheckADCStability(c->min, c->max);
+        c->blocks++;
+        acq_ResetBlock(c);
+    }
+    // only the boxcar filter runs from RAM, the samples of the other
+    // filters are dropped while a flash operation is in progress
+    if (acq.filterType != ACQ_FILTER_BOXCAR && hal_FlashBusy())
+        return;
+    acq_Filter(&c->filter, acq.filterType, acq.filterShift, adc);
+}
+
+/**
+ * \brief Takes over the filter configuration from the settings
+ *
+ * Clears the filter states, the last results remain valid until the
+ * filters produce new outputs.
+ */
+static FLASHFUNC void acq_Configure(void) {
+    uint8_t i;
+    if (settings.filterType >= ACQ_NUM_FILTERS)
+        settings.filterType = ACQ_FILTER_BOXCAR;
+    if (settings.filterShift > ACQ_MAX_FILTER_SHIFT)
+        settings.filterShift = ACQ_MAX_FILTER_SHIFT;
+    acq.filterType = settings.filterType;
+    acq.filterShift = settings.filterShift;
+    for (i = 0; i < ACQ_NUM_CHANNELS; i++)
+        acq_ResetFilter(&acq.ch[i].filter);
+    // stay on a channel until the decimating filters produced an
+    // output, short filters switch more often and thus have less latency
+    acq.visitLength = ACQ_BLOCK_SAMPLES;
+    if (acq.filterType != ACQ_FILTER_EXP
+            && (1 << acq.filterShift) < ACQ_BLOCK_SAMPLES) {
+        acq.visitLength = 1 << acq.filterShift;
+        if (acq.visitLength < ACQ_STEP_SAMPLES)
+            acq.visitLength = ACQ_STEP_SAMPLES;
+    }
+}
+
+void acq_Init(void) {
+    uint8_t i;
+    for (i = 0; i < ACQ_NUM_CHANNELS; i++) {
+        acq_ResetBlock(&acq.ch[i]);
+        acq.ch[i].blocks = 0;
+        acq.ch[i].filter.result = 0;
+    }
+    acq_Configure();
+#ifdef HAL_DUAL_ADC
+    // the ADC on DOUT1 always measures the current
+    acq.channel = HAL_ADC_CURRENT;
+#else
+    acq.channel = HAL_ADC_VOLTAGE;
+#endif
+    acq.step = 0;
+    acq.visitSamples = 0;
+    timer_SetupSysTickFunction(ACQ_PERIOD_US * 72, acq_Update, ACQ_PRIORITY);
+}
+
+RAMFUNC void acq_Update(void) {
+    uint8_t i;
+    // a change of the filter is applied once the flash is idle
+    if ((settings.filterType != acq.filterType
+            || settings.filterShift != acq.filterShift) && !hal_FlashBusy()) {
+        acq_Configure();
+    }
+    if (load.disableIOcontrol) {
+        // somebody else is using the analog board, restart with
+        // a mux switch once they are done
+        for (i = 0; i < ACQ_NUM_CHANNELS; i++)
+            acq_ResetBlock(&acq.ch[i]);
+        acq.step = 0;
+        acq.visitSamples = 0;
+        return;
+    }
+    if (acq.step == 0) {
+        hal_SelectADCChannel(acq.channel);
+        hal_UpdateAVRGPIOs();
+    }
+    if (acq.step < ACQ_SETTLE_STEPS) {
+        acq.step++;
+        return;
+    }
+#ifdef HAL_DUAL_ADC
+    // both channels are converted in the same burst, the filter
+    // outputs belong to the same points in time
+    for (i = 0; i < ACQ_STEP_SAMPLES; i++) {
+        uint16_t adc[ACQ_NUM_CHANNELS];
+        hal_ConvertADCDual(adc);
+        acq_AddSample(&acq.ch[HAL_ADC_CURRENT], adc[HAL_ADC_CURRENT]);
+        acq_AddSample(&acq.ch[HAL_ADC_VOLTAGE], adc[HAL_ADC_VOLTAGE]);
+    }
+#else
+    struct acqChannel *c = &acq.ch[acq.channel];
+    for (i = 0; i < ACQ_STEP_SAMPLES; i++) {
+        acq_AddSample(c, hal_ConvertADC());
+    }
+    acq.visitSamples += ACQ_STEP_SAMPLES;
+    if (acq.visitSamples >= acq.visitLength) {
+        // continue with the other channel
+        acq.channel ^= 1;
+        acq.step = 0;
+        acq.visitSamples = 0;
+    }
+#endif
+}
+
+void acq_ResetFilter(struct acqFilter *f) {
+    f->sum = 0;
+    f->integrator = 0;
+    f->comb[0] = 0;
+    f->comb[1] = 0;
+    f->nsamples = 0;
+    f->outputs = 0;
+    // the exponential filter continues from the last result
+    f->exp = f->result << (ACQ_EXP_BITS - ACQ_FRACTION_BITS);
+}
+
+/**
+ * \brief Applies the CIC or the exponential filter
+ *
+ * Runs from flash, see acq_Filter.
+ */
+static FLASHFUNC uint8_t acq_FilterFlash(struct acqFilter *f, uint8_t type,
+        uint8_t shift, uint16_t adc) {
+    switch (type) {
+    case ACQ_FILTER_CIC: {
+        // the integrators may wrap, the combs restore the difference
+        // as long as it fits into 32 bits (2^(2 * shift) * 2^16)
+        f->sum += adc;
+        f->integrator += f->sum;
+        if (++f->nsamples < (1 << shift))
+            return 0;
+        uint32_t comb1 = f->integrator - f->comb[0];
+        f->comb[0] = f->integrator;
+        uint32_t comb2 = comb1 - f->comb[1];
+        f->comb[1] = comb1;
+        f->nsamples = 0;
+        if (!f->outputs++) {
+            // comb delays are not filled yet
+            return 0;
+        }
+        // the gain of the CIC is 2^(2 * shift)
+        if (2 * shift >= ACQ_FRACTION_BITS)
+            f->result = comb2 >> (2 * shift - ACQ_FRACTION_BITS);
+        else
+            f->result = comb2 << (ACQ_FRACTION_BITS - 2 * shift);
+        return 1;
+    }
+    case ACQ_FILTER_EXP:
+        f->exp += ((int32_t) ((uint32_t) adc << ACQ_EXP_BITS)
+                - (int32_t) f->exp) >> shift;
+        f->result = f->exp >> (ACQ_EXP_BITS - ACQ_FRACTION_BITS);
+        break;
+    default:
+        return 0;
+    }
+    f->outputs++;
+    return 1;
+}
+
+RAMFUNC uint8_t acq_Filter(struct acqFilter *f, uint8_t type, uint8_t shift,
+        uint16_t adc) {
+    if (type != ACQ_FILTER_BOXCAR)
+        return acq_FilterFlash(f, type, shift, adc);
+    f->sum += adc;
+    if (++f->nsamples < (1 << shift))
+        return 0;
+    f->result = (f->sum << ACQ_FRACTION_BITS) >> shift;
+    f->sum = 0;
+    f->nsamples = 0;
+    f->outputs++;
+    return 1;
+}
+
+RAMFUNC uint16_t acq_GetResult(uint8_t channel) {
+    return acq.ch[channel].filter.result >> ACQ_FRACTION_BITS;
+}
+
+RAMFUNC uint32_t acq_GetResultFraction(uint8_t channel) {
+    return acq.ch[channel].filter.result;
+}
@@ -0,0 +1,150 @@
+/**
+ * \file
+ * \brief   Measurement acquisition header file.
+ *
+ * Samples the voltage and current ADC channels in the background. The
+ * acquisition runs in the SysTick interrupt, alternates between the
+ * channels, waits for the analog mux to settle and passes the samples
+ * of each channel through a configurable filter (boxcar, CIC or
+ * exponential, see settings.filterType/filterShift). load_update()
+ * only picks up the latest filter outputs.
+ *
+ * With HAL_DUAL_ADC both channels are converted in the same SPI burst
+ * and the mux stays on the current channel.
+ */
+#ifndef ACQUISITION_H_
+#define ACQUISITION_H_
+
+#include <stdint.h>
+#include "currentSink.h"
+#include "timer.h"
+#include "loadFunctions.h"
+
+// time between two acquisition steps in us
+#define ACQ_PERIOD_US           50
+// steps after a channel switch before the first conversion
+// (the mux needs about 10us to settle)
+#define ACQ_SETTLE_STEPS        1
+// conversions per step
+#define ACQ_STEP_SAMPLES        2
+// maximum number of conversions before switching to the other channel
+// and number of conversions per ADC stability check
+#define ACQ_BLOCK_SAMPLES       16
+
+// must have the same priority as load_update() (timer 2), both use
+// the SPI lines to the analog board and must not interrupt each other
+#define ACQ_PRIORITY            4
+
+#define ACQ_NUM_CHANNELS        2
+
+// filter types
+// average of 2^shift samples, one output per 2^shift samples
+#define ACQ_FILTER_BOXCAR       0
+// second order CIC decimating by 2^shift (triangular weighting over
+// 2 * 2^shift samples, better suppression of the noise)
+#define ACQ_FILTER_CIC          1
+// exponential moving average with time constant 2^shift samples,
+// one output per sample
+#define ACQ_FILTER_EXP          2
+#define ACQ_NUM_FILTERS         3
+
+#define ACQ_MAX_FILTER_SHIFT    8
+
+// fractional bits of the filter outputs (kept through the calibration)
+#define ACQ_FRACTION_BITS       4
+// fractional bits of the exponential filter state
+#define ACQ_EXP_BITS            12
+
+struct acqFilter {
+    // boxcar sum resp. first CIC integrator
+    uint32_t sum;
+    // second CIC integrator
+    uint32_t integrator;
+    // CIC comb delays
+    uint32_t comb[2];
+    // exponential filter state with ACQ_EXP_BITS fractional bits
+    uint32_t exp;
+    // samples since the last output
+    uint16_t nsamples;
+    // last output with ACQ_FRACTION_BITS fractional bits
+    uint32_t result;
+    // number of outputs
+    uint32_t outputs;
+};
+
+struct acqChannel {
+    struct acqFilter filter;
+    // running ADC stability check
+    uint16_t nsamples;
+    uint16_t min, max;
+    // number of completed stability checks
+    uint32_t blocks;
+};
+
+struct {
+    // channel that is currently sampled (HAL_ADC_CURRENT/HAL_ADC_VOLTAGE)
+    uint8_t channel;
+    // steps since the last channel switch
+    uint8_t step;
+    // conversions since the last channel switch
+    uint8_t visitSamples;
+    // conversions before switching to the other channel
+    uint8_t visitLength;
+    // active filter configuration (copied from settings)
+    uint8_t filterType;
+    uint8_t filterShift;
+    struct acqChannel ch[ACQ_NUM_CHANNELS];
+} acq;
+
+/**
+ * \brief Starts the background acquisition
+ */
+void acq_Init(void);
+
+/**
+ * \brief Performs one acquisition step
+ *
+ * Called from the SysTick interrupt every ACQ_PERIOD_US.
+ */
+void acq_Update(void);
+
+/**
+ * \brief Clears the state of a filter
+ *
+ * \param f Filter to clear
+ */
+void acq_ResetFilter(struct acqFilter *f);
+
+/**
+ * \brief Feeds one sample into a filter
+ *
+ * Only the boxcar filter runs from RAM, the others must not be used
+ * while the flash is busy.
+ *
+ * \param f Filter
+ * \param type ACQ_FILTER_BOXCAR, ACQ_FILTER_CIC or ACQ_FILTER_EXP
+ * \param shift Filter length (log2)
+ * \param adc Raw ADC value
+ * \return 1 if the filter produced a new output, 0 otherwise
+ */
+uint8_t acq_Filter(struct acqFilter *f, uint8_t type, uint8_t shift,
+        uint16_t adc);
+
+/**
+ * \brief Returns the latest filtered ADC value of a channel
+ *
+ * \param channel HAL_ADC_CURRENT or HAL_ADC_VOLTAGE
+ * \return 16-Bit ADC value
+ */
+uint16_t acq_GetResult(uint8_t channel);
+
+/**
+ * \brief Returns the latest filtered ADC value of a channel including
+ * the additional resolution gained by oversampling
+ *
+ * \param channel HAL_ADC_CURRENT or HAL_ADC_VOLTAGE
+ * \return ADC value with ACQ_FRACTION_BITS fractional bits
+ */
+uint32_t acq_GetResultFraction(uint8_t channel);
+
+#endif
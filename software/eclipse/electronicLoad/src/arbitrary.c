@@ -21,7 +21,7 @@ void arb_Init(void) {
     arbitrary.points[0].value = 0;
 }
 
-int32_t arb_getValue(uint32_t time) {
+RAMFUNC int32_t arb_getValue(uint32_t time) {
     int32_t value;
     uint8_t i;
     for (i = 0; i < arbitrary.numPoints; i++) {
@@ -81,7 +81,7 @@ int32_t arb_getValue(uint32_t time) {
     return value;
 }
 
-void arb_Update(void) {
+RAMFUNC void arb_Update(void) {
     if (arbitrary.status == ARB_ARMED && load.powerOn) {
         // load turned on, trigger arbitrary sequence
         arbitrary.time = 0;
@@ -162,7 +162,7 @@ void arb_Menu(void) {
                     // This works correctly because load.mode and paramNum
                     // are using the same coding for the 4 different
                     // modes/parameters
-                    load.mode = arbitrary.paramNum;
+                    load_setMode(arbitrary.paramNum);
                 }
             }
         }
@@ -336,6 +336,7 @@ void arb_editSequence(void) {
                 break;
             }
         }
+        screen_Commit();
 
         do {
             button = hal_getButton();
@@ -7,6 +7,19 @@
  */
 #include "calibration.h"
 
+// default calibration tables, used without calibration data
+static const int32_t cal_defaultCurrentSet[2][2] = { { 0, 0 },
+        { 65536, 204088 } };
+static const int32_t cal_defaultCurrentSense[2][2] = { { 0, 0 },
+        { 65536, 217212 } };
+// 4.096V/(3.9V/100V), for setting and sensing
+static const int32_t cal_defaultVoltage[2][2] = { { 0, 0 },
+        { 65536, 105025641 } };
+static const int32_t cal_defaultPowerSet[2][2] = { { 0, 0 },
+        { 65536, 2038557 } };
+static const int32_t cal_defaultConductanceSet[2][2] = { { 0, 0 },
+        { 65536, 199680 } };
+
 /**
  * \brief Transfers the calibration values from the end of the FLASH
  *
@@ -27,6 +40,7 @@ uint8_t cal_readFromFlash(void) {
             to++;
             from++;
         }
+        cal_UpdateCoefficients();
         cal.active = 0;
         return 0;
     }
@@ -43,25 +57,25 @@ void cal_writeToFlash(void) {
     FLASH_Unlock();
     FLASH_ClearFlag(
     FLASH_FLAG_BSY | FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
-    FLASH_ErasePage(0x0807F000);
+    hal_FlashErasePage(0x0807F000);
     if (sizeof(calData) >= 0x400)
-        FLASH_ErasePage(0x0807F400);
+        hal_FlashErasePage(0x0807F400);
     if (sizeof(calData) >= 0x800)
-        FLASH_ErasePage(0x0807F800);
+        hal_FlashErasePage(0x0807F800);
     if (sizeof(calData) >= 0xC00)
-        FLASH_ErasePage(0x0807FC00);
+        hal_FlashErasePage(0x0807FC00);
     // FLASH is ready to be written at this point
     uint8_t i;
     uint32_t *from = (uint32_t*) &calData;
     uint32_t *to = (uint32_t*) FLASH_CALIBRATION_DATA;
     uint8_t words = (sizeof(calData) + 3) / 4;
     for (i = 0; i < words; i++) {
-        FLASH_ProgramWord((uint32_t) to, *from);
+        hal_FlashProgramWord((uint32_t) to, *from);
         to++;
         from++;
     }
     // set valid data indicator
-    FLASH_ProgramWord((uint32_t) FLASH_VALID_CALIB_INDICATOR, CAL_INDICATOR);
+    hal_FlashProgramWord((uint32_t) FLASH_VALID_CALIB_INDICATOR, CAL_INDICATOR);
     FLASH_Lock();
     cal.unsavedData = 0;
 }
@@ -107,6 +121,7 @@ int32_t cal_GetRealValue(uint8_t unit, int32_t approxValue) {
         screen_Text6x8("Actual value deviates from expected value."
                 " Calibration might be off.", 0, 2);
         screen_SetSoftButton("OK", 2);
+        screen_Commit();
         while (!(hal_getButton() & HAL_BUTTON_SOFT2))
             ;
         while (hal_getButton())
@@ -122,6 +137,7 @@ int32_t cal_sampleMeter(uint8_t samples) {
     int32_t lastData = INT32_MIN;
     screen_Clear();
     screen_FastString6x8("Sampling meter...", 0, 0);
+    screen_Commit();
     do {
         // wait for new data from meter
         while (meter.timeout == lastTimeout) {
@@ -157,6 +173,7 @@ int32_t cal_sampleMeter(uint8_t samples) {
     } while (!meterStable);
     screen_FastString6x8("Meter stabilized.", 0, 1);
     screen_FastString6x8("Taking samples...", 0, 2);
+    screen_Commit();
 // meter has stabilized
 // -> sample values
     int32_t valueSum = meter.value;
@@ -182,6 +199,7 @@ int32_t cal_sampleMeter(uint8_t samples) {
         string_fromUintUnit(valueSum, buf, 5, 6, 'A');
     }
     screen_FastString12x16(buf, 0, 6);
+    screen_Commit();
     timer_waitms(1500);
     return valueSum;
 }
@@ -202,42 +220,108 @@ int32_t cal_sampleADC(uint16_t samples, uint16_t *ADCdata) {
  * Should be used in case of missing calibration data.
  */
 void cal_setDefaultCalibration(void) {
-    calData.currentSetTable[0][0] = 0;
-    calData.currentSetTable[0][1] = 0;
-    calData.currentSetTable[1][0] = 65536;
-    calData.currentSetTable[1][1] = 204088;
-
-    calData.currentSenseTable[0][0] = 0;
-    calData.currentSenseTable[0][1] = 0;
-    calData.currentSenseTable[1][0] = 65536;
-    calData.currentSenseTable[1][1] = 217212;
-
-    calData.voltageSetTable[0][0] = 0;
-    calData.voltageSetTable[0][1] = 0;
-    calData.voltageSetTable[1][0] = 65536;
-    calData.voltageSetTable[1][1] = 105025641; //4.096V/(3.9V/100V)
-
-    calData.voltageSenseTable[0][0] = 0;
-    calData.voltageSenseTable[0][1] = 0;
-    calData.voltageSenseTable[1][0] = 65536;
-    calData.voltageSenseTable[1][1] = 105025641; //4.096V/(3.9V/100V)
-
-    calData.powerSetTable[0][0] = 0;
-    calData.powerSetTable[0][1] = 0;
-    calData.powerSetTable[1][0] = 65536;
-    calData.powerSetTable[1][1] = 2038557;
-
-    calData.conductanceSetTable[0][0] = 0;
-    calData.conductanceSetTable[0][1] = 0;
-    calData.conductanceSetTable[1][0] = 65536;
-    calData.conductanceSetTable[1][1] = 199680;
+    memcpy(calData.currentSetTable, cal_defaultCurrentSet,
+            sizeof(calData.currentSetTable));
+    memcpy(calData.currentSenseTable, cal_defaultCurrentSense,
+            sizeof(calData.currentSenseTable));
+    memcpy(calData.voltageSetTable, cal_defaultVoltage,
+            sizeof(calData.voltageSetTable));
+    memcpy(calData.voltageSenseTable, cal_defaultVoltage,
+            sizeof(calData.voltageSenseTable));
+    memcpy(calData.powerSetTable, cal_defaultPowerSet,
+            sizeof(calData.powerSetTable));
+    memcpy(calData.conductanceSetTable, cal_defaultConductanceSet,
+            sizeof(calData.conductanceSetTable));
 
     calData.shuntFactor = 10000;
+    cal_UpdateCoefficients();
     cal.unsavedData = 0;
 }
 
+/**
+ * \brief Replaces a calibration table whose points are not distinct
+ *
+ * Equal points (erased or corrupt flash, a failed calibration) have no
+ * slope, cal_PrepareTable() would divide by zero.
+ *
+ * \param table Calibration table to check
+ * \param defaults Default values of this table
+ */
+static void cal_CheckTable(int32_t table[2][2], const int32_t defaults[2][2]) {
+    if (table[0][0] == table[1][0] || table[0][1] == table[1][1])
+        memcpy(table, defaults, 2 * sizeof(defaults[0]));
+}
+
+/**
+ * \brief Prepares the mapping of one column of a calibration table
+ * to the other column
+ *
+ * \param m Coefficients to calculate
+ * \param table Calibration table
+ * \param from Column of the input value
+ * \param inputScale Factor applied to the value before the mapping
+ * \param outputScale Factor applied to the result of the mapping
+ */
+static void cal_PrepareTable(struct mapCoefficients *m, int32_t table[2][2],
+        uint8_t from, double inputScale, double outputScale) {
+    uint8_t to = !from;
+    double slope = (double) (table[1][to] - table[0][to])
+            / (table[1][from] - table[0][from]);
+    double offset = table[0][to] - slope * table[0][from];
+    common_PrepareMap(m, slope * inputScale * outputScale,
+            offset * outputScale);
+}
+
+void cal_UpdateCoefficients(void) {
+    // calculate into a local copy, the coefficients are used by
+    // load_update() and must be replaced at once
+    struct mapCoefficients currentSense[2], currentSet[2];
+    struct mapCoefficients voltageSense, voltageSet;
+    struct mapCoefficients powerSet[2], conductanceSet[2];
+    // fall back to the default of tables without a slope
+    cal_CheckTable(calData.currentSenseTable, cal_defaultCurrentSense);
+    cal_CheckTable(calData.currentSetTable, cal_defaultCurrentSet);
+    cal_CheckTable(calData.voltageSenseTable, cal_defaultVoltage);
+    cal_CheckTable(calData.voltageSetTable, cal_defaultVoltage);
+    cal_CheckTable(calData.powerSetTable, cal_defaultPowerSet);
+    cal_CheckTable(calData.conductanceSetTable, cal_defaultConductanceSet);
+    // and of a missing or erased shunt factor
+    if (!calData.shuntFactor || calData.shuntFactor == UINT32_MAX)
+        calData.shuntFactor = 10000;
+    double shunt = calData.shuntFactor / 100.0;
+    // the measurements include ACQ_FRACTION_BITS fractional bits
+    double adcScale = 1.0 / (1 << ACQ_FRACTION_BITS);
+    cal_PrepareTable(&currentSense[0], calData.currentSenseTable, 0, adcScale,
+            1.0);
+    cal_PrepareTable(&currentSense[1], calData.currentSenseTable, 0, adcScale,
+            shunt);
+    cal_PrepareTable(&currentSet[0], calData.currentSetTable, 1, 1.0, 1.0);
+    cal_PrepareTable(&currentSet[1], calData.currentSetTable, 1, 1.0 / shunt,
+            1.0);
+    cal_PrepareTable(&voltageSense, calData.voltageSenseTable, 0, adcScale,
+            1.0);
+    cal_PrepareTable(&voltageSet, calData.voltageSetTable, 1, 1.0, 1.0);
+    // the low shunt scales the sensed current and thus the power and
+    // conductance seen by the analog multiplier
+    cal_PrepareTable(&powerSet[0], calData.powerSetTable, 1, 1.0, 1.0);
+    cal_PrepareTable(&powerSet[1], calData.powerSetTable, 1, 1.0 / shunt, 1.0);
+    cal_PrepareTable(&conductanceSet[0], calData.conductanceSetTable, 1, 1.0,
+            1.0);
+    cal_PrepareTable(&conductanceSet[1], calData.conductanceSetTable, 1,
+            1.0 / shunt, 1.0);
+    __disable_irq();
+    memcpy(calCoeff.currentSense, currentSense, sizeof(currentSense));
+    memcpy(calCoeff.currentSet, currentSet, sizeof(currentSet));
+    calCoeff.voltageSense = voltageSense;
+    calCoeff.voltageSet = voltageSet;
+    memcpy(calCoeff.powerSet, powerSet, sizeof(powerSet));
+    memcpy(calCoeff.conductanceSet, conductanceSet, sizeof(conductanceSet));
+    calCoeff.generation++;
+    __enable_irq();
+}
+
 void calibrationMenu(void) {
-    char *entries[6];
+    char *entries[8];
     uint8_t nentries;
     int8_t sel = 0;
     do {
@@ -250,18 +334,24 @@ void calibrationMenu(void) {
         char voltage[21] = "Voltage Calibration";
         entries[2] = voltage;
 
+        char power[21] = "Power Calibration";
+        entries[3] = power;
+
+        char resistance[21] = "Resist. Calibration";
+        entries[4] = resistance;
+
         char info[21] = "Multimeter info";
-        entries[3] = info;
+        entries[5] = info;
 
         char hardware[21] = "Hardware Cal.";
-        entries[4] = hardware;
+        entries[6] = hardware;
 
         char save[21] = "Save data in Flash";
         if (cal.unsavedData) {
-            entries[5] = save;
-            nentries = 6;
+            entries[7] = save;
+            nentries = 8;
         } else {
-            nentries = 5;
+            nentries = 7;
         }
 
         sel = menu_ItemChooseDialog("\xCD\xCD" "CALIBRATIONS MENU\xCD\xCD",
@@ -277,12 +367,18 @@ void calibrationMenu(void) {
             cal_VoltageCalibration();
             break;
         case 3:
-            calibrationDisplayMultimeterInfo();
+            cal_PowerCalibration();
             break;
         case 4:
-            calibrationProcessHardware();
+            cal_ResistanceCalibration();
             break;
         case 5:
+            calibrationDisplayMultimeterInfo();
+            break;
+        case 6:
+            calibrationProcessHardware();
+            break;
+        case 7:
             cal_writeToFlash();
         }
     } while (sel >= 0);
@@ -307,6 +403,7 @@ void cal_CurrentCalibration(void) {
     screen_SetSoftButton("Abort", 0);
     screen_SetSoftButton("Start", 2);
 
+    screen_Commit();
     do {
         button = hal_getButton();
         if (button & (HAL_BUTTON_SOFT0 | HAL_BUTTON_ESC)) {
@@ -318,14 +415,14 @@ void cal_CurrentCalibration(void) {
         ;
 
     screen_Clear();
-    hal_SelectADCChannel(HAL_ADC_CURRENT);
-    uint32_t i;
 // set DAC to first calibration point
     screen_FastString6x8("Setting to 1mA...", 0, 0);
     load.DACoverride = 321;
+    screen_Commit();
     timer_waitms(100);
     calData.currentSetTable[0][0] = 321;
     screen_FastString6x8("Sampling ADC...", 0, 1);
+    screen_Commit();
     calData.currentSenseTable[0][0] = cal_sampleADC(CAL_ADC_NSAMPLES,
             &cal.rawADCcurrent);
     calData.currentSetTable[0][1] = cal_GetRealValue(CAL_VALUE_CURRENT, 1000);
@@ -334,9 +431,11 @@ void cal_CurrentCalibration(void) {
 // set DAC to second calibration point
     screen_FastString6x8("Setting to 180mA...", 0, 0);
     load.DACoverride = 57800;
+    screen_Commit();
     timer_waitms(100);
     calData.currentSetTable[1][0] = 57800;
     screen_FastString6x8("Sampling ADC...", 0, 1);
+    screen_Commit();
     calData.currentSenseTable[1][0] = cal_sampleADC(CAL_ADC_NSAMPLES,
             &cal.rawADCcurrent);
     calData.currentSetTable[1][1] = cal_GetRealValue(CAL_VALUE_CURRENT, 180000);
@@ -350,6 +449,7 @@ void cal_CurrentCalibration(void) {
     if (calData.currentSenseTable[0][0] >= calData.currentSenseTable[1][0]) {
         cal_DisplayError(CAL_ERROR_ADC_MONOTONIC);
     }
+    cal_UpdateCoefficients();
     cal.unsavedData = 1;
     cal.active = 0;
 }
@@ -373,6 +473,7 @@ void cal_ShuntCalibration(void) {
     screen_SetSoftButton("Abort", 0);
     screen_SetSoftButton("Start", 2);
 
+    screen_Commit();
     do {
         button = hal_getButton();
         if (button & (HAL_BUTTON_SOFT0 | HAL_BUTTON_ESC)) {
@@ -384,8 +485,6 @@ void cal_ShuntCalibration(void) {
         ;
 
     screen_Clear();
-    hal_SelectADCChannel(HAL_ADC_CURRENT);
-    uint32_t i;
 // set DAC to first calibration point
     screen_FastString6x8("Setting to 2mA...", 0, 0);
     int32_t dac = common_Map(2000, calData.currentSetTable[0][1],
@@ -394,12 +493,14 @@ void cal_ShuntCalibration(void) {
     if (dac < 0)
         dac = 0;
     load.DACoverride = dac;
+    screen_Commit();
     timer_waitms(100);
     int32_t currentLow = cal_GetRealValue(CAL_VALUE_CURRENT, 2000);
     screen_Clear();
 // set DAC to second calibration point
     screen_FastString6x8("Setting to 200mA...", 0, 0);
     settings.powerMode = 1;
+    screen_Commit();
     timer_waitms(100);
     int32_t currentHigh = cal_GetRealValue(CAL_VALUE_CURRENT, 200000);
 // set current back to zero
@@ -410,6 +511,7 @@ void cal_ShuntCalibration(void) {
     }
 // calculate factor between the shunts
     calData.shuntFactor = currentHigh * 100 / currentLow;
+    cal_UpdateCoefficients();
     cal.unsavedData = 1;
     settings.powerMode = 0;
     cal.active = 0;
@@ -435,6 +537,7 @@ void cal_VoltageCalibration(void) {
     screen_SetSoftButton("Abort", 0);
     screen_SetSoftButton("Start", 2);
 
+    screen_Commit();
     do {
         button = hal_getButton();
         if (button & (HAL_BUTTON_SOFT0 | HAL_BUTTON_ESC)) {
@@ -446,12 +549,15 @@ void cal_VoltageCalibration(void) {
         ;
 
 // check voltage
-    if (load.state.voltage < 29500000 || load.state.voltage > 32000000) {
+    struct loadSnapshot m;
+    load_GetSnapshot(&m);
+    if (m.voltage < 29500000 || m.voltage > 32000000) {
         screen_Clear();
         screen_FastString12x16("ERROR", 34, 0);
         screen_Text6x8("Incorrect voltage applied."
                 " Check setup and repeat", 0, 2);
         screen_SetSoftButton("OK", 2);
+        screen_Commit();
         while (!(hal_getButton() & HAL_BUTTON_SOFT2))
             ;
         while (hal_getButton())
@@ -464,7 +570,8 @@ void cal_VoltageCalibration(void) {
 // if this is possible, the setup is incorrect
     load.DACoverride = 16055;
     timer_waitms(25);
-    if (load.state.current > 45000) {
+    load_GetSnapshot(&m);
+    if (m.current > 45000) {
         // actual current is more than 45mA
         // -> error in setup
         load.DACoverride = 0;
@@ -473,6 +580,7 @@ void cal_VoltageCalibration(void) {
         screen_Text6x8("Load is able to draw at least 45mA."
                 " Check setup and repeat", 0, 2);
         screen_SetSoftButton("OK", 2);
+        screen_Commit();
         while (!(hal_getButton() & HAL_BUTTON_SOFT2))
             ;
         while (hal_getButton())
@@ -487,8 +595,10 @@ void cal_VoltageCalibration(void) {
     load.DACoverride = 624;
     load.mode = FUNCTION_CV;
     calData.voltageSetTable[0][0] = 624;
+    screen_Commit();
     timer_waitms(500);
     screen_FastString6x8("Sampling ADC...", 0, 0);
+    screen_Commit();
     calData.voltageSenseTable[0][0] = cal_sampleADC(CAL_ADC_NSAMPLES,
             &cal.rawADCvoltage);
     calData.voltageSetTable[0][1] = cal_GetRealValue(CAL_VALUE_VOLTAGE,
@@ -500,8 +610,10 @@ void cal_VoltageCalibration(void) {
     screen_Text6x8("Setting to 29V...", 0, 0);
     load.DACoverride = 18096;
     calData.voltageSetTable[1][0] = 18096;
+    screen_Commit();
     timer_waitms(500);
     screen_FastString6x8("Sampling ADC...", 0, 0);
+    screen_Commit();
     calData.voltageSenseTable[1][0] = cal_sampleADC(CAL_ADC_NSAMPLES,
             &cal.rawADCvoltage);
     calData.voltageSetTable[1][1] = cal_GetRealValue(CAL_VALUE_VOLTAGE,
@@ -519,10 +631,122 @@ void cal_VoltageCalibration(void) {
     if (calData.voltageSenseTable[0][0] >= calData.voltageSenseTable[1][0]) {
         cal_DisplayError(CAL_ERROR_ADC_MONOTONIC);
     }
+    cal_UpdateCoefficients();
     cal.unsavedData = 1;
     cal.active = 0;
 }
 
+/**
+ * \brief Records two calibration points of one of the analog multiplier
+ * modes (CR or CP)
+ *
+ * The real current is taken from the meter/user, the voltage from the
+ * (calibrated) voltage measurement.
+ * \param mode FUNCTION_CR or FUNCTION_CP
+ * \param table Calibration table to fill (DAC value -> conductance in uS
+ * or power in uW)
+ * \param dac DAC values of the two calibration points
+ * \param approxCurrent Expected currents at the two points (at 10V)
+ */
+static void cal_MultiplierCalibration(loadMode_t mode, int32_t table[2][2],
+        const uint16_t dac[2], const int32_t approxCurrent[2]) {
+    uint32_t button;
+    while (hal_getButton())
+        ;
+
+    cal.active = 1;
+    settings.powerMode = 0;
+    load.powerOn = 0;
+    load.DACoverride = 0;
+    load.mode = FUNCTION_CC;
+// show setup
+    screen_Clear();
+    screen_Text6x8("Connect a 10V 300mA"
+            " PSU and the meter in"
+            " series in the mA range.", 0, 0);
+
+    screen_SetSoftButton("Abort", 0);
+    screen_SetSoftButton("Start", 2);
+
+    screen_Commit();
+    do {
+        button = hal_getButton();
+        if (button & (HAL_BUTTON_SOFT0 | HAL_BUTTON_ESC)) {
+            cal.active = 0;
+            return;
+        }
+    } while (!(button & HAL_BUTTON_SOFT2));
+    while (hal_getButton())
+        ;
+
+// check voltage
+    struct loadSnapshot m;
+    load_GetSnapshot(&m);
+    if (m.voltage < 9000000 || m.voltage > 11000000) {
+        screen_Clear();
+        screen_FastString12x16("ERROR", 34, 0);
+        screen_Text6x8("Incorrect voltage applied."
+                " Check setup and repeat", 0, 2);
+        screen_SetSoftButton("OK", 2);
+        screen_Commit();
+        while (!(hal_getButton() & HAL_BUTTON_SOFT2))
+            ;
+        while (hal_getButton())
+            ;
+        cal.active = 0;
+        return;
+    }
+
+    int32_t points[2][2];
+    uint8_t i;
+    load.mode = mode;
+    for (i = 0; i < 2; i++) {
+        screen_Clear();
+        screen_FastString6x8("Setting DAC...", 0, 0);
+        load.DACoverride = dac[i];
+        screen_Commit();
+        timer_waitms(100);
+        int32_t current = cal_GetRealValue(CAL_VALUE_CURRENT,
+                approxCurrent[i]);
+        // voltage at the terminals, excludes the drop across the meter
+        load_GetSnapshot(&m);
+        int32_t voltage = m.voltage;
+        points[i][0] = dac[i];
+        if (mode == FUNCTION_CP) {
+            points[i][1] = ((int64_t) voltage * current) / 1000000;
+        } else {
+            points[i][1] = ((int64_t) current * 1000000) / voltage;
+        }
+    }
+// set current back to zero
+    load.DACoverride = 0;
+    load.mode = FUNCTION_CC;
+// check values for plausibility
+    if (points[0][1] >= points[1][1]) {
+        cal_DisplayError(CAL_ERROR_METER_MONOTONIC);
+    }
+    memcpy(table, points, sizeof(points));
+    cal_UpdateCoefficients();
+    cal.unsavedData = 1;
+    cal.active = 0;
+}
+
+void cal_PowerCalibration(void) {
+    // 10mW and 1.8W
+    const uint16_t dac[2] = { 321, 57870 };
+    const int32_t approxCurrent[2] = { 1000, 180000 };
+    cal_MultiplierCalibration(FUNCTION_CP, calData.powerSetTable, dac,
+            approxCurrent);
+}
+
+void cal_ResistanceCalibration(void) {
+    // 1000uS and 18000uS (1kOhm and 55.6Ohm)
+    const uint16_t dac[2] = { 328, 5907 };
+    const int32_t approxCurrent[2] = { 10000, 180000 };
+    cal_MultiplierCalibration(FUNCTION_CR, calData.conductanceSetTable, dac,
+            approxCurrent);
+}
+
 void cal_DisplayError(uint8_t error) {
     screen_Clear();
     screen_FastString12x16("ERROR", 34, 0);
@@ -543,6 +767,7 @@ void cal_DisplayError(uint8_t error) {
         break;
     }
     screen_SetSoftButton("Retry", 0);
+    screen_Commit();
     while (!(hal_getButton() & HAL_BUTTON_SOFT0))
         ;
     while (hal_getButton())
@@ -573,6 +798,7 @@ void calibrationProcessHardware(void) {
                     " open the top cover.", 0, 0);
             screen_SetSoftButton("Abort", 0);
             screen_SetSoftButton("Next", 2);
+            screen_Commit();
             do {
                 button = hal_getButton();
             } while (!(button & (HAL_BUTTON_SOFT2 | HAL_BUTTON_SOFT0)));
@@ -602,6 +828,7 @@ void calibrationProcessHardware(void) {
             screen_SetSoftButton("Abort", 0);
             screen_SetSoftButton("Prev", 1);
             screen_SetSoftButton("Next", 2);
+            screen_Commit();
             do {
                 button = hal_getButton();
             } while (!(button
@@ -632,6 +859,7 @@ void calibrationProcessHardware(void) {
                     " analogControlBoard.", 0, 0);
             screen_SetSoftButton("Abort", 0);
             screen_SetSoftButton("Next", 2);
+            screen_Commit();
             uint32_t DACtoggle = timer_SetTimeout(10);
             uint16_t DACvalue = 0;
             do {
@@ -678,6 +906,7 @@ void calibrationProcessHardware(void) {
             screen_SetSoftButton("Abort", 0);
             screen_SetSoftButton("Prev", 1);
             screen_SetSoftButton("Next", 2);
+            screen_Commit();
             do {
                 button = hal_getButton();
             } while (!(button
@@ -709,6 +938,7 @@ void calibrationProcessHardware(void) {
             screen_SetSoftButton("Abort", 0);
             screen_SetSoftButton("Prev", 1);
             screen_SetSoftButton("Done", 2);
+            screen_Commit();
             do {
                 button = hal_getButton();
             } while (!(button
@@ -788,6 +1018,7 @@ void calibrationDisplayMultimeterInfo(void) {
             }
             screen_FastString6x8("ESC: Back", 0, 7);
         }
+        screen_Commit();
         timer_waitms(100);
     } while (!(hal_getButton() & HAL_BUTTON_ESC));
 // wait for all buttons to be released
@@ -795,97 +1026,120 @@ void calibrationDisplayMultimeterInfo(void) {
         ;
 }
 
-void cal_setCurrent(uint32_t uA) {
+/**
+ * \brief Sets the DAC to the value cached for a setpoint
+ *
+ * \param function CAL_SETPOINT_CURRENT, _VOLTAGE, _POWER or _RESISTANCE
+ * \param value Setpoint as passed to cal_set*()
+ * \return 1 if the cached value was valid, 0 otherwise
+ */
+static RAMFUNC uint8_t cal_SetpointCached(uint8_t function, uint32_t value) {
+    if (calSetpoint.function != function || calSetpoint.value != value
+            || calSetpoint.powerMode != settings.powerMode
+            || calSetpoint.generation != calCoeff.generation)
+        return 0;
+    hal_setDAC(calSetpoint.dac);
+    return 1;
+}
+
+/**
+ * \brief Limits a calculated DAC value, caches and sets it
+ *
+ * \param function CAL_SETPOINT_CURRENT, _VOLTAGE, _POWER or _RESISTANCE
+ * \param value Setpoint as passed to cal_set*()
+ * \param dac Calculated DAC value
+ */
+static RAMFUNC void cal_SetpointUpdate(uint8_t function, uint32_t value,
+        int32_t dac) {
+    if (dac < 0)
+        dac = 0;
+    else if (dac > HAL_DAC_MAX)
+        dac = HAL_DAC_MAX;
+    calSetpoint.function = function;
+    calSetpoint.powerMode = settings.powerMode;
+    calSetpoint.value = value;
+    calSetpoint.generation = calCoeff.generation;
+    calSetpoint.dac = dac;
+    hal_setDAC(dac);
+}
+
+RAMFUNC uint16_t cal_CurrentToDAC(uint32_t uA) {
     if (uA > settings.maxCurrent[settings.powerMode]) {
         uA = settings.maxCurrent[settings.powerMode];
     }
-    if (settings.powerMode) {
-        // low shunt active (high power mode)
-        uA = ((int64_t) uA * 100) / calData.shuntFactor;
-    }
-    int32_t dac = common_Map(uA, calData.currentSetTable[0][1],
-            calData.currentSetTable[1][1], calData.currentSetTable[0][0],
-            calData.currentSetTable[1][0]);
+    // coefficients of the high power mode include the shunt factor
+    int32_t dac = common_MapFast(&calCoeff.currentSet[settings.powerMode], uA);
     if (dac < 0)
         dac = 0;
     else if (dac > HAL_DAC_MAX)
         dac = HAL_DAC_MAX;
-    hal_setDAC(dac);
+    return dac;
 }
 
-void cal_setVoltage(uint32_t uV) {
+RAMFUNC void cal_setCurrent(uint32_t uA) {
+    if (cal_SetpointCached(CAL_SETPOINT_CURRENT, uA))
+        return;
+    cal_SetpointUpdate(CAL_SETPOINT_CURRENT, uA, cal_CurrentToDAC(uA));
+}
+
+RAMFUNC void cal_setVoltage(uint32_t uV) {
+    if (cal_SetpointCached(CAL_SETPOINT_VOLTAGE, uV))
+        return;
+    uint32_t value = uV;
     if (uV > settings.maxVoltage[settings.powerMode]) {
         uV = settings.maxVoltage[settings.powerMode];
     } else if (uV < settings.minVoltage[settings.powerMode]) {
         uV = settings.minVoltage[settings.powerMode];
     }
 
-    int32_t dac = common_Map(uV, calData.voltageSetTable[0][1],
-            calData.voltageSetTable[1][1], calData.voltageSetTable[0][0],
-            calData.voltageSetTable[1][0]);
-    if (dac < 0)
-        dac = 0;
-    else if (dac > HAL_DAC_MAX)
-        dac = HAL_DAC_MAX;
-    hal_setDAC(dac);
+    int32_t dac = common_MapFast(&calCoeff.voltageSet, uV);
+    cal_SetpointUpdate(CAL_SETPOINT_VOLTAGE, value, dac);
 }
 
-//void cal_setPower(uint32_t uW) {
-//    if (uW > settings.maxPower[settings.powerMode]) {
-//        uW = settings.maxPower[settings.powerMode];
-//    }
-//    if (settings.powerMode) {
-//        // low shunt active (high power mode)
-//        uW = ((int64_t) uW * 100) / calData.shuntFactor;
-//    }
-//    int32_t dac = common_Map(uW, calData.powerSetTable[0][1],
-//            calData.powerSetTable[1][1], calData.powerSetTable[0][0],
-//            calData.powerSetTable[1][0]);
-//    if (dac < 0)
-//        dac = 0;
-//    else if (dac > HAL_DAC_MAX)
-//        dac = HAL_DAC_MAX;
-//    hal_setDAC(dac);
-//}
-//
-//void cal_setResistance(uint32_t uR) {
-//    if (uR > settings.maxResistance[settings.powerMode]) {
-//        uR = settings.maxResistance[settings.powerMode];
-//    } else if (uR < settings.minResistance[settings.powerMode]) {
-//        uR = settings.minResistance[settings.powerMode];
-//    }
-//    if (settings.powerMode) {
-//        // low shunt active (high power mode)
-//        uR = ((int64_t) uR * calData.shuntFactor) / 100;
-//    }
-//    // convert resistance in conductance
-//    int32_t uS = ((int64_t) 1000000000LL) / uR;
-//    int32_t dac = common_Map(uS, calData.conductanceSetTable[0][1],
-//            calData.conductanceSetTable[1][1],
-//            calData.conductanceSetTable[0][0],
-//            calData.conductanceSetTable[1][0]);
-//    if (dac < 0)
-//        dac = 0;
-//    else if (dac > HAL_DAC_MAX)
-//        dac = HAL_DAC_MAX;
-//    hal_setDAC(dac);
-//}
+RAMFUNC void cal_setPower(uint32_t uW) {
+    if (cal_SetpointCached(CAL_SETPOINT_POWER, uW))
+        return;
+    uint32_t value = uW;
+    if (uW > settings.maxPower[settings.powerMode]) {
+        uW = settings.maxPower[settings.powerMode];
+    }
+    // coefficients of the high power mode include the shunt factor
+    int32_t dac = common_MapFast(&calCoeff.powerSet[settings.powerMode], uW);
+    cal_SetpointUpdate(CAL_SETPOINT_POWER, value, dac);
+}
+
+RAMFUNC void cal_setResistance(uint32_t mR) {
+    if (cal_SetpointCached(CAL_SETPOINT_RESISTANCE, mR))
+        return;
+    uint32_t value = mR;
+    if (mR > settings.maxResistance[settings.powerMode]) {
+        mR = settings.maxResistance[settings.powerMode];
+    } else if (mR < settings.minResistance[settings.powerMode]) {
+        mR = settings.minResistance[settings.powerMode];
+    }
+    // convert resistance in conductance (uS), fits into 32 bits
+    // and thus uses the hardware divider
+    uint32_t uS = 1000000000UL / mR;
+    // coefficients of the high power mode include the shunt factor
+    int32_t dac = common_MapFast(&calCoeff.conductanceSet[settings.powerMode],
+            uS);
+    cal_SetpointUpdate(CAL_SETPOINT_RESISTANCE, value, dac);
+}
 
 /**
  * \brief Returns the current being drawn
  *
+ * Uses the latest result of the background acquisition, including its
+ * fractional bits.
+ *
  * \return Current in mA
  */
-int32_t cal_getCurrent(void) {
-    hal_SelectADCChannel(HAL_ADC_CURRENT);
-    timer_waitus(10);
-    cal.rawADCcurrent = hal_getADC(16);
-    int32_t current = common_Map(cal.rawADCcurrent,
-            calData.currentSenseTable[0][0], calData.currentSenseTable[1][0],
-            calData.currentSenseTable[0][1], calData.currentSenseTable[1][1]);
-    if (settings.powerMode) {
-        current = ((int64_t) current * calData.shuntFactor) / 100;
-    }
+RAMFUNC int32_t cal_getCurrent(void) {
+    uint32_t adc = acq_GetResultFraction(HAL_ADC_CURRENT);
+    cal.rawADCcurrent = adc >> ACQ_FRACTION_BITS;
+    // coefficients of the high power mode include the shunt factor
+    int32_t current = common_MapFast(
+            &calCoeff.currentSense[settings.powerMode], adc);
     if (current < 0)
         current = 0;
     return current;
@@ -894,15 +1148,15 @@ int32_t cal_getCurrent(void) {
 /**
  * \brief Returns the voltage at the terminals
  *
+ * Uses the latest result of the background acquisition, including its
+ * fractional bits.
+ *
  * \return Voltage in mV
  */
-int32_t cal_getVoltage(void) {
-    hal_SelectADCChannel(HAL_ADC_VOLTAGE);
-    timer_waitus(10);
-    cal.rawADCvoltage = hal_getADC(16);
-    int32_t voltage = common_Map(cal.rawADCvoltage,
-            calData.voltageSenseTable[0][0], calData.voltageSenseTable[1][0],
-            calData.voltageSenseTable[0][1], calData.voltageSenseTable[1][1]);
+RAMFUNC int32_t cal_getVoltage(void) {
+    uint32_t adc = acq_GetResultFraction(HAL_ADC_VOLTAGE);
+    cal.rawADCvoltage = adc >> ACQ_FRACTION_BITS;
+    int32_t voltage = common_MapFast(&calCoeff.voltageSense, adc);
     if (voltage < 0)
         voltage = 0;
     return voltage;
@@ -912,38 +1166,32 @@ int32_t cal_getUncalibVoltage(void) {
 // voltage is provided to ADC at 3.9V/100V
 // reference voltage is 4.096V, ADC resolution is 16bits
 // -> multiplying by 1602 roughly results in uV
-    hal_SelectADCChannel(HAL_ADC_VOLTAGE);
-    timer_waitus(10);
-    return (int32_t) hal_getADC(1) * 1602;
+    return (int32_t) acq_GetResult(HAL_ADC_VOLTAGE) * 1602;
 }
 int32_t cal_getUncalibCurrent(void) {
-    hal_SelectADCChannel(HAL_ADC_CURRENT);
-    timer_waitus(10);
     switch (settings.powerMode) {
     case 0:
         // current is provided to ADC at 2V/100mA
         // reference voltage is 4.096V, ADC resolution is 16bits
         // -> multiplying by 3.1875 roughly results in uV
-        return ((int32_t) hal_getADC(1) * 51) / 16;
+        return ((int32_t) acq_GetResult(HAL_ADC_CURRENT) * 51) / 16;
         break;
     case 1:
         // current is provided to ADC at 2V/10A
         // reference voltage is 4.096V, ADC resolution is 16bits
         // -> multiplying by 318.75 roughly results in uV
-        return ((int32_t) hal_getADC(1) * 1275) / 4;
+        return ((int32_t) acq_GetResult(HAL_ADC_CURRENT) * 1275) / 4;
         break;
     default:
         return 0;
         break;
     }
-    hal_SetControlMode(HAL_MODE_CC);
-    hal_SelectShunt(HAL_SHUNT_1R);
 }
 
-uint8_t cal_getTemp1(void) {
-    return hal_ReadTemperature(HAL_TEMP1);
+RAMFUNC uint8_t cal_getTemp1(void) {
+    return tele_GetValue(TELE_TEMP1);
 }
 
-uint8_t cal_getTemp2(void) {
-    return hal_ReadTemperature(HAL_TEMP2);
+RAMFUNC uint8_t cal_getTemp2(void) {
+    return tele_GetValue(TELE_TEMP2);
 }
@@ -12,6 +12,10 @@
 #include "currentSink.h"
 #include "frontPanel.h"
 #include "multimeter.h"
+#include "acquisition.h"
+#include "telemetry.h"
+#include "flash.h"
+#include "common.h"
 
 #define FLASH_CALIBRATION_DATA      0x0801F004
 #define FLASH_VALID_CALIB_INDICATOR 0x0801F000
@@ -61,6 +65,41 @@ struct {
     uint16_t rawADCvoltage;
 } cal;
 
+/*
+ * Fixed point coefficients derived from calData (see
+ * cal_UpdateCoefficients), the current coefficients are
+ * indexed by settings.powerMode and include the shunt factor
+ */
+struct {
+    struct mapCoefficients currentSense[2];
+    struct mapCoefficients currentSet[2];
+    struct mapCoefficients voltageSense;
+    struct mapCoefficients voltageSet;
+    struct mapCoefficients powerSet[2];
+    struct mapCoefficients conductanceSet[2];
+    // incremented whenever the coefficients change
+    uint32_t generation;
+} calCoeff;
+
+#define CAL_SETPOINT_NONE           0
+#define CAL_SETPOINT_CURRENT        1
+#define CAL_SETPOINT_VOLTAGE        2
+#define CAL_SETPOINT_POWER          3
+#define CAL_SETPOINT_RESISTANCE     4
+
+/*
+ * Last setpoint and the DAC value calculated for it. The cal_set*()
+ * functions only recalculate the DAC value if the setpoint, the power
+ * mode or the coefficients (see calCoeff.generation) have changed
+ */
+struct {
+    uint8_t function;
+    uint8_t powerMode;
+    uint32_t value;
+    uint32_t generation;
+    uint16_t dac;
+} calSetpoint;
+
 
 
 /**
@@ -111,6 +150,13 @@ int32_t cal_sampleMeter(uint8_t samples);
  */
 int32_t cal_sampleADC(uint16_t samples, uint16_t *ADCdata);
 
+/**
+ * \brief Derives the fixed point coefficients from calData
+ *
+ * Must be called whenever calData has changed.
+ */
+void cal_UpdateCoefficients(void);
+
 /**
  * \brief Sets the calibration values to the default values.
  *
@@ -130,10 +176,34 @@ void cal_ShuntCalibration(void);
 
 void cal_VoltageCalibration(void);
 
+/**
+ * \brief Calibrates the analog constant power mode
+ *
+ * Requires a calibrated voltage measurement.
+ */
+void cal_PowerCalibration(void);
+
+/**
+ * \brief Calibrates the analog constant resistance mode
+ *
+ * Requires a calibrated voltage measurement.
+ */
+void cal_ResistanceCalibration(void);
+
 void calibrationProcessHardware(void);
 
 void calibrationDisplayMultimeterInfo(void);
 
+/**
+ * \brief Calculates the DAC value for a current
+ *
+ * Limited to the maximum current of the active power mode.
+ *
+ * \param uA Current the load should draw
+ * \return DAC value
+ */
+uint16_t cal_CurrentToDAC(uint32_t uA);
+
 /**
  * \brief Sets the 'should be'-current
  *
@@ -143,9 +213,19 @@ void cal_setCurrent(uint32_t uA);
 
 void cal_setVoltage(uint32_t uV);
 
-//void cal_setPower(uint32_t uW);
-//
-//void cal_setResistance(uint32_t uR);
+/**
+ * \brief Sets the 'should be'-power of the analog CP mode
+ *
+ * \param uW Power the load should draw
+ */
+void cal_setPower(uint32_t uW);
+
+/**
+ * \brief Sets the 'should be'-resistance of the analog CR mode
+ *
+ * \param mR Resistance in mOhm
+ */
+void cal_setResistance(uint32_t mR);
 
 /**
  * \brief Returns the current being drawn
@@ -37,6 +37,7 @@ void characteristic_Menu(void) {
         // display selected line
         screen_FastChar6x8(0x1A, 0, selectedRow);
 
+        screen_Commit();
         // wait for user input
         do {
             button = hal_getButton();
@@ -127,6 +128,7 @@ void characteristic_Run(void) {
         for (i = 0; i < characteristic.pointCount; i++) {
             screen_VerticalLine(3 + i, 23, 18);
         }
+        screen_Commit();
         timer_waitms(20);
     } while (!(button & HAL_BUTTON_ESC) && characteristic.active);
     // switch off load
@@ -242,6 +244,7 @@ void characteristic_ViewResult(void) {
         string_fromUintUnit(characteristic.voltageResponse[cursorX], value, 4,
                 6, 'V');
         screen_FastString6x8(value, 76, 7);
+        screen_Commit();
         // wait for user input
         do {
             button = hal_getButton();
@@ -1,7 +1,16 @@
 #include "common.h"
 
-int32_t common_Map(int32_t value, int32_t scaleFromLow, int32_t scaleFromHigh,
-        int32_t scaleToLow, int32_t scaleToHigh) {
+// 1/d in Q15 for d in the middle of [0.5 + i/128, 0.5 + (i+1)/128)
+static const uint16_t common_reciprocalTable[64] = { 65028, 64035, 63072, 62138,
+        61231, 60350, 59494, 58662, 57852, 57065, 56299, 55554, 54828, 54120,
+        53431, 52759, 52103, 51464, 50840, 50231, 49637, 49056, 48489, 47935,
+        47393, 46864, 46346, 45839, 45344, 44859, 44384, 43919, 43464, 43019,
+        42582, 42154, 41734, 41323, 40920, 40525, 40137, 39756, 39383, 39017,
+        38657, 38304, 37958, 37617, 37283, 36954, 36631, 36314, 36003, 35696,
+        35395, 35099, 34808, 34521, 34239, 33962, 33689, 33421, 33157, 32897 };
+
+RAMFUNC int32_t common_Map(int32_t value, int32_t scaleFromLow,
+        int32_t scaleFromHigh, int32_t scaleToLow, int32_t scaleToHigh) {
     int32_t result;
     value -= scaleFromLow;
     int32_t rangeFrom = scaleFromHigh - scaleFromLow;
@@ -10,3 +19,67 @@ int32_t common_Map(int32_t value, int32_t scaleFromLow, int32_t scaleFromHigh,
     result += scaleToLow;
     return result;
 }
+
+void common_PrepareMap(struct mapCoefficients *m, double slope, double offset) {
+    double absSlope = slope < 0 ? -slope : slope;
+    double absOffset = offset < 0 ? -offset : offset;
+    double scale = 1.0;
+    uint8_t shift = 0;
+    // keep the multiplier below 2^30 and the added offset below 2^60,
+    // value * mult + add can't overflow for any 32 bit value then
+    while (shift < 62 && absSlope * scale * 2 < 1073741824.0
+            && absOffset * scale * 2 < 1152921504606846976.0) {
+        scale *= 2;
+        shift++;
+    }
+    double mult = slope * scale;
+    // half an LSB, the shift rounds to nearest instead of truncating
+    double add = (offset + 0.5) * scale;
+    m->mult = mult < 0 ? (int32_t) (mult - 0.5) : (int32_t) (mult + 0.5);
+    m->add = add < 0 ? (int64_t) (add - 0.5) : (int64_t) (add + 0.5);
+    m->shift = shift;
+}
+
+RAMFUNC int32_t common_MapFast(const struct mapCoefficients *m, int32_t value) {
+    return ((int64_t) value * m->mult + m->add) >> m->shift;
+}
+
+FLASHFUNC void common_Reciprocal(struct fixedFactor *f, uint32_t x) {
+    // normalize x to [2^31, 2^32), d = xn / 2^32 is in [0.5, 1)
+    uint8_t n = __builtin_clz(x);
+    uint32_t xn = x << n;
+    // 1/d in Q31, initial guess is accurate to about 2^-7. Each step
+    // squares the error, two steps give 2^-28.
+    int64_t r = (uint32_t) common_reciprocalTable[(xn >> 25) & 0x3F] << 16;
+    uint8_t i;
+    for (i = 0; i < 2; i++) {
+        // r = r * (2 - d * r)
+        int64_t e = (int64_t) ((1ULL << 63) - (uint64_t) xn * r);
+        r += ((e >> 31) * r) >> 32;
+        if (r > UINT32_MAX)
+            r = UINT32_MAX;
+    }
+    f->factor = r;
+    // 1/x = 2^n / xn = r / 2^(63 - n)
+    f->shift = 63 - n;
+}
+
+FLASHFUNC void common_Fraction(struct fixedFactor *f, uint32_t num,
+        uint32_t den) {
+    common_Reciprocal(f, den);
+    uint64_t product = (uint64_t) num * f->factor;
+    // keep the 32 most significant bits
+    uint8_t k = 0;
+    if (product >> 32) {
+        k = 32 - __builtin_clz(product >> 32);
+    }
+    if (k > f->shift)
+        k = f->shift;
+    f->factor = product >> k;
+    f->shift -= k;
+}
+
+RAMFUNC uint32_t common_ApplyFactor(const struct fixedFactor *f,
+        uint32_t value) {
+    return ((uint64_t) value * f->factor) >> f->shift;
+}
@@ -3,7 +3,82 @@
 
 #include <stdint.h>
 
+// Places a function resp. constant data in RAM (see the '.ramfunc'
+// section in the linker script). Everything that runs while the flash
+// is erased or programmed must be in RAM: the control loop, the
+// interrupts up to its priority and all functions and tables they use.
+// All of them end up in one input section per file, --gc-sections does
+// not remove the unused ones.
+#define RAMFUNC __attribute__((section(".ramfunc")))
+#define RAMDATA __attribute__((section(".ramdata")))
+// Keeps a function in flash that RAM functions only call while the flash
+// is idle (see hal_FlashBusy). Prevents it from being inlined into them.
+#define FLASHFUNC __attribute__((noinline))
+
+// precomputed linear mapping: result = (value * mult + add) >> shift
+struct mapCoefficients {
+    int32_t mult;
+    uint8_t shift;
+    int64_t add;
+};
+
+// fixed point factor: result = (value * factor) >> shift
+struct fixedFactor {
+    uint32_t factor;
+    uint8_t shift;
+};
+
 int32_t common_Map(int32_t value, int32_t scaleFromLow, int32_t scaleFromHigh,
         int32_t scaleToLow, int32_t scaleToHigh);
 
+/**
+ * \brief Calculates the coefficients for common_MapFast()
+ *
+ * The mapping approximates result = slope * value + offset, rounded to
+ * the nearest integer. The shift is chosen as large as possible while
+ * the multiplier still fits 31 bits.
+ * Not intended for the hot path (uses floating point).
+ */
+void common_PrepareMap(struct mapCoefficients *m, double slope, double offset);
+
+/**
+ * \brief Fixed point replacement for common_Map()
+ *
+ * \param m Coefficients calculated by common_PrepareMap()
+ * \param value Value to map
+ * \return Mapped value (common_Map() truncates instead of rounding,
+ *         the results might differ by 1)
+ */
+int32_t common_MapFast(const struct mapCoefficients *m, int32_t value);
+
+/**
+ * \brief Approximates the reciprocal of a number without division
+ *
+ * Uses a table for the initial guess and refines it with Newton-Raphson
+ * iterations. 1/x is approximately f->factor / 2^f->shift, the factor is
+ * normalized to [2^31, 2^32). Runs from flash.
+ *
+ * \param f Approximation of 1/x
+ * \param x Number, must not be zero
+ */
+void common_Reciprocal(struct fixedFactor *f, uint32_t x);
+
+/**
+ * \brief Approximates the fraction num/den without division
+ *
+ * Runs from flash.
+ *
+ * \param f Approximation of num/den
+ * \param num Numerator
+ * \param den Denominator, must not be zero
+ */
+void common_Fraction(struct fixedFactor *f, uint32_t num, uint32_t den);
+
+/**
+ * \brief Multiplies a value with a fixed point factor
+ *
+ * The result must fit into 32 bits.
+ */
+uint32_t common_ApplyFactor(const struct fixedFactor *f, uint32_t value);
+
 #endif
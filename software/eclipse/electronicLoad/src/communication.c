@@ -2,10 +2,32 @@
 
 const char com_commands[COM_CMD_NUM][10] =
         { "HELP", "LDOFF", "LDON", "CC", "CV", "CP", "CR", "SETI", "SETU",
-                "SETP", "SETR", "GETU", "GETI", "GETP" };
+                "SETP", "SETR", "GETU", "GETI", "GETP", "PROF", "RSTPROF",
+                "TIMING", "ANALOG", "DIGITAL", "FILTER", "DYN",
+                "SLEW" };
 
-void com_Init(void) {
-    timer_SetupPeriodicFunction(4, MS_TO_TICKS(10), com_Update, 10);
+/**
+ * \brief Sends one line of profiling data
+ *
+ * Format: <name> <min> <max> <avg> <worst>, all values in CPU cycles
+ */
+static void com_writeProfileLine(const char *name, const struct profValue *v,
+        uint32_t worst) {
+    char buf[10];
+    uart_writeString(name);
+    uart_writeByte(' ');
+    string_fromUint(v->nsamples ? v->min : 0, buf, 7, 0);
+    uart_writeString(buf);
+    uart_writeByte(' ');
+    string_fromUint(v->max, buf, 7, 0);
+    uart_writeString(buf);
+    uart_writeByte(' ');
+    string_fromUint(prof_GetAverage(v), buf, 7, 0);
+    uart_writeString(buf);
+    uart_writeByte(' ');
+    string_fromUint(worst, buf, 7, 0);
+    uart_writeString(buf);
+    uart_writeByte('\n');
 }
 
 void com_Update(void) {
@@ -30,6 +52,9 @@ void com_Update(void) {
             uart_writeString(com_commands[cmdnum]);
             uart_writeByte('\n');
             char answer[20];
+            // consistent measurements for the GET commands
+            struct loadSnapshot m;
+            load_GetSnapshot(&m);
             switch (cmdnum) {
             case COM_CMD_HELP:
                 uart_writeString("Available commands:\n");
@@ -45,50 +70,210 @@ void com_Update(void) {
                 load.powerOn = 1;
                 break;
             case COM_CMD_CC:
-                load.mode = FUNCTION_CC;
+                load_setMode(FUNCTION_CC);
                 break;
             case COM_CMD_CV:
-                load.mode = FUNCTION_CV;
+                load_setMode(FUNCTION_CV);
                 break;
             case COM_CMD_CP:
-                load.mode = FUNCTION_CP;
+                load_setMode(FUNCTION_CP);
                 break;
             case COM_CMD_CR:
-                load.mode = FUNCTION_CR;
+                load_setMode(FUNCTION_CR);
                 break;
             case COM_CMD_SET_CURRENT:
-                load.current = strtol(&cmd[4], NULL, 0);
-                break;
             case COM_CMD_SET_VOLTAGE:
-                load.voltage = strtol(&cmd[4], NULL, 0);
-                break;
             case COM_CMD_SET_POWER:
-                load.power = strtol(&cmd[4], NULL, 0);
-                break;
-            case COM_CMD_SET_RESISTANCE:
-                load.resistance = strtol(&cmd[4], NULL, 0);
+            case COM_CMD_SET_RESISTANCE: {
+                // SETI, SETU, SETP and SETR change the value only, the
+                // mode is kept
+                struct loadSetpoint sp;
+                load_GetSetpoint(&sp);
+                int32_t value = string_toInt(&cmd[4]);
+                if (cmdnum == COM_CMD_SET_CURRENT)
+                    sp.current = value;
+                else if (cmdnum == COM_CMD_SET_VOLTAGE)
+                    sp.voltage = value;
+                else if (cmdnum == COM_CMD_SET_POWER)
+                    sp.power = value;
+                else
+                    sp.resistance = value;
+                load_PublishSetpoint(&sp);
+            }
                 break;
             case COM_CMD_GET_VOLTAGE:
-                string_fromUint(load.state.voltage, answer, 9, 6);
+                string_fromUint(m.voltage, answer, 9, 6);
                 answer[9] = 'V';
                 answer[10] = '\n';
                 answer[11] = 0;
                 uart_writeString(answer);
                 break;
             case COM_CMD_GET_CURRENT:
-                string_fromUint(load.state.current, answer, 8, 6);
+                string_fromUint(m.current, answer, 8, 6);
                 answer[8] = 'A';
                 answer[9] = '\n';
                 answer[10] = 0;
                 uart_writeString(answer);
                 break;
             case COM_CMD_GET_POWER:
-                string_fromUint(load.state.power, answer, 10, 6);
+                string_fromUint(m.power, answer, 10, 6);
                 answer[10] = 'W';
                 answer[11] = '\n';
                 answer[12] = 0;
                 uart_writeString(answer);
                 break;
+            case COM_CMD_GET_PROFILE: {
+                struct profData prof;
+                prof_GetData(&prof);
+                uart_writeString("STAGE MIN MAX AVG WORST\n");
+                for (i = 0; i < PROF_STAGE_NUM; i++) {
+                    com_writeProfileLine(prof_stageNames[i], &prof.stage[i],
+                            prof.worstTick[i]);
+                }
+                com_writeProfileLine("TICK", &prof.tick, prof.tick.max);
+                // DAC <written> <skipped> <skipped in %>
+                uint32_t updates = prof.dacWrites + prof.dacSkipped;
+                uart_writeString("DAC ");
+                string_fromUint(prof.dacWrites, answer, 10, 0);
+                uart_writeString(answer);
+                uart_writeByte(' ');
+                string_fromUint(prof.dacSkipped, answer, 10, 0);
+                uart_writeString(answer);
+                uart_writeByte(' ');
+                string_fromUint(
+                        updates ?
+                                (uint64_t) prof.dacSkipped * 1000 / updates : 0,
+                        answer, 4, 1);
+                uart_writeString(answer);
+                uart_writeString("%\n");
+            }
+                break;
+            case COM_CMD_RESET_PROFILE:
+                prof_Reset();
+                break;
+            case COM_CMD_GET_TIMING: {
+                struct profData prof;
+                prof_GetData(&prof);
+                const char descr[5][10] = { "TICKS", "OVERRUNS", "MISSED",
+                        "CONSEC", "JITTERMAX" };
+                const uint32_t values[5] = { prof.timing.ticks,
+                        prof.timing.overruns, prof.timing.missedTicks,
+                        prof.timing.maxConsecutiveMisses,
+                        prof.timing.maxJitter };
+                for (i = 0; i < 5; i++) {
+                    uart_writeString(descr[i]);
+                    uart_writeByte(' ');
+                    string_fromUint(values[i], answer, 10, 0);
+                    uart_writeString(answer);
+                    uart_writeByte('\n');
+                }
+                // jitter histogram, one line per bin: <upper limit> <count>
+                for (i = 0; i < PROF_JITTER_BINS; i++) {
+                    if (i < PROF_JITTER_BINS - 1) {
+                        uart_writeByte('<');
+                        string_fromUint(prof_jitterLimits[i], answer, 3, 0);
+                    } else {
+                        uart_writeString(">=");
+                        string_fromUint(prof_jitterLimits[i - 1], answer, 3, 0);
+                    }
+                    uart_writeString(answer);
+                    uart_writeString("us ");
+                    string_fromUint(prof.timing.jitter[i], answer, 10, 0);
+                    uart_writeString(answer);
+                    uart_writeByte('\n');
+                }
+            }
+                break;
+            case COM_CMD_ANALOG:
+                settings.analogCRCP = 1;
+                break;
+            case COM_CMD_DIGITAL:
+                settings.analogCRCP = 0;
+                break;
+            case COM_CMD_FILTER: {
+                // FILTER<type><length>, type is B(oxcar), C(IC) or E(xp),
+                // e.g. FILTERC64. Answers with the active filter.
+                const char types[ACQ_NUM_FILTERS] = { 'B', 'C', 'E' };
+                for (i = 0; i < ACQ_NUM_FILTERS; i++) {
+                    if (cmd[6] == types[i]) {
+                        uint32_t length = string_toInt(&cmd[7]);
+                        uint8_t shift = 0;
+                        while (shift < ACQ_MAX_FILTER_SHIFT
+                                && (2UL << shift) <= length)
+                            shift++;
+                        settings.filterType = i;
+                        settings.filterShift = shift;
+                    }
+                }
+                uart_writeByte(types[settings.filterType % ACQ_NUM_FILTERS]);
+                string_fromUint(1 << settings.filterShift, answer, 3, 0);
+                uart_writeString(answer);
+                uart_writeByte('\n');
+            }
+                break;
+            case COM_CMD_DYNAMIC: {
+                // DYNON, DYNOFF, DYNRISE<us>, DYNFALL<us> or DYN<p><value>
+                // with p: A, B (currents in uA), F (frequency in Hz) or
+                // D (duty cycle in %), e.g. DYNF5000. Answers with
+                // <ON|OFF> <A> <B> <F> <D> <RISE> <FALL>.
+                const char *arg = (const char*) &cmd[3];
+                if (!strncmp(arg, "ON", 2)) {
+                    dyn.enabled = 1;
+                } else if (!strncmp(arg, "OFF", 3)) {
+                    dyn.enabled = 0;
+                } else if (!strncmp(arg, "RISE", 4)) {
+                    dyn.config.riseTime = string_toInt(&arg[4]);
+                } else if (!strncmp(arg, "FALL", 4)) {
+                    dyn.config.fallTime = string_toInt(&arg[4]);
+                } else if (arg[0] == 'A') {
+                    dyn.config.currentA = string_toInt(&arg[1]);
+                } else if (arg[0] == 'B') {
+                    dyn.config.currentB = string_toInt(&arg[1]);
+                } else if (arg[0] == 'F') {
+                    uint32_t f = string_toInt(&arg[1]);
+                    if (f >= DYN_MIN_FREQUENCY && f <= DYN_MAX_FREQUENCY)
+                        dyn.config.frequency = f;
+                } else if (arg[0] == 'D') {
+                    uint32_t duty = string_toInt(&arg[1]);
+                    if (duty <= 100)
+                        dyn.config.duty = duty;
+                }
+                uart_writeString(dyn.enabled ? "ON" : "OFF");
+                const uint32_t values[6] = { dyn.config.currentA,
+                        dyn.config.currentB, dyn.config.frequency,
+                        dyn.config.duty, dyn.config.riseTime,
+                        dyn.config.fallTime };
+                for (i = 0; i < 6; i++) {
+                    uart_writeByte(' ');
+                    string_fromUint(values[i], answer, 10, 0);
+                    uart_writeString(answer);
+                }
+                uart_writeByte('\n');
+            }
+                break;
+            case COM_CMD_SLEW: {
+                // SLEW<m><rate> with m: C (uA/ms), V (uV/ms), R (mOhm/ms)
+                // or P (uW/ms), rate 0 disables the limit, e.g. SLEWC1000.
+                // Answers with <C> <V> <R> <P> <setpoint> <target>
+                // <progress in %>.
+                const char modes[4] = { 'C', 'V', 'R', 'P' };
+                for (i = 0; i < 4; i++) {
+                    if (cmd[4] == modes[i])
+                        settings.slewRate[i] = string_toInt(&cmd[5]);
+                }
+                const uint32_t values[7] = { settings.slewRate[0],
+                        settings.slewRate[1], settings.slewRate[2],
+                        settings.slewRate[3], slew.value, slew.target,
+                        slew_Progress() };
+                for (i = 0; i < 7; i++) {
+                    if (i)
+                        uart_writeByte(' ');
+                    string_fromUint(values[i], answer, 10, 0);
+                    uart_writeString(answer);
+                }
+                uart_writeByte('\n');
+            }
+                break;
             }
         } else {
             // unknown command
@@ -20,11 +20,22 @@
 #define COM_CMD_GET_VOLTAGE         11
 #define COM_CMD_GET_CURRENT         12
 #define COM_CMD_GET_POWER           13
+#define COM_CMD_GET_PROFILE         14
+#define COM_CMD_RESET_PROFILE       15
+#define COM_CMD_GET_TIMING          16
+#define COM_CMD_ANALOG              17
+#define COM_CMD_DIGITAL             18
+#define COM_CMD_FILTER              19
+#define COM_CMD_DYNAMIC             20
+#define COM_CMD_SLEW                21
 // number of commands, must always be the last define
-#define COM_CMD_NUM                 14
-
-void com_Init(void);
+#define COM_CMD_NUM                 22
 
+/**
+ * \brief Handles received commands
+ *
+ * Called every 10ms from the background timer (see main.c)
+ */
 void com_Update(void);
 
 #endif
@@ -0,0 +1,168 @@
+/**
+ * \file
+ * \brief   Dynamic load source file.
+ *
+ * Switches the set current between two levels at up to
+ * DYN_MAX_FREQUENCY, independent of the 1ms control loop. The DAC
+ * values of one period are calculated in advance by the control loop
+ * (see dyn_BuildTable) and written by the compare interrupt of timer 1.
+ */
+#include "dynamic.h"
+
+/**
+ * \brief Sets the default configuration, dynamic mode is disabled
+ */
+void dyn_Init(void) {
+    dyn_Stop();
+    dyn.enabled = 0;
+    dyn.config.currentA = 100000;
+    dyn.config.currentB = 10000;
+    dyn.config.frequency = 1000;
+    dyn.config.duty = 50;
+    dyn.config.riseTime = 0;
+    dyn.config.fallTime = 0;
+}
+
+/**
+ * \brief Adds the transition to a level and the time at the level
+ *
+ * Steps with the value of the previous step are merged into it.
+ *
+ * \param t Destination
+ * \param from DAC value at the start of the transition
+ * \param to DAC value of the level
+ * \param ramp Duration of the transition in us
+ * \param phase Duration of the transition and the level in us
+ */
+static void dyn_AddPhase(struct dynTable *t, uint16_t from, uint16_t to,
+        uint32_t ramp, uint32_t phase) {
+    if (ramp > phase)
+        ramp = phase;
+    uint32_t n = ramp / DYN_MIN_STEP_US;
+    if (n < 1)
+        n = 1;
+    else if (n > DYN_MAX_STEPS / 2)
+        n = DYN_MAX_STEPS / 2;
+    int32_t delta = (int32_t) to - from;
+    uint32_t j;
+    for (j = 0; j < n; j++) {
+        uint32_t start = ramp * j / n;
+        uint32_t end = (j == n - 1) ? phase : ramp * (j + 1) / n;
+        uint16_t dac = from + delta * (int32_t) (j + 1) / (int32_t) n;
+        if (t->nsteps && t->dac[t->nsteps - 1] == dac) {
+            // small transitions repeat values, don't write them again
+            t->duration[t->nsteps - 1] += end - start;
+            continue;
+        }
+        t->dac[t->nsteps] = dac;
+        t->duration[t->nsteps] = end - start;
+        t->nsteps++;
+    }
+}
+
+FLASHFUNC void dyn_BuildTable(struct dynTable *t, const struct dynConfig *c,
+        uint16_t dacA, uint16_t dacB) {
+    uint32_t frequency = c->frequency;
+    if (frequency < DYN_MIN_FREQUENCY)
+        frequency = DYN_MIN_FREQUENCY;
+    else if (frequency > DYN_MAX_FREQUENCY)
+        frequency = DYN_MAX_FREQUENCY;
+    uint32_t period = 1000000UL / frequency;
+    uint32_t timeA = (uint64_t) period * (c->duty > 100 ? 100 : c->duty)
+            / 100;
+    if (timeA < DYN_MIN_STEP_US)
+        timeA = DYN_MIN_STEP_US;
+    else if (timeA > period - DYN_MIN_STEP_US)
+        timeA = period - DYN_MIN_STEP_US;
+    uint16_t toA = dacA > dacB ? c->riseTime : c->fallTime;
+    uint16_t toB = dacA > dacB ? c->fallTime : c->riseTime;
+    t->nsteps = 0;
+    dyn_AddPhase(t, dacB, dacA, toA, timeA);
+    dyn_AddPhase(t, dacA, dacB, toB, period - timeA);
+}
+
+static RAMFUNC uint8_t dyn_ConfigEqual(const struct dynConfig *a,
+        const struct dynConfig *b) {
+    return a->currentA == b->currentA && a->currentB == b->currentB
+            && a->frequency == b->frequency && a->duty == b->duty
+            && a->riseTime == b->riseTime && a->fallTime == b->fallTime;
+}
+
+/**
+ * \brief Writes the next DAC value
+ *
+ * Called from the compare interrupt of timer 1.
+ *
+ * \return Time in us until the next call, 0 if stopped
+ */
+static RAMFUNC uint32_t dyn_Step(void) {
+    if (!dyn.running)
+        return 0;
+    struct dynTable *t = &dyn.table[dyn.active];
+    hal_setDACDirect(t->dac[dyn.step]);
+    uint32_t us = t->duration[dyn.step];
+    if (++dyn.step >= t->nsteps) {
+        dyn.step = 0;
+        dyn.periods++;
+        if (dyn.switchPending) {
+            dyn.active = !dyn.active;
+            dyn.switchPending = 0;
+        }
+    }
+    return us;
+}
+
+/**
+ * \brief Starts the dynamic mode resp. applies changes
+ *
+ * Called from load_update() every millisecond while the dynamic mode
+ * is active. Changes of the configuration, the calibration and the
+ * power mode take effect at the end of the running period.
+ */
+RAMFUNC void dyn_Update(void) {
+    // the configuration may be changed by the communication
+    struct dynConfig config = dyn.config;
+    if (dyn.running) {
+        if (dyn.switchPending)
+            // the previous change has not been applied yet
+            return;
+        if (dyn_ConfigEqual(&config, &dyn.tableConfig)
+                && dyn.tableGeneration == calCoeff.generation
+                && dyn.tablePowerMode == settings.powerMode)
+            return;
+    }
+    // the table is built from flash, a start or change is deferred until
+    // the flash operation has finished
+    if (hal_FlashBusy())
+        return;
+    uint8_t next = dyn.running ? !dyn.active : 0;
+    dyn_BuildTable(&dyn.table[next], &config,
+            cal_CurrentToDAC(config.currentA),
+            cal_CurrentToDAC(config.currentB));
+    dyn.tableConfig = config;
+    dyn.tableGeneration = calCoeff.generation;
+    dyn.tablePowerMode = settings.powerMode;
+    if (dyn.running) {
+        dyn.switchPending = 1;
+    } else {
+        dyn.active = next;
+        dyn.step = 0;
+        dyn.switchPending = 0;
+        dyn.running = 1;
+        timer_SetupCompareFunction(DYN_START_DELAY_US, dyn_Step, DYN_PRIORITY);
+    }
+}
+
+/**
+ * \brief Stops writing the DAC
+ *
+ * Called from load_update() whenever the dynamic mode is not active.
+ */
+RAMFUNC void dyn_Stop(void) {
+    if (!dyn.running)
+        return;
+    dyn.running = 0;
+    timer_StopCompareFunction();
+    // the DAC holds a value written by the interrupt
+    hal_ForceDACUpdate();
+}
@@ -0,0 +1,110 @@
+/**
+ * \file
+ * \brief   Dynamic load header file.
+ *
+ * Switches the set current between two levels at up to
+ * DYN_MAX_FREQUENCY, independent of the 1ms control loop. The DAC
+ * values of one period are calculated in advance by the control loop
+ * (see dyn_BuildTable) and written by the compare interrupt of timer 1.
+ */
+#ifndef DYNAMIC_H_
+#define DYNAMIC_H_
+
+#include <stdint.h>
+#include "calibration.h"
+#include "settings.h"
+#include "timer.h"
+
+#define DYN_MIN_FREQUENCY       1
+#define DYN_MAX_FREQUENCY       20000
+// shortest time between two DAC writes in us (DAC transfer plus
+// interrupt latency)
+#define DYN_MIN_STEP_US         10
+// DAC writes per period, each transition uses at most half of them
+#define DYN_MAX_STEPS           64
+// time from the start to the first DAC write in us
+#define DYN_START_DELAY_US      20
+// preempts the control loop, see hal_setDACDirect()
+#define DYN_PRIORITY            HAL_DAC_DIRECT_PRIORITY
+
+struct dynConfig {
+    // set current of the two levels in uA
+    uint32_t currentA;
+    uint32_t currentB;
+    // switching frequency in Hz
+    uint32_t frequency;
+    // part of the period at level A in %
+    uint8_t duty;
+    // duration of the transitions to the higher resp. lower current
+    // in us (0: step)
+    uint16_t riseTime;
+    uint16_t fallTime;
+};
+
+// separate arrays, a struct per step would be padded to 8 bytes
+struct dynTable {
+    uint16_t dac[DYN_MAX_STEPS];
+    // time in us until the next step
+    uint32_t duration[DYN_MAX_STEPS];
+    uint8_t nsteps;
+};
+
+struct {
+    struct dynConfig config;
+    // dynamic mode replaces the constant current of the CC mode
+    uint8_t enabled;
+
+    // The control loop builds the tables, the interrupt steps through
+    // table[active] and switches to the other table at the end of a
+    // period if switchPending is set
+    struct dynTable table[2];
+    volatile uint8_t active;
+    volatile uint8_t switchPending;
+    uint8_t step;
+    volatile uint8_t running;
+    // the latest table was built from these
+    struct dynConfig tableConfig;
+    uint32_t tableGeneration;
+    uint8_t tablePowerMode;
+    // completed periods
+    volatile uint32_t periods;
+} dyn;
+
+/**
+ * \brief Sets the default configuration, dynamic mode is disabled
+ */
+void dyn_Init(void);
+
+/**
+ * \brief Calculates the DAC values of one period
+ *
+ * The period starts with the transition to level A. Each transition
+ * is a staircase of at most DYN_MAX_STEPS / 2 steps that are at least
+ * DYN_MIN_STEP_US long. Frequency and duty cycle are limited
+ * accordingly.
+ *
+ * \param t Destination
+ * \param c Configuration
+ * \param dacA DAC value of level A
+ * \param dacB DAC value of level B
+ */
+void dyn_BuildTable(struct dynTable *t, const struct dynConfig *c,
+        uint16_t dacA, uint16_t dacB);
+
+/**
+ * \brief Starts the dynamic mode resp. applies changes
+ *
+ * Called from load_update() every millisecond while the dynamic mode
+ * is active. Changes of the configuration, the calibration and the
+ * power mode take effect at the end of the running period.
+ */
+void dyn_Update(void);
+
+/**
+ * \brief Stops writing the DAC
+ *
+ * Called from load_update() whenever the dynamic mode is not active.
+ */
+void dyn_Stop(void);
+
+#endif
@@ -4,7 +4,9 @@ const char *errorDescr[] = { "Load draws current despite being turned off",
         "Load current deviates from set current",
         "Load voltage deviates from set voltage",
         "Load power deviates from set power",
-        "Load draws more than maximum settable current" };
+        "Load draws more than maximum settable current",
+        "Control loop missed its deadline repeatedly",
+        "Supply rail of the analog board out of range" };
 
 void error_Menu(void) {
     if (error.code) {
@@ -45,6 +47,7 @@ void error_Menu(void) {
                 screen_SetSoftButton("Next", 2);
             }
             screen_SetSoftButton("Clear", 1);
+            screen_Commit();
             while (!(button = hal_getButton()))
                 ;
             while (hal_getButton())
@@ -67,6 +70,7 @@ void error_Menu(void) {
     screen_Clear();
     screen_FastString6x8("No errors", 0, 0);
     screen_SetSoftButton("OK", 2);
+    screen_Commit();
     while (!(hal_getButton() & (HAL_BUTTON_ESC | HAL_BUTTON_SOFT2)))
         ;
 
@@ -74,7 +78,7 @@ void error_Menu(void) {
         ;
 }
 
-void errors_Check(void) {
+RAMFUNC void errors_Check(void) {
     /******************************************************************
      * Load drawing current while input is switched off
      *****************************************************************/
@@ -90,8 +94,20 @@ void errors_Check(void) {
      *****************************************************************/
     if (load.powerOn && (load.mode == FUNCTION_CC)
             && (load.state.voltage > 500000)) {
-        int32_t minCurrent = (load.current - load.current / 10) - 10000;
-        int32_t maxCurrent = (load.current + load.current / 10) + 10000;
+        // the applied setpoint lags the set current while ramping
+        int32_t low = slew.value;
+        int32_t high = slew.value;
+        if (dyn.running) {
+            // switching between the two levels
+            low = dyn.tableConfig.currentA;
+            high = dyn.tableConfig.currentB;
+            if (low > high) {
+                low = dyn.tableConfig.currentB;
+                high = dyn.tableConfig.currentA;
+            }
+        }
+        int32_t minCurrent = (low - low / 10) - 10000;
+        int32_t maxCurrent = (high + high / 10) + 10000;
         if (load.state.current < minCurrent
                 || load.state.current > maxCurrent) {
             if (error.Duration[LOAD_ERROR_WRONG_CURRENT] < 254)
@@ -103,8 +119,8 @@ void errors_Check(void) {
      *****************************************************************/
     if (load.powerOn && (load.mode == FUNCTION_CV)
             && (load.state.current > 1000)) {
-        int32_t minVoltage = (load.voltage - load.voltage / 10) - 100000;
-        int32_t maxVoltage = (load.voltage + load.voltage / 10) + 100000;
+        int32_t minVoltage = (slew.value - slew.value / 10) - 100000;
+        int32_t maxVoltage = (slew.value + slew.value / 10) + 100000;
         if (load.state.voltage < minVoltage
                 || load.state.voltage > maxVoltage) {
             if (error.Duration[LOAD_ERROR_WRONG_VOLTAGE] < 254)
@@ -116,8 +132,8 @@ void errors_Check(void) {
      *****************************************************************/
     if (load.powerOn && (load.mode == FUNCTION_CP)
             && (load.state.current > 1000 || load.state.voltage > 500000)) {
-        int32_t minPower = (load.power - load.power / 5) - 100000;
-        int32_t maxPower = (load.power + load.power / 5) + 100000;
+        int32_t minPower = (slew.value - slew.value / 5) - 100000;
+        int32_t maxPower = (slew.value + slew.value / 5) + 100000;
         if (load.state.power < minPower || load.state.power > maxPower) {
             if (error.Duration[LOAD_ERROR_WRONG_POWER] < 254)
                 error.Duration[LOAD_ERROR_WRONG_POWER] += 2;
@@ -132,6 +148,13 @@ void errors_Check(void) {
         if (error.Duration[LOAD_ERROR_OVERCURRENT] < 254)
             error.Duration[LOAD_ERROR_OVERCURRENT] += 2;
     }
+    /******************************************************************
+     * Supply rails out of range
+     *****************************************************************/
+    if (!tele_RailsOK()) {
+        if (error.Duration[LOAD_ERROR_SUPPLY_RAIL] < 254)
+            error.Duration[LOAD_ERROR_SUPPLY_RAIL] += 2;
+    }
     /******************************************
      * Check error durations and set error code
      *****************************************/
@@ -14,6 +14,10 @@
 #define LOAD_ERROR_WRONG_POWER              0x04
 // load draws more than maximum current
 #define LOAD_ERROR_OVERCURRENT              0x05
+// control loop missed its deadline too often in a row
+#define LOAD_ERROR_MISSED_DEADLINE          0x06
+// a supply rail of the analog board is out of range
+#define LOAD_ERROR_SUPPLY_RAIL              0x07
 
 struct {
     uint32_t code;
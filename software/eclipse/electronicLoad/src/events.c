@@ -59,7 +59,7 @@ void events_Init(void) {
     }
 }
 
-void events_HandleEvents(void) {
+FLASHFUNC void events_HandleEvents(void) {
     uint8_t i;
     uint8_t triggered[EV_MAXEVENTS];
     for (i = 0; i < EV_MAXEVENTS; i++) {
@@ -140,7 +140,8 @@ void events_triggerEventDestination(uint8_t ev) {
             events.triggerOutState = -1;
             break;
         case EV_DEST_LOAD_MODE:
-            load_setMode(events.evlist[ev].effects[i].destMode);
+            // called from load_update(), no need for the mailbox
+            load.mode = events.evlist[ev].effects[i].destMode;
             break;
         case EV_DEST_LOAD_ON:
             load.powerOn = 1;
@@ -152,7 +153,7 @@ void events_triggerEventDestination(uint8_t ev) {
     }
 }
 
-void events_decrementTimers(void) {
+RAMFUNC void events_decrementTimers(void) {
     uint8_t i;
     for (i = 0; i < EV_MAXTIMERS; i++) {
         if (events.evTimers[i] == 0) {
@@ -165,7 +166,7 @@ void events_decrementTimers(void) {
     }
 }
 
-void events_updateWaveformPhase(void) {
+RAMFUNC void events_updateWaveformPhase(void) {
     events.waveformOldPhase = events.waveformPhase;
     events.waveformPhase = ((uint64_t) (waveform.phase) * 360000UL) / 65536;
 }
@@ -349,6 +350,7 @@ void events_editEventMenu(struct event *ev) {
             rowContent[7] = EV_ROW_SRC_EFFECTS;
         }
         screen_FastChar6x8(0x1A, 0, selectedRow);
+        screen_Commit();
         // wait for user input
         do {
             button = hal_getButton();
@@ -520,6 +522,7 @@ void events_editEffectMenu(struct effect *ef) {
         }
 
         screen_FastChar6x8(0x1A, 0, selectedRow);
+        screen_Commit();
         // wait for user input
         do {
             button = hal_getButton();
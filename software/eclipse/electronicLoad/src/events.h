@@ -89,7 +89,7 @@ void events_Init(void);
 /**
  * \brief Executes the destination action for every triggered event
  *
- * Should be called each millisecond
+ * Should be called each millisecond. Runs from flash.
  */
 void events_HandleEvents(void);
 
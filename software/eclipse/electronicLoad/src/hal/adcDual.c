@@ -0,0 +1,30 @@
+/**
+ * \file
+ * \brief   Dual ADC data line helper source file.
+ *
+ *          Bit handling for reading two ADCs in the same SPI burst,
+ *          one on each DOUT line. Kept free of any hardware access
+ *          so it can be verified on the host.
+ */
+#include "adcDual.h"
+
+RAMFUNC uint32_t hal_DualADCShift(uint32_t word, uint32_t idr) {
+    return (word << 2) | ((idr & HAL_DUAL_DOUT_MASK) >> HAL_DUAL_DOUT_SHIFT);
+}
+
+RAMFUNC void hal_DualADCSplit(uint32_t word, uint16_t *dout1, uint16_t *dout2) {
+    uint16_t a = 0, b = 0;
+    uint8_t i;
+    // bit pairs are ordered MSB first, DOUT1 is the upper bit of each pair
+    for (i = 0; i < 16; i++) {
+        a <<= 1;
+        b <<= 1;
+        if (word & 0x80000000)
+            a |= 0x01;
+        if (word & 0x40000000)
+            b |= 0x01;
+        word <<= 2;
+    }
+    *dout1 = a;
+    *dout2 = b;
+}
@@ -0,0 +1,43 @@
+/**
+ * \file
+ * \brief   Dual ADC data line helper header file.
+ *
+ *          Bit handling for reading two ADCs in the same SPI burst,
+ *          one on each DOUT line. Kept free of any hardware access
+ *          so it can be verified on the host.
+ */
+#ifndef HAL_ADCDUAL_H_
+#define HAL_ADCDUAL_H_
+
+#include <stdint.h>
+#include "common.h"
+
+// mask of both DOUT pins (PC14: DOUT1, PC13: DOUT2) in GPIOC->IDR
+#define HAL_DUAL_DOUT_MASK      0x6000
+// shift that moves DOUT2 into bit 0 and DOUT1 into bit 1
+#define HAL_DUAL_DOUT_SHIFT     13
+
+/**
+ * \brief Shifts the state of both DOUT lines into an interleaved word
+ *
+ * Called once per clock cycle. Only the last 16 clock cycles remain in
+ * the word, which matches the truncation of a single ADC result to
+ * 16 bit. The assembler loop in hal_ConvertADCDual() implements the
+ * same operation.
+ *
+ * \param word  Interleaved word of the previous clock cycles
+ * \param idr   Sampled value of GPIOC->IDR
+ * \return Updated interleaved word
+ */
+uint32_t hal_DualADCShift(uint32_t word, uint32_t idr);
+
+/**
+ * \brief Separates an interleaved word into both ADC results
+ *
+ * \param word  Interleaved word after the complete burst
+ * \param dout1 16-Bit result of the ADC on DOUT1
+ * \param dout2 16-Bit result of the ADC on DOUT2
+ */
+void hal_DualADCSplit(uint32_t word, uint16_t *dout1, uint16_t *dout2);
+
+#endif
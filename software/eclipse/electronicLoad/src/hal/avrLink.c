@@ -0,0 +1,72 @@
+/**
+ * \file
+ * \brief   AVR link edge sequence source file.
+ *
+ *          Builds the GPIO edge sequence of one transfer to the AVR on
+ *          the analog board and decodes the sampled data line. The
+ *          sequence is written to the port registers by DMA, paced by
+ *          a timer (see hal_AVRQueueFrame). Kept free of any hardware
+ *          access so it can be verified on the host.
+ */
+#include "avrLink.h"
+
+// BSRR values: lower half sets, upper half resets the pins
+#define AVR_SET(pins)           ((uint32_t) (pins))
+#define AVR_RESET(pins)         ((uint32_t) (pins) << 16)
+
+static HAL_AVR_LINK_RAMFUNC void hal_AVRAddSlot(struct halAVRFrame *f,
+        uint32_t porta, uint32_t portc) {
+    f->porta[f->slots] = porta;
+    f->portc[f->slots] = portc;
+    f->slots++;
+}
+
+HAL_AVR_LINK_RAMFUNC uint16_t hal_AVRBuildFrame(struct halAVRFrame *f,
+        uint32_t word, uint8_t bits) {
+    f->slots = 0;
+    f->bits = 0;
+    if (!bits || bits > HAL_AVR_MAX_BITS || (bits & 0x07))
+        return 0;
+    f->bits = bits;
+    // clock idles low, both chip select lines high select the AVR
+    hal_AVRAddSlot(f,
+            AVR_RESET(HAL_AVR_PIN_CLK)
+                    | AVR_SET(HAL_AVR_PIN_CS_A | HAL_AVR_PIN_CS_B), 0);
+    uint32_t mask = 1UL << (bits - 1);
+    uint8_t i, j;
+    for (i = 0; i < bits; i++) {
+        // low phase: apply data
+        uint32_t din =
+                (word & mask) ?
+                        AVR_SET(HAL_AVR_PIN_DIN) : AVR_RESET(HAL_AVR_PIN_DIN);
+        hal_AVRAddSlot(f, AVR_RESET(HAL_AVR_PIN_CLK), din);
+        // high phase: the AVR samples DIN, DOUT is sampled at the end
+        hal_AVRAddSlot(f, AVR_SET(HAL_AVR_PIN_CLK), 0);
+        mask >>= 1;
+        if ((i & 0x07) == 0x07 && i != bits - 1) {
+            // the first gap slot ends the clock pulse
+            hal_AVRAddSlot(f, AVR_RESET(HAL_AVR_PIN_CLK), 0);
+            for (j = 1; j < HAL_AVR_GAP_SLOTS; j++)
+                hal_AVRAddSlot(f, 0, 0);
+        }
+    }
+    hal_AVRAddSlot(f, AVR_RESET(HAL_AVR_PIN_CLK), 0);
+    hal_AVRAddSlot(f, AVR_RESET(HAL_AVR_PIN_CS_A | HAL_AVR_PIN_CS_B),
+            AVR_RESET(HAL_AVR_PIN_DIN));
+    return f->slots;
+}
+
+HAL_AVR_LINK_RAMFUNC uint32_t hal_AVRDecodeFrame(const struct halAVRFrame *f,
+        const uint16_t *idr) {
+    uint32_t word = 0;
+    uint16_t i;
+    for (i = 0; i < f->slots; i++) {
+        if (f->porta[i] & AVR_SET(HAL_AVR_PIN_CLK)) {
+            // end of a high phase
+            word <<= 1;
+            if (idr[i] & HAL_AVR_PIN_DOUT)
+                word |= 0x01;
+        }
+    }
+    return word;
+}
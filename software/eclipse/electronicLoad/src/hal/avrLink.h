@@ -0,0 +1,87 @@
+/**
+ * \file
+ * \brief   AVR link edge sequence header file.
+ *
+ *          Builds the GPIO edge sequence of one transfer to the AVR on
+ *          the analog board and decodes the sampled data line. The
+ *          sequence is written to the port registers by DMA, paced by
+ *          a timer (see hal_AVRQueueFrame). Kept free of any hardware
+ *          access so it can be verified on the host.
+ */
+#ifndef HAL_AVRLINK_H_
+#define HAL_AVRLINK_H_
+
+#include <stdint.h>
+#include "common.h"
+
+// Experimental: paces the transfers to the AVR with timer 4 and writes
+// them with the DMA (see hal_AVRQueueFrame). Neither built for the target
+// nor checked on the hardware yet, thus off by default. Without it the
+// transfers use the blocking NOP-timed software SPI.
+//#define HAL_AVR_LINK_DMA
+
+// the edge sequence is only built in the control loop with the DMA link
+#ifdef HAL_AVR_LINK_DMA
+#define HAL_AVR_LINK_RAMFUNC    RAMFUNC
+#else
+#define HAL_AVR_LINK_RAMFUNC
+#endif
+
+// pins of the software SPI (must match the definitions in currentSink.h)
+// PA0: CLK, PA5: CS_A, PA7: CS_B
+#define HAL_AVR_PIN_CLK         0x0001
+#define HAL_AVR_PIN_CS_A        0x0020
+#define HAL_AVR_PIN_CS_B        0x0080
+// PC15: DIN, PC13: DOUT2 (data from the AVR)
+#define HAL_AVR_PIN_DIN         0x8000
+#define HAL_AVR_PIN_DOUT        0x2000
+
+// length of one slot (half clock period) in CPU cycles. The AVR needs
+// high and low pulses of at least 250ns (2 cycles at 8MHz).
+#define HAL_AVR_SLOT_CYCLES     24
+// idle slots after every byte of a multi byte frame, gives the SPI
+// interrupt of the AVR time to prepare the next byte (6us)
+#define HAL_AVR_GAP_SLOTS       ((6 * 72 + HAL_AVR_SLOT_CYCLES - 1) \
+        / HAL_AVR_SLOT_CYCLES)
+// longest frame in bits
+#define HAL_AVR_MAX_BITS        24
+// slots of the longest frame: chip select, two per bit, gaps between
+// the bytes, clock low and chip deselect
+#define HAL_AVR_MAX_SLOTS       (1 + 2 * HAL_AVR_MAX_BITS \
+        + (HAL_AVR_MAX_BITS / 8 - 1) * HAL_AVR_GAP_SLOTS + 2)
+
+struct halAVRFrame {
+    // values for GPIOA->BSRR (clock and chip select), one per slot
+    uint32_t porta[HAL_AVR_MAX_SLOTS];
+    // values for GPIOC->BSRR (data), one per slot, 0 leaves the pins
+    uint32_t portc[HAL_AVR_MAX_SLOTS];
+    uint16_t slots;
+    uint8_t bits;
+};
+
+/**
+ * \brief Builds the edge sequence of a frame
+ *
+ * Selects the AVR, shifts out the word MSB first (data changes with
+ * the falling clock edge, the AVR samples on the rising edge), waits
+ * HAL_AVR_GAP_SLOTS after every byte except the last one and
+ * deselects the AVR.
+ *
+ * \param f     Frame to fill
+ * \param word  Data to send, right aligned
+ * \param bits  Number of bits to send (multiple of 8, at most
+ *              HAL_AVR_MAX_BITS)
+ * \return Number of slots, 0 if bits is invalid
+ */
+uint16_t hal_AVRBuildFrame(struct halAVRFrame *f, uint32_t word, uint8_t bits);
+
+/**
+ * \brief Extracts the received data from the sampled input register
+ *
+ * \param f     Frame the samples belong to
+ * \param idr   GPIOC->IDR sampled at the end of every slot
+ * \return Received word, right aligned, MSB first
+ */
+uint32_t hal_AVRDecodeFrame(const struct halAVRFrame *f, const uint16_t *idr);
+
+#endif
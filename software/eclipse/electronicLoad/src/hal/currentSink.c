@@ -6,6 +6,255 @@
  * 			power sink board.
  */
 #include "currentSink.h"
+#include "timer.h"
+
+// state of the AVR link, only accessed by the functions below
+static struct {
+#ifdef HAL_AVR_LINK_DMA
+    struct halAVRFrame frame;
+    // GPIOC->IDR sampled at the end of every slot
+    uint16_t idr[HAL_AVR_MAX_SLOTS];
+    void (*done)(uint32_t);
+    volatile uint8_t busy;
+#endif
+    uint32_t received;
+} avr;
+
+/**
+ * \brief Masks the interrupts that may use the SPI lines on their own
+ *
+ * Up to HAL_DAC_DIRECT_PRIORITY (see hal_setDACDirect), they must not
+ * interrupt a transfer. Must be paired with hal_BusUnlock().
+ *
+ * \return Previous mask
+ */
+static inline RAMFUNC uint32_t hal_BusLock(void) {
+    uint32_t basepri = __get_BASEPRI();
+    if (!basepri
+            || basepri > (HAL_DAC_DIRECT_PRIORITY << (8 - __NVIC_PRIO_BITS)))
+        __set_BASEPRI(HAL_DAC_DIRECT_PRIORITY << (8 - __NVIC_PRIO_BITS));
+    return basepri;
+}
+
+static inline RAMFUNC void hal_BusUnlock(uint32_t basepri) {
+    __set_BASEPRI(basepri);
+}
+
+#ifdef HAL_AVR_LINK_DMA
+/**
+ * \brief Sets up timer 4 and the DMA channels of the AVR link
+ *
+ * Every timer period is one slot of the edge sequence:
+ * - update (DMA1 channel 7): clock and chip select to GPIOA->BSRR
+ * - compare 1 (DMA1 channel 1): data to GPIOC->BSRR
+ * - compare 2 (DMA1 channel 4): samples GPIOC->IDR at the end of the
+ *   slot, its transfer complete interrupt finishes the frame
+ */
+static void hal_AVRLinkInit(void) {
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM4, ENABLE);
+
+    TIM_TimeBaseInitTypeDef timebase;
+    timebase.TIM_ClockDivision = TIM_CKD_DIV1;
+    timebase.TIM_CounterMode = TIM_CounterMode_Up;
+    timebase.TIM_RepetitionCounter = 0;
+    timebase.TIM_Prescaler = 0;
+    timebase.TIM_Period = HAL_AVR_SLOT_CYCLES - 1;
+    TIM_TimeBaseInit(TIM4, &timebase);
+    TIM4->CCR1 = 1;
+    TIM4->CCR2 = HAL_AVR_SLOT_CYCLES - 2;
+
+    DMA_InitTypeDef dma;
+    dma.DMA_DIR = DMA_DIR_PeripheralDST;
+    dma.DMA_BufferSize = 0;
+    dma.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    dma.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+    dma.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+    dma.DMA_Mode = DMA_Mode_Normal;
+    dma.DMA_M2M = DMA_M2M_Disable;
+
+    dma.DMA_PeripheralBaseAddr = (uint32_t) &GPIOA->BSRR;
+    dma.DMA_MemoryBaseAddr = (uint32_t) avr.frame.porta;
+    dma.DMA_Priority = DMA_Priority_VeryHigh;
+    DMA_Init(DMA1_Channel7, &dma);
+
+    dma.DMA_PeripheralBaseAddr = (uint32_t) &GPIOC->BSRR;
+    dma.DMA_MemoryBaseAddr = (uint32_t) avr.frame.portc;
+    dma.DMA_Priority = DMA_Priority_High;
+    DMA_Init(DMA1_Channel1, &dma);
+
+    dma.DMA_DIR = DMA_DIR_PeripheralSRC;
+    dma.DMA_PeripheralBaseAddr = (uint32_t) &GPIOC->IDR;
+    dma.DMA_MemoryBaseAddr = (uint32_t) avr.idr;
+    dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+    dma.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+    dma.DMA_Priority = DMA_Priority_Medium;
+    DMA_Init(DMA1_Channel4, &dma);
+    DMA_ITConfig(DMA1_Channel4, DMA_IT_TC, ENABLE);
+
+    NVIC_InitTypeDef nvic;
+    nvic.NVIC_IRQChannel = DMA1_Channel4_IRQn;
+    nvic.NVIC_IRQChannelCmd = ENABLE;
+    nvic.NVIC_IRQChannelSubPriority = 0;
+    nvic.NVIC_IRQChannelPreemptionPriority = HAL_AVR_LINK_PRIORITY;
+    NVIC_Init(&nvic);
+}
+
+/**
+ * \brief Stops the timer and the DMA after the last slot of a frame
+ *
+ * Must be called with the AVR link interrupt masked.
+ */
+static RAMFUNC void hal_AVRFinish(void) {
+    TIM4->CR1 &= ~TIM_CR1_CEN;
+    TIM4->DIER = 0;
+    DMA1_Channel7->CCR &= ~DMA_CCR1_EN;
+    DMA1_Channel1->CCR &= ~DMA_CCR1_EN;
+    DMA1_Channel4->CCR &= ~DMA_CCR1_EN;
+    DMA1->IFCR = DMA_IFCR_CGIF4;
+    avr.received = hal_AVRDecodeFrame(&avr.frame, avr.idr);
+    avr.busy = 0;
+    if (avr.done)
+        avr.done(avr.received);
+}
+
+RAMFUNC void DMA1_Channel4_IRQHandler(void) {
+    if (avr.busy)
+        hal_AVRFinish();
+    DMA1->IFCR = DMA_IFCR_CGIF4;
+}
+
+RAMFUNC void hal_AVRQueueFrame(uint32_t word, uint8_t bits,
+        void (*done)(uint32_t)) {
+    uint32_t lock = hal_BusLock();
+    hal_AVRWait();
+    if (!hal_AVRBuildFrame(&avr.frame, word, bits)) {
+        hal_BusUnlock(lock);
+        return;
+    }
+    avr.done = done;
+    avr.busy = 1;
+    DMA1_Channel7->CNDTR = avr.frame.slots;
+    DMA1_Channel1->CNDTR = avr.frame.slots;
+    DMA1_Channel4->CNDTR = avr.frame.slots;
+    DMA1_Channel7->CCR |= DMA_CCR1_EN;
+    DMA1_Channel1->CCR |= DMA_CCR1_EN;
+    DMA1_Channel4->CCR |= DMA_CCR1_EN;
+    // the first update (start of slot 0) follows with the next clock
+    TIM4->CNT = HAL_AVR_SLOT_CYCLES - 1;
+    TIM4->SR = 0;
+    TIM4->DIER = TIM_DIER_UDE | TIM_DIER_CC1DE | TIM_DIER_CC2DE;
+    TIM4->CR1 |= TIM_CR1_CEN;
+    hal_BusUnlock(lock);
+}
+
+RAMFUNC void hal_AVRWait(void) {
+    if (!avr.busy)
+        return;
+    // the DMA keeps running with interrupts disabled
+    while (DMA1_Channel4->CNDTR)
+        ;
+    __disable_irq();
+    if (avr.busy)
+        hal_AVRFinish();
+    __enable_irq();
+}
+
+#else
+
+// busy-wait of the software SPI to the AVR
+#define HAL_AVR_NOPS(n)     asm volatile(".rept " #n "\n\tnop\n\t.endr")
+
+/**
+ * \brief Sends a byte to the AVR with the software SPI
+ *
+ * Minimum high/low pulse length for AVR on 8MHz is 250ns.
+ * This function has at least 300ns high/low pulses.
+ */
+static RAMFUNC void hal_AVRSendByte(uint8_t word) {
+    HAL_CLK_LOW;
+    hal_SetChipSelect(HAL_CS_AVR);
+    uint8_t i;
+    for (i = 0; i < 8; i++) {
+        if (word & 0x80) {
+            HAL_DIN_HIGH;
+        } else {
+            HAL_DIN_LOW;
+        }
+        HAL_AVR_NOPS(22);
+        // generate clock pulse
+        HAL_CLK_HIGH;
+        word <<= 1;
+        // delay clock (AVR isn't that fast)
+        HAL_AVR_NOPS(36);
+        HAL_CLK_LOW;
+    }
+    HAL_AVR_NOPS(19);
+    hal_SetChipSelect(HAL_CS_NONE);
+    HAL_DIN_LOW;
+}
+
+/**
+ * \brief Transfers a 24 bit frame to the AVR with the software SPI
+ *
+ * Waits after each byte to give the SPI interrupt of the AVR enough
+ * time.
+ *
+ * \return Received word
+ */
+static RAMFUNC uint32_t hal_AVRTransferWord(uint32_t word) {
+    HAL_CLK_LOW;
+    hal_SetChipSelect(HAL_CS_AVR);
+    uint8_t i;
+    uint32_t rec = 0;
+    for (i = 0; i < 24; i++) {
+        if (word & 0x00800000) {
+            HAL_DIN_HIGH;
+        } else {
+            HAL_DIN_LOW;
+        }
+        HAL_AVR_NOPS(22);
+        // generate clock pulse
+        HAL_CLK_HIGH;
+        rec <<= 1;
+        if (HAL_DOUT2)
+            rec |= 0x01;
+        // delay clock (AVR isn't that fast)
+        HAL_AVR_NOPS(25);
+        word <<= 1;
+        HAL_CLK_LOW;
+        HAL_AVR_NOPS(24);
+        if (i == 7 || i == 15) {
+            // wait far longer to give SPI interrupt enough time
+            timer_waitus(6);
+        }
+    }
+    hal_SetChipSelect(HAL_CS_NONE);
+    HAL_DIN_LOW;
+    return rec;
+}
+
+RAMFUNC void hal_AVRQueueFrame(uint32_t word, uint8_t bits,
+        void (*done)(uint32_t)) {
+    uint32_t lock = hal_BusLock();
+    if (bits == 8) {
+        hal_AVRSendByte(word);
+        avr.received = 0;
+    } else {
+        // the AVR only knows 8 and 24 bit frames
+        avr.received = hal_AVRTransferWord(word);
+    }
+    hal_BusUnlock(lock);
+    if (done)
+        done(avr.received);
+}
+
+RAMFUNC void hal_AVRWait(void) {
+    // the transfers are complete when hal_AVRQueueFrame() returns
+}
+
+#endif
 
 void hal_currentSinkInit(void) {
     GPIO_InitTypeDef gpio;
@@ -31,10 +280,15 @@ void hal_currentSinkInit(void) {
     gpio.GPIO_Pin = GPIO_Pin_7;
     GPIO_Init(GPIOC, &gpio);
 
+#ifdef HAL_AVR_LINK_DMA
+    hal_AVRLinkInit();
+#endif
+
+    hal_ForceDACUpdate();
     hal_setDAC(0);
 }
 
-void hal_SetChipSelect(uint8_t cs) {
+RAMFUNC void hal_SetChipSelect(uint8_t cs) {
     switch (cs) {
     default:
     case HAL_CS_NONE:
@@ -56,254 +310,87 @@ void hal_SetChipSelect(uint8_t cs) {
     }
 }
 
-void hal_SetAVRGPIO(uint8_t gpio) {
+RAMFUNC void hal_SetAVRGPIO(uint8_t gpio) {
     hal.AVRgpio |= gpio;
 }
-void hal_ClearAVRGPIO(uint8_t gpio) {
+RAMFUNC void hal_ClearAVRGPIO(uint8_t gpio) {
     hal.AVRgpio &= ~gpio;
 }
 
-void hal_UpdateAVRGPIOs(void) {
+RAMFUNC void hal_UpdateAVRGPIOs(void) {
     static uint8_t oldGPIOs = 0;
     if (hal.AVRgpio != oldGPIOs) {
         // only update when there is actually a pinchange
         oldGPIOs = hal.AVRgpio;
-        HAL_CLK_LOW;
-        hal_SetChipSelect(HAL_CS_AVR);
-        uint8_t word = hal.AVRgpio & 0x7F;
-        uint8_t i;
-        for (i = 0; i < 8; i++) {
-            if (word & 0x80) {
-                HAL_DIN_HIGH;
-            } else {
-                HAL_DIN_LOW;
-            }
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            // generate clock pulse
-            HAL_CLK_HIGH;
-            word <<= 1;
-            // delay clock (AVR isn't that fast)
-            // Minimum high/low pulse length for AVR on 8MHz is 250ns.
-            // This function has at least 300ns high/low pulses.
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            asm volatile("NOP");
-            HAL_CLK_LOW;
-        }
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        hal_SetChipSelect(HAL_CS_NONE);
-        HAL_DIN_LOW;
+        hal_AVRQueueFrame(hal.AVRgpio & 0x7F, 8, NULL);
     }
 }
 
 uint16_t hal_ReadAVRADC(uint8_t channel) {
-    HAL_CLK_LOW;
-    hal_SetChipSelect(HAL_CS_AVR);
-    uint32_t word = 0x00C08080 | ((uint32_t) channel << 16);
-    uint8_t i;
-    uint32_t rec = 0;
-    for (i = 0; i < 24; i++) {
-        if (word & 0x00800000) {
-            HAL_DIN_HIGH;
-        } else {
-            HAL_DIN_LOW;
-        }
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        // generate clock pulse
-        HAL_CLK_HIGH;
-        rec <<= 1;
-        if (HAL_DOUT2)
-            rec |= 0x01;
+    hal_AVRQueueFrame(0x00C08080 | ((uint32_t) channel << 16), 24, NULL);
+    hal_AVRWait();
+    return avr.received & 0x000003ff;
+}
 
-        // delay clock (AVR isn't that fast)
-        // Minimum high/low pulse length for AVR on 8MHz is 250ns.
-        // This function has at least 300ns high/low pulses.
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
+static void (*hal_AVRADCDone)(uint16_t);
 
-        word <<= 1;
-        HAL_CLK_LOW;
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        asm volatile("NOP");
-        if (i == 7 || i == 15) {
-            // wait far longer to give SPI interrupt enough time
-            timer_waitus(6);
-        }
-    }
-    hal_SetChipSelect(HAL_CS_NONE);
-    HAL_DIN_LOW;
-    rec &= 0x000003ff;
-    return rec;
+static RAMFUNC void hal_AVRADCComplete(uint32_t received) {
+    hal_AVRADCDone(received & 0x000003ff);
+}
+
+RAMFUNC void hal_ReadAVRADCAsync(uint8_t channel, void (*done)(uint16_t)) {
+    // the previous conversion must be complete before the callback
+    // is replaced
+    hal_AVRWait();
+    hal_AVRADCDone = done;
+    hal_AVRQueueFrame(0x00C08080 | ((uint32_t) channel << 16), 24,
+            hal_AVRADCComplete);
 }
 
 uint8_t hal_ReadTemperature(uint8_t temp) {
-    uint32_t raw;
     if (temp == HAL_TEMP1)
-        raw = hal_ReadAVRADC(HAL_AVR_ADC_TEMP1);
+        return hal_ConvertTemperature(hal_ReadAVRADC(HAL_AVR_ADC_TEMP1));
     else
-        raw = hal_ReadAVRADC(HAL_AVR_ADC_TEMP2);
+        return hal_ConvertTemperature(hal_ReadAVRADC(HAL_AVR_ADC_TEMP2));
+}
+
+RAMFUNC uint8_t hal_ConvertTemperature(uint16_t raw) {
+    uint32_t temp = raw;
     // temperature scale is 10mV/°C
     // ADC reference is (at least should be) 5V
-    raw *= 125;
-    raw /= 256;
-    return raw & 0xFF;
+    temp *= 125;
+    temp /= 256;
+    return temp & 0xFF;
 }
 
 int16_t hal_ReadVoltageRail(uint8_t rail) {
-    int32_t result;
     switch (rail) {
     case HAL_RAIL_P5V:
-        result = hal_ReadAVRADC(HAL_AVR_ADC_P5V);
+        return hal_ConvertVoltageRail(rail, hal_ReadAVRADC(HAL_AVR_ADC_P5V));
+    case HAL_RAIL_P15V:
+        return hal_ConvertVoltageRail(rail, hal_ReadAVRADC(HAL_AVR_ADC_P15V));
+    case HAL_RAIL_N15V:
+        return hal_ConvertVoltageRail(rail, hal_ReadAVRADC(HAL_AVR_ADC_N15V));
+    }
+    return 0;
+}
+
+RAMFUNC int16_t hal_ConvertVoltageRail(uint8_t rail, uint16_t raw) {
+    int32_t result = raw;
+    switch (rail) {
+    case HAL_RAIL_P5V:
         // ADC measures 1.1 bandgap against 5V reference
+        if (!result)
+            return 0;
         result = 1126400 / result;
         break;
     case HAL_RAIL_P15V:
-        result = hal_ReadAVRADC(HAL_AVR_ADC_P15V);
         // ADC measures 15V via a voltage divider with 10k/3k3
         // and a reference voltage of 5V
         result *= 492;
         result /= 25;
         break;
     case HAL_RAIL_N15V:
-        result = hal_ReadAVRADC(HAL_AVR_ADC_N15V);
         // calculation assumes that the 15V rail is at 15V
         // ADC measures -15V via a voltage divider between +15V
         // and -15V (6k8/10k) against a reference voltage of 5V
@@ -316,11 +403,12 @@ int16_t hal_ReadVoltageRail(uint8_t rail) {
     return result;
 }
 
-void hal_setDAC(uint16_t dac) {
-//    static uint16_t _dac
-//    if (hal.DACvalue != dac) {
-    // only update if DAC value has changed
-//    _dac = dac;
+/**
+ * \brief Shifts a value into the DAC
+ *
+ * The lines must not be in use by another transfer.
+ */
+static inline RAMFUNC void hal_DACTransfer(uint16_t dac) {
     HAL_CLK_HIGH;
     hal_SetChipSelect(HAL_CS_DAC);
     // set control bits to 01 (write through)
@@ -371,82 +459,166 @@ void hal_setDAC(uint16_t dac) {
 #endif
     hal_SetChipSelect(HAL_CS_NONE);
     HAL_DIN_LOW;
-//    }
 }
 
-void hal_setFan(uint8_t en) {
+RAMFUNC void hal_setDAC(uint16_t dac) {
+    // only update if DAC value has changed
+    if (hal.DACvalid && hal.DACvalue == dac) {
+        hal.DACskipped++;
+        return;
+    }
+    hal.DACvalue = dac;
+    hal.DACvalid = 1;
+    hal.DACwrites++;
+    uint32_t lock = hal_BusLock();
+    hal_AVRWait();
+    hal_DACTransfer(dac);
+    hal_BusUnlock(lock);
+}
+
+RAMFUNC void hal_setDACDirect(uint16_t dac) {
+    // the bus lock guarantees that no transfer is interrupted
+#ifdef HAL_AVR_LINK_DMA
+    // only a frame of the AVR link may still be running
+    while (avr.busy && DMA1_Channel4->CNDTR)
+        ;
+#endif
+    hal_DACTransfer(dac);
+}
+
+RAMFUNC void hal_ForceDACUpdate(void) {
+    hal.DACvalid = 0;
+}
+
+RAMFUNC void hal_setFan(uint8_t en) {
     if (en) {
-        GPIO_WriteBit(GPIOC, GPIO_Pin_7, Bit_SET);
+        GPIOC->BSRR = GPIO_Pin_7;
     } else {
-        GPIO_WriteBit(GPIOC, GPIO_Pin_7, Bit_RESET);
+        GPIOC->BRR = GPIO_Pin_7;
     }
 }
 
-uint16_t hal_getADC(uint32_t nsamples) {
+RAMFUNC uint16_t hal_ConvertADC(void) {
+    uint32_t adc = 0;
+    uint32_t lock = hal_BusLock();
+    hal_AVRWait();
+    HAL_CLK_LOW;
+    HAL_DIN_LOW;
+    hal_SetChipSelect(HAL_CS_ADC);
+#ifndef HAL_USE_ASM_SPI
+    // slightly slower C code
+    // CLK_h is about 110ns (ADC minimum 65ns)
+    // CLK_l is about 375ns (DAC minimum 65ns)
+    uint8_t p;
+    for (p = 0; p < 24; p++) {
+        if (HAL_DOUT1)
+        adc |= 0x01;
+        adc <<= 1;
+        HAL_CLK_HIGH;
+        HAL_CLK_LOW;
+    }
+#else
+    // slightly faster assembler code (about 1.7 times faster than C code)
+    // CLK_h is about 80ns (ADC minimum 65ns)
+    // CLK_l is about 180ns (DAC minimum 65ns)
+    uint32_t GPIOA_BSRR = 0x40010810;
+    uint32_t GPIOC_IDR = 0x40011008;
+    asm(
+            "ldr %[adc], =0x1\n\t" /* initialize result with 1 to recognize loop end */
+            "lsl r2, %[clkpin], #16\n\t" /* prepare register to clear CLK pin */
+            "1:\n\t" /* beginning of the SPI loop */
+            "lsl %[adc], %[adc], #1\n\t" /* left shift preliminary result to make room for next bit */
+            "ldr r0, [%[dout]]\n\t" /* sample DOUT pins */
+            "str %[clkpin], [%[clk]]\n\t" /* set CLK high */
+            "ands r0, r0, #0x4000\n\t" /* extract specific pin from GPIO byte*/
+            "it ne\n\t" /* IF bit is set */
+            "addne %[adc], %[adc], #1\n\t" /* set LSB of preliminary result */
+            "ands r0, %[adc], #0x01000000\n\t" /* has the first 1 in the result been passed all the way above the MSB? */
+            "str r2, [%[clk]]\n\t" /* set CLK low */
+            "beq 1b\n\t" /* repeat until bit above MSB is detected */
+            "sub %[adc], %[adc], #0x01000000\n\t" /* remove bit above MSB */
+            : [adc] "+r" (adc)
+            : [dout] "r" (GPIOC_IDR),
+            [clk] "r" (GPIOA_BSRR),
+            [clkpin] "r" (GPIO_Pin_0)
+            :"r2", "r0" );
+#endif
+    hal_SetChipSelect(HAL_CS_NONE);
+    hal_BusUnlock(lock);
+    return adc;
+}
+
+#ifdef HAL_DUAL_ADC
+RAMFUNC void hal_ConvertADCDual(uint16_t adc[2]) {
+    uint32_t word = 0;
+    uint32_t lock = hal_BusLock();
+    hal_AVRWait();
     HAL_CLK_LOW;
+    HAL_DIN_LOW;
+    hal_SetChipSelect(HAL_CS_ADC);
+#ifndef HAL_USE_ASM_SPI
+    uint8_t p;
+    for (p = 0; p < 24; p++) {
+        word = hal_DualADCShift(word, GPIOC->IDR);
+        HAL_CLK_HIGH;
+        HAL_CLK_LOW;
+    }
+#else
+    // same timing as the loop in hal_ConvertADC()
+    // (must match hal_DualADCShift)
+    uint32_t GPIOA_BSRR = 0x40010810;
+    uint32_t GPIOC_IDR = 0x40011008;
+    asm(
+            "mov r3, #24\n\t" /* number of clock cycles */
+            "lsl r2, %[clkpin], #16\n\t" /* prepare register to clear CLK pin */
+            "1:\n\t" /* beginning of the SPI loop */
+            "ldr r0, [%[dout]]\n\t" /* sample DOUT pins */
+            "str %[clkpin], [%[clk]]\n\t" /* set CLK high */
+            "and r0, r0, #0x6000\n\t" /* extract both DOUT pins */
+            "lsl %[word], %[word], #2\n\t" /* make room for the next bit pair */
+            "orr %[word], %[word], r0, lsr #13\n\t" /* DOUT1 -> bit 1, DOUT2 -> bit 0 */
+            "subs r3, r3, #1\n\t" /* count clock cycles */
+            "str r2, [%[clk]]\n\t" /* set CLK low */
+            "bne 1b\n\t" /* repeat until all bits are received */
+            : [word] "+r" (word)
+            : [dout] "r" (GPIOC_IDR),
+            [clk] "r" (GPIOA_BSRR),
+            [clkpin] "r" (GPIO_Pin_0)
+            :"r3", "r2", "r0", "cc" );
+#endif
+    hal_SetChipSelect(HAL_CS_NONE);
+    hal_BusUnlock(lock);
+    hal_DualADCSplit(word, &adc[HAL_ADC_CURRENT], &adc[HAL_ADC_VOLTAGE]);
+}
+#endif
+
+RAMFUNC void hal_CheckADCStability(uint16_t min, uint16_t max) {
+    if (max - min > HAL_ADC_UNSTABLE_THRESHOLD) {
+        if (hal.ADCunstable < 254)
+            hal.ADCunstable += 2;
+    } else if (hal.ADCunstable) {
+        hal.ADCunstable--;
+    }
+}
+
+uint16_t hal_getADC(uint32_t nsamples) {
     uint32_t i;
     uint64_t buf = 0;
     uint16_t min = UINT16_MAX;
     uint16_t max = 0;
     for (i = 0; i < nsamples; i++) {
-        uint32_t adc = 0;
-        HAL_DIN_LOW;
-        hal_SetChipSelect(HAL_CS_ADC);
-#ifndef HAL_USE_ASM_SPI
-        // slightly slower C code
-        // CLK_h is about 110ns (ADC minimum 65ns)
-        // CLK_l is about 375ns (DAC minimum 65ns)
-        uint8_t p;
-        for (p = 0; p < 24; p++) {
-            if (HAL_DOUT1)
-            adc |= 0x01;
-            adc <<= 1;
-            HAL_CLK_HIGH;
-            HAL_CLK_LOW;
-        }
-#else
-        // slightly faster assembler code (about 1.7 times faster than C code)
-        // CLK_h is about 80ns (ADC minimum 65ns)
-        // CLK_l is about 180ns (DAC minimum 65ns)
-        uint32_t GPIOA_BSRR = 0x40010810;
-        uint32_t GPIOC_IDR = 0x40011008;
-        asm(
-                "ldr %[adc], =0x1\n\t" /* initialize result with 1 to recognize loop end */
-                "lsl r2, %[clkpin], #16\n\t" /* prepare register to clear CLK pin */
-                "1:\n\t" /* beginning of the SPI loop */
-                "lsl %[adc], %[adc], #1\n\t" /* left shift preliminary result to make room for next bit */
-                "ldr r0, [%[dout]]\n\t" /* sample DOUT pins */
-                "str %[clkpin], [%[clk]]\n\t" /* set CLK high */
-                "ands r0, r0, #0x4000\n\t" /* extract specific pin from GPIO byte*/
-                "it ne\n\t" /* IF bit is set */
-                "addne %[adc], %[adc], #1\n\t" /* set LSB of preliminary result */
-                "ands r0, %[adc], #0x01000000\n\t" /* has the first 1 in the result been passed all the way above the MSB? */
-                "str r2, [%[clk]]\n\t" /* set CLK low */
-                "beq 1b\n\t" /* repeat until bit above MSB is detected */
-                "sub %[adc], %[adc], #0x01000000\n\t" /* remove bit above MSB */
-                : [adc] "+r" (adc)
-                : [dout] "r" (GPIOC_IDR),
-                [clk] "r" (GPIOA_BSRR),
-                [clkpin] "r" (GPIO_Pin_0)
-                :"r2", "r0" );
-#endif
-        hal_SetChipSelect(HAL_CS_NONE);
+        uint16_t adc = hal_ConvertADC();
         buf += adc;
         if (adc > max)
             max = adc;
         if (adc < min)
             min = adc;
     }
-    if (max - min > HAL_ADC_UNSTABLE_THRESHOLD) {
-        if (hal.ADCunstable < 254)
-            hal.ADCunstable += 2;
-    } else if (hal.ADCunstable) {
-        hal.ADCunstable--;
-    }
+    hal_CheckADCStability(min, max);
     return buf /= nsamples;
 }
 
-void hal_SetControlMode(uint8_t mode) {
+RAMFUNC void hal_SetControlMode(uint8_t mode) {
     switch (mode) {
     case HAL_MODE_CC:
         hal_ClearAVRGPIO(HAL_GPIO_MODE_A);
@@ -456,19 +628,18 @@ void hal_SetControlMode(uint8_t mode) {
         hal_SetAVRGPIO(HAL_GPIO_MODE_A);
         hal_ClearAVRGPIO(HAL_GPIO_MODE_B);
         break;
-//    case HAL_MODE_CR:
-//        hal_SetAVRGPIO(HAL_GPIO_MODE_A);
-//        hal_SetAVRGPIO(HAL_GPIO_MODE_B);
-//        break;
-//    case HAL_MODE_CP:
-//        hal_ClearAVRGPIO(HAL_GPIO_MODE_A);
-//        hal_SetAVRGPIO(HAL_GPIO_MODE_B);
-//        break;
+    case HAL_MODE_CR:
+        hal_SetAVRGPIO(HAL_GPIO_MODE_A);
+        hal_SetAVRGPIO(HAL_GPIO_MODE_B);
+        break;
+    case HAL_MODE_CP:
+        hal_ClearAVRGPIO(HAL_GPIO_MODE_A);
+        hal_SetAVRGPIO(HAL_GPIO_MODE_B);
+        break;
     }
-    hal_UpdateAVRGPIOs();
 }
 
-void hal_SelectShunt(uint8_t shunt) {
+RAMFUNC void hal_SelectShunt(uint8_t shunt) {
     switch (shunt) {
     case HAL_SHUNT_NONE:
         hal_SetAVRGPIO(HAL_GPIO_SHUNT_EN1);
@@ -486,10 +657,9 @@ void hal_SelectShunt(uint8_t shunt) {
         hal_ClearAVRGPIO(HAL_GPIO_SHUNTSEL);
         break;
     }
-    hal_UpdateAVRGPIOs();
 }
 
-void hal_SelectADCChannel(uint8_t channel) {
+RAMFUNC void hal_SelectADCChannel(uint8_t channel) {
     switch (channel) {
     case HAL_ADC_CURRENT:
         hal_ClearAVRGPIO(HAL_GPIO_ANALOG_MUX);
@@ -498,7 +668,6 @@ void hal_SelectADCChannel(uint8_t channel) {
         hal_SetAVRGPIO(HAL_GPIO_ANALOG_MUX);
         break;
     }
-    hal_UpdateAVRGPIOs();
 }
 
 uint8_t hal_isStable(void) {
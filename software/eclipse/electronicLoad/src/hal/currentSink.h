@@ -9,7 +9,11 @@
 #define CURRENTSINK_H_
 
 #include <stdint.h>
+#include <stddef.h>
 #include "stm32f10x_conf.h"
+#include "adcDual.h"
+#include "avrLink.h"
+#include "common.h"
 
 // Uses inline asm code for critical software SPI communication
 // It is *not* enough to adjust the pin definitions below if a pinchange
@@ -17,6 +21,13 @@
 // (or comment HAL_USE_ASM_SPI and use the C code)
 #define HAL_USE_ASM_SPI
 
+// Reads a second ADC on DOUT2 in the same SPI burst as the ADC on DOUT1
+// (DOUT1: current, DOUT2: voltage). Only enable this on analog boards that
+// route a second converter to PC13. On the current board PC13 is the data
+// line of the AVR (see hal_ReadAVRADC) and voltage and current are
+// multiplexed to the ADC on DOUT1.
+//#define HAL_DUAL_ADC
+
 #define HAL_CS_A_LOW        (GPIOA->BRR = GPIO_Pin_5)
 #define HAL_CS_A_HIGH       (GPIOA->BSRR = GPIO_Pin_5)
 #define HAL_CS_B_LOW        (GPIOA->BRR = GPIO_Pin_7)
@@ -28,6 +39,14 @@
 #define HAL_DOUT1           (GPIOC->IDR & GPIO_Pin_14)
 #define HAL_DOUT2           (GPIOC->IDR & GPIO_Pin_13)
 
+// Same priority as load_update() and the acquisition, the completion
+// of a DMA transfer must not interrupt their transfers.
+#define HAL_AVR_LINK_PRIORITY   4
+
+// hal_setDACDirect() may be called from interrupts up to this priority,
+// all other transfers mask them while they are running
+#define HAL_DAC_DIRECT_PRIORITY 2
+
 #define HAL_CS_NONE         0
 #define HAL_CS_DAC          1
 #define HAL_CS_ADC          2
@@ -56,8 +75,8 @@
 
 #define HAL_MODE_CC         0
 #define HAL_MODE_CV         1
-//#define HAL_MODE_CR         2
-//#define HAL_MODE_CP         3
+#define HAL_MODE_CR         2
+#define HAL_MODE_CP         3
 
 #define HAL_SHUNT_NONE      0
 #define HAL_SHUNT_R01       1
@@ -77,6 +96,12 @@ struct {
     uint8_t ADCchannel;
     uint8_t AVRgpio;
     uint8_t ADCunstable;
+    // value the DAC holds, only valid if DACvalid is set
+    uint16_t DACvalue;
+    uint8_t DACvalid;
+    // DAC transfers done resp. skipped because the value was unchanged
+    uint32_t DACwrites;
+    uint32_t DACskipped;
 } hal;
 
 /**
@@ -108,8 +133,41 @@ void hal_SetAVRGPIO(uint8_t gpio);
  */
 void hal_ClearAVRGPIO(uint8_t gpio);
 
+/**
+ * \brief Starts a transfer to the AVR
+ *
+ * Waits for the previous transfer, queues the edge sequence of the frame
+ * and returns. Timer 4 triggers the DMA which writes the clock, chip
+ * select and data edges and samples the data line of the AVR.
+ * Without HAL_AVR_LINK_DMA the frame is transferred before returning.
+ *
+ * \param word Data to send, right aligned
+ * \param bits Number of bits (8, 16 or 24)
+ * \param done Called with the received word after the transfer
+ *             (from the DMA interrupt or from hal_AVRWait), may be NULL
+ */
+void hal_AVRQueueFrame(uint32_t word, uint8_t bits, void (*done)(uint32_t));
+
+/**
+ * \brief Waits until the transfer to the AVR is complete
+ *
+ * Must be called before anything else uses the SPI lines to the
+ * analog board.
+ */
+void hal_AVRWait(void);
+
+#ifdef HAL_AVR_LINK_DMA
+void DMA1_Channel4_IRQHandler(void);
+#endif
+
 /**
  * \brief Synchronizes the AVR pins with hal.AVRgpio
+ *
+ * Queues one frame to the AVR if any pin changed since the last call,
+ * does not wait for the transfer.
+ * hal_SetControlMode, hal_SelectShunt and hal_SelectADCChannel only
+ * change hal.AVRgpio, the caller commits all changes of a tick (resp.
+ * an acquisition step) at once with this function.
  */
 void hal_UpdateAVRGPIOs(void);
 
@@ -122,6 +180,32 @@ void hal_UpdateAVRGPIOs(void);
  */
 uint16_t hal_ReadAVRADC(uint8_t channel);
 
+/**
+ * \brief Starts an ADC conversion on the AVR without waiting for it
+ *
+ * \param channel ADC channel
+ * \param done Called with the 10bit result (from the DMA interrupt or
+ *             from hal_AVRWait)
+ */
+void hal_ReadAVRADCAsync(uint8_t channel, void (*done)(uint16_t));
+
+/**
+ * \brief Converts an AVR ADC result of a temperature sensor
+ *
+ * \param raw 10bit ADC result
+ * \return temperature in °C
+ */
+uint8_t hal_ConvertTemperature(uint16_t raw);
+
+/**
+ * \brief Converts an AVR ADC result of a supply rail
+ *
+ * \param rail Rail the result belongs to
+ * \param raw 10bit ADC result
+ * \return voltage in mV
+ */
+int16_t hal_ConvertVoltageRail(uint8_t rail, uint16_t raw);
+
 /**
  * \brief Reads the corresponding ADC channel and does the temperature conversion
  *
@@ -142,10 +226,32 @@ int16_t hal_ReadVoltageRail(uint8_t rail);
 /**
  * \brief Sends a value to the DAC on the analog board
  *
+ * The transfer is skipped if the DAC already holds the value (see
+ * hal_ForceDACUpdate).
+ *
  * \param dac 16-bit DAC value
  */
 void hal_setDAC(uint16_t dac);
 
+/**
+ * \brief Sends a value to the DAC from a high priority interrupt
+ *
+ * Bypasses the cache of hal_setDAC(), the caller must not run at a
+ * lower priority than HAL_DAC_DIRECT_PRIORITY. Waits for a running
+ * frame of the AVR link.
+ *
+ * \param dac 16-bit DAC value
+ */
+void hal_setDACDirect(uint16_t dac);
+
+/**
+ * \brief Forces the next hal_setDAC() to transfer its value
+ *
+ * Even if it is unchanged. Rewrites a DAC register that might have
+ * been corrupted by a glitch on the data lines.
+ */
+void hal_ForceDACUpdate(void);
+
 /**
  * \brief Controls the fans on the analog board
  *
@@ -153,6 +259,36 @@ void hal_setDAC(uint16_t dac);
  */
 void hal_setFan(uint8_t en);
 
+/**
+ * \brief Performs a single conversion of the ADC
+ *
+ * Does not update the stability detection, see hal_CheckADCStability().
+ *
+ * \return 16-Bit ADC value
+ */
+uint16_t hal_ConvertADC(void);
+
+/**
+ * \brief Performs a single conversion of both ADCs
+ *
+ * Clocks one 24 bit burst and samples both DOUT lines on every clock
+ * cycle, giving a time aligned pair of results. Requires HAL_DUAL_ADC
+ * hardware. Does not update the stability detection.
+ *
+ * \param adc Results indexed by HAL_ADC_CURRENT/HAL_ADC_VOLTAGE
+ */
+#ifdef HAL_DUAL_ADC
+void hal_ConvertADCDual(uint16_t adc[2]);
+#endif
+
+/**
+ * \brief Updates the ADC stability detection
+ *
+ * \param min Smallest ADC value of a group of conversions
+ * \param max Largest ADC value of the same group
+ */
+void hal_CheckADCStability(uint16_t min, uint16_t max);
+
 /**
  * \brief Reads the ADC channel
  *
@@ -164,12 +300,28 @@ uint16_t hal_getADC(uint32_t nsamples);
 /**
  * \brief Sets the mux at the op-amp to a specific control mode
  *
+ * Changes are only internal, hal_UpdateAVRGPIOs should be called afterwards
+ *
  * \param mode New control mode (0=CC, 1=CV, 2=CR, 3=CP)
  */
 void hal_SetControlMode(uint8_t mode);
 
+/**
+ * \brief Selects the active shunt
+ *
+ * Changes are only internal, hal_UpdateAVRGPIOs should be called afterwards
+ *
+ * \param shunt HAL_SHUNT_NONE, HAL_SHUNT_R01 or HAL_SHUNT_1R
+ */
 void hal_SelectShunt(uint8_t shunt);
 
+/**
+ * \brief Switches the analog mux in front of the ADC
+ *
+ * Changes are only internal, hal_UpdateAVRGPIOs should be called afterwards
+ *
+ * \param channel HAL_ADC_CURRENT or HAL_ADC_VOLTAGE
+ */
 void hal_SelectADCChannel(uint8_t channel);
 
 uint8_t hal_isStable(void);
@@ -5,6 +5,57 @@
  */
 #include "display.h"
 
+// bit set/reset register word that sets the pin if the bit is set in
+// the data byte and resets it otherwise
+#define HAL_DISPLAY_BSRR(data, bit, pin) \
+        (((data) & (bit)) ? (uint32_t) (pin) : (uint32_t) (pin) << 16)
+
+#define HAL_DISPLAY_BUS(d) { \
+        HAL_DISPLAY_BSRR(d, 0x02, HAL_DISPLAY_DB1_PIN) \
+        | HAL_DISPLAY_BSRR(d, 0x20, HAL_DISPLAY_DB5_PIN) \
+        | HAL_DISPLAY_BSRR(d, 0x40, HAL_DISPLAY_DB6_PIN) \
+        | HAL_DISPLAY_BSRR(d, 0x80, HAL_DISPLAY_DB7_PIN), \
+        HAL_DISPLAY_BSRR(d, 0x01, HAL_DISPLAY_DB0_PIN), \
+        HAL_DISPLAY_BSRR(d, 0x04, HAL_DISPLAY_DB2_PIN) \
+        | HAL_DISPLAY_BSRR(d, 0x08, HAL_DISPLAY_DB3_PIN) \
+        | HAL_DISPLAY_BSRR(d, 0x10, HAL_DISPLAY_DB4_PIN) }
+#define HAL_DISPLAY_BUS4(d) HAL_DISPLAY_BUS(d), HAL_DISPLAY_BUS(d + 1), \
+        HAL_DISPLAY_BUS(d + 2), HAL_DISPLAY_BUS(d + 3)
+#define HAL_DISPLAY_BUS16(d) HAL_DISPLAY_BUS4(d), HAL_DISPLAY_BUS4(d + 4), \
+        HAL_DISPLAY_BUS4(d + 8), HAL_DISPLAY_BUS4(d + 12)
+#define HAL_DISPLAY_BUS64(d) HAL_DISPLAY_BUS16(d), \
+        HAL_DISPLAY_BUS16(d + 16), HAL_DISPLAY_BUS16(d + 32), \
+        HAL_DISPLAY_BUS16(d + 48)
+
+const struct displayBus hal_displayBus[256] = { HAL_DISPLAY_BUS64(0),
+        HAL_DISPLAY_BUS64(64), HAL_DISPLAY_BUS64(128), HAL_DISPLAY_BUS64(192) };
+
+/**
+ * \brief Applies a command or data byte and the DI, RW and chip select
+ * lines
+ *
+ * \param data Databyte for the display data bus
+ * \param control HAL_DISPLAY_WRITE_COMMAND or HAL_DISPLAY_WRITE_DATA
+ * \param select HAL_DISPLAY_SELECT_1, HAL_DISPLAY_SELECT_2 or 0 to keep
+ *               the selection
+ */
+static inline void hal_DisplayWriteBus(uint8_t data, uint32_t control,
+        uint32_t select) {
+    const struct displayBus *bus = &hal_displayBus[data];
+    GPIOA->BSRR = bus->a | select;
+    GPIOB->BSRR = bus->b | control;
+    GPIOC->BSRR = bus->c;
+}
+
+/**
+ * \brief Latches the byte on the bus with an enable pulse
+ */
+static inline void hal_DisplayPulse(void) {
+    HAL_DISPLAY_E_HIGH;
+    timer_waitCycles(HAL_DISPLAY_E_CYCLES);
+    HAL_DISPLAY_E_LOW;
+}
+
 /**
  * \brief Initializes display related hardware
  */
@@ -40,44 +91,139 @@ void hal_displayInit(void) {
     HAL_DISPLAY_RST_HIGH;
     HAL_DISPLAY_BL_ON;
 
-    display.updateTime = 0;
+    // the display RAM content is undefined after reset
+    hal_DisplayInvalidate();
     hal_SelectDisplay1();
     hal_DisplayCommand(DISPLAY_ON_CMD);
     hal_SelectDisplay2();
     hal_DisplayCommand(DISPLAY_ON_CMD);
-    hal_updateDisplay();
+}
+
+/**
+ * \brief Puts the next byte of the transfer on the bus
+ *
+ * Walks through the columns marked in display.dirty. Each page half
+ * starts with selecting the controller and setting the page, gaps in
+ * the marked columns are skipped by setting the address. Consecutive
+ * columns are written without addressing, since the controller
+ * increments its address pointer after each write.
+ *
+ * \return 0 if the transfer is complete, 1 otherwise
+ */
+static uint8_t hal_DisplayNextByte(void) {
+    while (!display.transfer.dirty) {
+        uint8_t next = display.transfer.next;
+        if (next >= 16)
+            return 0;
+        display.transfer.next++;
+        display.transfer.page = next >> 1;
+        display.transfer.half = next & 1;
+        // screen_Commit() runs with lower priority and doesn't change
+        // the front buffer during the transfer
+        display.transfer.dirty = display.dirty[next >> 1][next & 1];
+        display.dirty[next >> 1][next & 1] = 0;
+        if (display.transfer.dirty) {
+            // selected together with the page command
+            if (display.transfer.half)
+                display.transfer.select = HAL_DISPLAY_SELECT_2;
+            else
+                display.transfer.select = HAL_DISPLAY_SELECT_1;
+            // initially unknown
+            display.transfer.address = 0xF0;
+            display.transfer.setPage = 1;
+        }
+    }
+    if (display.transfer.setPage) {
+        display.transfer.setPage = 0;
+        hal_DisplayWriteBus(DISPLAY_SET_PAGE | display.transfer.page,
+                HAL_DISPLAY_WRITE_COMMAND, display.transfer.select);
+        return 1;
+    }
+    const uint8_t *data = &display.front[display.transfer.page * 128
+            + display.transfer.half * 64];
+    uint8_t x = __builtin_ctzll(display.transfer.dirty);
+    uint8_t address = display.transfer.address;
+    if (x == address + 1) {
+        // rewriting a single unchanged column costs as much
+        // as setting the address
+        hal_DisplayWriteBus(data[address], HAL_DISPLAY_WRITE_DATA, 0);
+        display.transfer.address++;
+    } else if (x != address) {
+        hal_DisplayWriteBus(DISPLAY_SET_ADDRESS | x,
+                HAL_DISPLAY_WRITE_COMMAND, 0);
+        display.transfer.address = x;
+    } else {
+        hal_DisplayWriteBus(data[x], HAL_DISPLAY_WRITE_DATA, 0);
+        display.transfer.address++;
+        display.transfer.dirty &= display.transfer.dirty - 1;
+    }
+    return 1;
+}
+
+/**
+ * \brief Executes one step of the transfer
+ *
+ * Called from timer 3. Latches the byte on the bus and puts the next
+ * byte on the bus. The step interval provides the setup time and the
+ * low time of the enable line.
+ *
+ * \return 0 if the transfer is complete, 1 otherwise
+ */
+static uint8_t hal_DisplayStep(void) {
+    uint32_t start = timer_GetCycles();
+    hal_DisplayPulse();
+    display.transfer.bytes++;
+    uint8_t more = hal_DisplayNextByte();
+    uint32_t end = timer_GetCycles();
+    display.transfer.stepCycles += end - start;
+    if (more)
+        return 1;
+    display.lastTransfer.stepCycles = display.transfer.stepCycles;
+    display.lastTransfer.duration = end - display.transfer.start;
+    display.lastTransfer.bytes = display.transfer.bytes;
+    display.transfer.running = 0;
+    return 0;
 }
 
 /**
  * \brief Transfers buffer content to display RAM
  *
- * This function transfers the complete buffer (1kB)
- * to the display. Should be called regularly to achieve
+ * This function starts the transfer of the committed
+ * columns marked in display.dirty to the display and
+ * returns. Nothing is transferred while a frame is
+ * being committed or if nothing changed.
+ * The bytes are transferred in steps called from
+ * timer 3, thus it must be called after timer 3 was
+ * set up. Should be called regularly to achieve
  * constant framerate
  */
 void hal_updateDisplay(void) {
-    // TODO instead of calling this function and then checking
-    // for updateTime, implement a call from an interrupt only when
-    // updateTime is reached
-    if (timer_TimeoutElapsed(display.updateTime)) {
-        display.updateTime = UINT32_MAX;
-        uint8_t page;
-        uint8_t x;
-        for (page = 0; page < 8; page++) {
-            for (x = 0; x < 128; x++) {
-                if (x == 0) {
-                    hal_SelectDisplay1();
-                    hal_DisplaySetPage(page);
-                    hal_DisplaySetAddress(x);
-                }
-                if (x == 64) {
-                    hal_SelectDisplay2();
-                    hal_DisplaySetPage(page);
-                    hal_DisplaySetAddress(x - 64);
-                }
-                hal_DisplayWriteData(display.buffer[x + page * 128]);
-            }
-        }
+    if (display.transfer.running || display.committing)
+        return;
+    uint32_t start = timer_GetCycles();
+    display.transfer.next = 0;
+    display.transfer.dirty = 0;
+    display.transfer.bytes = 0;
+    if (!hal_DisplayNextByte())
+        return;
+    display.transfer.start = start;
+    display.transfer.stepCycles = timer_GetCycles() - start;
+    display.transfer.running = 1;
+    if (timer_SetupStepFunction(HAL_DISPLAY_STEP_US, hal_DisplayStep)) {
+        // timer 3 is not running, try again with the complete buffer
+        display.transfer.running = 0;
+        hal_DisplayInvalidate();
+    }
+}
+
+/**
+ * \brief Marks the complete front buffer for the next transfer
+ */
+void hal_DisplayInvalidate(void) {
+    uint8_t page;
+    for (page = 0; page < 8; page++) {
+        display.dirty[page][0] = UINT64_MAX;
+        display.dirty[page][1] = UINT64_MAX;
     }
 }
 
@@ -85,43 +231,16 @@ void hal_updateDisplay(void) {
  * \brief Applies a data byte to the display data bus
  *
  * Since the display data bus is not mapped to one port,
- * each bit will be set individually in this function
+ * one precomputed word (see hal_displayBus) is written
+ * to each of the three ports
  *
  * \param data Databyte for the display data bus
  */
 void hal_DisplaySetDatabus(uint8_t data) {
-    if (data & 0x80)
-        HAL_DISPLAY_DB7_HIGH;
-    else
-        HAL_DISPLAY_DB7_LOW;
-    if (data & 0x40)
-        HAL_DISPLAY_DB6_HIGH;
-    else
-        HAL_DISPLAY_DB6_LOW;
-    if (data & 0x20)
-        HAL_DISPLAY_DB5_HIGH;
-    else
-        HAL_DISPLAY_DB5_LOW;
-    if (data & 0x10)
-        HAL_DISPLAY_DB4_HIGH;
-    else
-        HAL_DISPLAY_DB4_LOW;
-    if (data & 0x08)
-        HAL_DISPLAY_DB3_HIGH;
-    else
-        HAL_DISPLAY_DB3_LOW;
-    if (data & 0x04)
-        HAL_DISPLAY_DB2_HIGH;
-    else
-        HAL_DISPLAY_DB2_LOW;
-    if (data & 0x02)
-        HAL_DISPLAY_DB1_HIGH;
-    else
-        HAL_DISPLAY_DB1_LOW;
-    if (data & 0x01)
-        HAL_DISPLAY_DB0_HIGH;
-    else
-        HAL_DISPLAY_DB0_LOW;
+    const struct displayBus *bus = &hal_displayBus[data];
+    GPIOA->BSRR = bus->a;
+    GPIOB->BSRR = bus->b;
+    GPIOC->BSRR = bus->c;
 }
 
 /**
@@ -131,13 +250,8 @@ void hal_DisplaySetDatabus(uint8_t data) {
  */
 void hal_DisplayCommand(uint8_t command) {
     timer_waitus(2);
-    hal_DisplaySetDatabus(command);
-    HAL_DISPLAY_DI_LOW;
-    HAL_DISPLAY_RW_LOW;
-    HAL_DISPLAY_E_HIGH;
-    HAL_DISPLAY_E_HIGH;
-    timer_waitus(2);
-    HAL_DISPLAY_E_LOW;
+    hal_DisplayWriteBus(command, HAL_DISPLAY_WRITE_COMMAND, 0);
+    hal_DisplayPulse();
 }
 
 /**
@@ -178,12 +292,8 @@ void hal_DisplaySetStartline(uint8_t startline) {
  */
 void hal_DisplayWriteData(uint8_t data) {
     timer_waitus(2);
-    hal_DisplaySetDatabus(data);
-    HAL_DISPLAY_DI_HIGH;
-    HAL_DISPLAY_RW_LOW;
-    HAL_DISPLAY_E_HIGH;
-    timer_waitus(2);
-    HAL_DISPLAY_E_LOW;
+    hal_DisplayWriteBus(data, HAL_DISPLAY_WRITE_DATA, 0);
+    hal_DisplayPulse();
 }
 
 /**
@@ -25,35 +25,45 @@
 #define HAL_DISPLAY_CS1_HIGH	GPIO_WriteBit(GPIOA, GPIO_Pin_9, Bit_SET)
 #define HAL_DISPLAY_CS2_LOW		GPIO_WriteBit(GPIOA, GPIO_Pin_8, Bit_RESET)
 #define HAL_DISPLAY_CS2_HIGH	GPIO_WriteBit(GPIOA, GPIO_Pin_8, Bit_SET)
-#define HAL_DISPLAY_E_LOW		GPIO_WriteBit(GPIOD, GPIO_Pin_2, Bit_RESET)
-#define HAL_DISPLAY_E_HIGH		GPIO_WriteBit(GPIOD, GPIO_Pin_2, Bit_SET)
+// pulsed in every step of the transfer, thus written directly
+#define HAL_DISPLAY_E_LOW		(GPIOD->BRR = GPIO_Pin_2)
+#define HAL_DISPLAY_E_HIGH		(GPIOD->BSRR = GPIO_Pin_2)
 #define HAL_DISPLAY_RW_LOW		GPIO_WriteBit(GPIOB, GPIO_Pin_4, Bit_RESET)
 #define HAL_DISPLAY_RW_HIGH		GPIO_WriteBit(GPIOB, GPIO_Pin_4, Bit_SET)
 #define HAL_DISPLAY_DI_LOW		GPIO_WriteBit(GPIOB, GPIO_Pin_5, Bit_RESET)
 #define HAL_DISPLAY_DI_HIGH		GPIO_WriteBit(GPIOB, GPIO_Pin_5, Bit_SET)
 
-#define HAL_DISPLAY_DB0_LOW		GPIO_WriteBit(GPIOB, GPIO_Pin_3, Bit_RESET)
-#define HAL_DISPLAY_DB0_HIGH	GPIO_WriteBit(GPIOB, GPIO_Pin_3, Bit_SET)
-#define HAL_DISPLAY_DB1_LOW		GPIO_WriteBit(GPIOA, GPIO_Pin_15, Bit_RESET)
-#define HAL_DISPLAY_DB1_HIGH	GPIO_WriteBit(GPIOA, GPIO_Pin_15, Bit_SET)
-#define HAL_DISPLAY_DB2_LOW		GPIO_WriteBit(GPIOC, GPIO_Pin_10, Bit_RESET)
-#define HAL_DISPLAY_DB2_HIGH	GPIO_WriteBit(GPIOC, GPIO_Pin_10, Bit_SET)
-#define HAL_DISPLAY_DB3_LOW		GPIO_WriteBit(GPIOC, GPIO_Pin_11, Bit_RESET)
-#define HAL_DISPLAY_DB3_HIGH	GPIO_WriteBit(GPIOC, GPIO_Pin_11, Bit_SET)
-#define HAL_DISPLAY_DB4_LOW		GPIO_WriteBit(GPIOC, GPIO_Pin_12, Bit_RESET)
-#define HAL_DISPLAY_DB4_HIGH	GPIO_WriteBit(GPIOC, GPIO_Pin_12, Bit_SET)
-#define HAL_DISPLAY_DB5_LOW		GPIO_WriteBit(GPIOA, GPIO_Pin_12, Bit_RESET)
-#define HAL_DISPLAY_DB5_HIGH	GPIO_WriteBit(GPIOA, GPIO_Pin_12, Bit_SET)
-#define HAL_DISPLAY_DB6_LOW		GPIO_WriteBit(GPIOA, GPIO_Pin_11, Bit_RESET)
-#define HAL_DISPLAY_DB6_HIGH	GPIO_WriteBit(GPIOA, GPIO_Pin_11, Bit_SET)
-#define HAL_DISPLAY_DB7_LOW		GPIO_WriteBit(GPIOA, GPIO_Pin_10, Bit_RESET)
-#define HAL_DISPLAY_DB7_HIGH	GPIO_WriteBit(GPIOA, GPIO_Pin_10, Bit_SET)
+// data bus DB0-DB7, spread over three ports
+#define HAL_DISPLAY_DB0_PIN     GPIO_Pin_3  // GPIOB
+#define HAL_DISPLAY_DB1_PIN     GPIO_Pin_15 // GPIOA
+#define HAL_DISPLAY_DB2_PIN     GPIO_Pin_10 // GPIOC
+#define HAL_DISPLAY_DB3_PIN     GPIO_Pin_11 // GPIOC
+#define HAL_DISPLAY_DB4_PIN     GPIO_Pin_12 // GPIOC
+#define HAL_DISPLAY_DB5_PIN     GPIO_Pin_12 // GPIOA
+#define HAL_DISPLAY_DB6_PIN     GPIO_Pin_11 // GPIOA
+#define HAL_DISPLAY_DB7_PIN     GPIO_Pin_10 // GPIOA
+
+// DI and RW (port B) for writing a command resp. data byte, combined
+// with the port B word of the data bus
+#define HAL_DISPLAY_WRITE_COMMAND   ((uint32_t) (GPIO_Pin_5 | GPIO_Pin_4) << 16)
+#define HAL_DISPLAY_WRITE_DATA      (GPIO_Pin_5 | (uint32_t) GPIO_Pin_4 << 16)
+
+// CS1 resp. CS2 (port A) for selecting a controller, combined with the
+// port A word of the data bus
+#define HAL_DISPLAY_SELECT_1        (GPIO_Pin_9 | (uint32_t) GPIO_Pin_8 << 16)
+#define HAL_DISPLAY_SELECT_2        (GPIO_Pin_8 | (uint32_t) GPIO_Pin_9 << 16)
 
 #define HAL_DISPLAY_BL_ON       GPIO_WriteBit(GPIOC, GPIO_Pin_8, Bit_SET)
 #define HAL_DISPLAY_BL_OFF      GPIO_WriteBit(GPIOC, GPIO_Pin_8, Bit_RESET)
 
 /** \} */
 
+// time in us between two steps of the transfer, each step transfers
+// one byte (the enable cycle of the controller is at least 1us)
+#define HAL_DISPLAY_STEP_US     4
+// minimum enable pulse width of the controller (450ns) in CPU cycles
+#define HAL_DISPLAY_E_CYCLES    33
+
 /**
  * \name Display commands
  * \{
@@ -65,6 +75,23 @@
 #define DISPLAY_SET_STARTLINE	0b11000000
 /** \} */
 
+/**
+ * \brief Port bit set/reset register words for a data bus byte
+ */
+struct displayBus {
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+
+/**
+ * \brief Data bus words for every byte value
+ *
+ * Each word sets the data bus pins of its port that are 1 in the byte
+ * and resets the others. Other pins are left unchanged.
+ */
+extern const struct displayBus hal_displayBus[256];
+
 struct {
     /**
      * \brief Contains the display data
@@ -74,9 +101,68 @@ struct {
      * Each byte represents an 8-bit vertical line. First
      * row (page) is mapped to buffer[0-127], second row
      * to buffer[128-255] ...
+     * The screen functions draw into this buffer, it is
+     * transferred after screen_Commit().
      */
     uint8_t buffer[1024];
-    uint32_t updateTime;
+    /**
+     * \brief Committed frame
+     *
+     * Same layout as buffer. Only changed by screen_Commit(),
+     * the transfer reads from here.
+     */
+    uint8_t front[1024];
+    /**
+     * \brief Columns of the front buffer that have not been
+     * transferred yet
+     *
+     * One bit per column of each page and controller half:
+     * bit n of dirty[page][half] represents front[page * 128
+     * + half * 64 + n]. Set by screen_Commit(), cleared
+     * by hal_updateDisplay().
+     */
+    uint64_t dirty[8][2];
+    // screen_Commit() is changing the front buffer
+    volatile uint8_t committing;
+    /**
+     * \brief State of the running transfer
+     *
+     * The transfer is split into steps that are called from
+     * timer 3 (see hal_updateDisplay()).
+     */
+    struct {
+        // remaining columns of the current page half
+        uint64_t dirty;
+        // next page half to check (page * 2 + half)
+        uint8_t next;
+        uint8_t page;
+        uint8_t half;
+        // address pointer of the selected controller
+        uint8_t address;
+        // HAL_DISPLAY_SELECT_1 or HAL_DISPLAY_SELECT_2
+        uint32_t select;
+        // the page command is the next byte
+        uint8_t setPage;
+        volatile uint8_t running;
+        // cycle counter at the start, cycles spent in the steps and
+        // transferred bytes so far
+        uint32_t start;
+        uint32_t stepCycles;
+        uint16_t bytes;
+    } transfer;
+    /**
+     * \brief CPU time of the last complete transfer
+     *
+     * Measured with the cycle counter. The steps took stepCycles of the
+     * duration, the rest was left to thread mode and the other
+     * interrupts. The interrupt entry and exit and the rescheduling of
+     * the steps are not included.
+     */
+    struct {
+        uint32_t stepCycles;
+        uint32_t duration;
+        uint16_t bytes;
+    } lastTransfer;
 } display;
 
 /**
@@ -87,17 +173,28 @@ void hal_displayInit(void);
 /**
  * \brief Transfers buffer content to display RAM
  *
- * This function transfers the complete buffer (1kB)
- * to the display. Should be called regularly to achieve
+ * This function starts the transfer of the committed
+ * columns marked in display.dirty to the display and
+ * returns. Nothing is transferred while a frame is
+ * being committed or if nothing changed.
+ * The bytes are transferred in steps called from
+ * timer 3, thus it must be called after timer 3 was
+ * set up. Should be called regularly to achieve
  * constant framerate
  */
 void hal_updateDisplay(void);
 
+/**
+ * \brief Marks the complete front buffer for the next transfer
+ */
+void hal_DisplayInvalidate(void);
+
 /**
  * \brief Applies a data byte to the display data bus
  *
  * Since the display data bus is not mapped to one port,
- * each bit will be set individually in this function
+ * one precomputed word (see hal_displayBus) is written
+ * to each of the three ports
  *
  * \param data Databyte for the display data bus
  */
@@ -106,6 +203,9 @@ void hal_DisplaySetDatabus(uint8_t data);
 /**
  * \brief Transmits a command to the display
  *
+ * Waits for the display, only intended for the
+ * initialization. Must not be called during a transfer.
+ *
  * \param command Display command
  */
 void hal_DisplayCommand(uint8_t command);
@@ -138,6 +238,9 @@ void hal_DisplaySetStartline(uint8_t startline);
 /**
  * \brief Writes one byte of data to the display RAM
  *
+ * Waits for the display, must not be called during a
+ * transfer.
+ *
  * \param data Databyte to be transmitted
  */
 void hal_DisplayWriteData(uint8_t data);
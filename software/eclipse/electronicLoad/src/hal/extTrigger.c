@@ -35,7 +35,7 @@ void hal_triggerInit(void) {
  *
  * \param state 1: trigger output high (3,3V), 0: trigger output low (0V)
  */
-void hal_setTriggerOut(uint8_t state) {
+RAMFUNC void hal_setTriggerOut(uint8_t state) {
     if (state) {
         EXT_TRIGGER_HIGH;
     } else {
@@ -43,7 +43,7 @@ void hal_setTriggerOut(uint8_t state) {
     }
 }
 
-uint8_t hal_getTriggerIn(void){
+RAMFUNC uint8_t hal_getTriggerIn(void){
     if(EXT_TRIGGER_IN)
         return 1;
     else
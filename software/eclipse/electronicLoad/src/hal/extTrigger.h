@@ -10,6 +10,7 @@
 
 #include <stdlib.h>
 #include "stm32f10x.h"
+#include "common.h"
 
 #define EXT_TRIGGER_HIGH        GPIOA->BSRR = GPIO_Pin_6
 #define EXT_TRIGGER_LOW         GPIOA->BRR = GPIO_Pin_6
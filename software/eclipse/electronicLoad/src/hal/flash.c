@@ -0,0 +1,93 @@
+/**
+ * \file
+ * \brief   Flash programming hardware abstraction layer source file.
+ *
+ *          Erases and programs the flash while the control loop keeps
+ *          running. The CPU stalls on every read from the flash while
+ *          an operation is in progress, thus these functions wait in RAM
+ *          and only the interrupts with their code in RAM (see RAMFUNC)
+ *          are taken meanwhile.
+ */
+#include "flash.h"
+#include "avrLink.h"
+#include "stm32f10x.h"
+
+// interrupts whose handlers and everything they call are in RAM: the
+// control loop (timer 2), the system time and the dynamic mode (timer 1)
+// and, when enabled, the AVR link (DMA1 channel 4). The acquisition uses
+// SysTick, an exception which is not affected.
+#ifdef HAL_AVR_LINK_DMA
+#define HAL_FLASH_RAM_IRQS      ((1UL << TIM1_UP_IRQn) \
+        | (1UL << TIM1_CC_IRQn) | (1UL << TIM2_IRQn) \
+        | (1UL << DMA1_Channel4_IRQn))
+#else
+#define HAL_FLASH_RAM_IRQS      ((1UL << TIM1_UP_IRQn) \
+        | (1UL << TIM1_CC_IRQn) | (1UL << TIM2_IRQn))
+#endif
+
+/**
+ * \brief Disables the interrupts whose handlers are in flash
+ *
+ * \param disabled Returns the interrupts to enable again with
+ *                 hal_FlashRelease()
+ */
+static inline RAMFUNC void hal_FlashHoldOff(uint32_t disabled[2]) {
+    disabled[0] = NVIC->ISER[0] & ~HAL_FLASH_RAM_IRQS;
+    disabled[1] = NVIC->ISER[1];
+    NVIC->ICER[0] = disabled[0];
+    NVIC->ICER[1] = disabled[1];
+    __DSB();
+    __ISB();
+}
+
+static inline RAMFUNC void hal_FlashRelease(const uint32_t disabled[2]) {
+    // interrupts that became pending meanwhile are taken now
+    NVIC->ISER[0] = disabled[0];
+    NVIC->ISER[1] = disabled[1];
+}
+
+/**
+ * \brief Waits for the end of the running operation
+ *
+ * \return 0 on success, 1 on a programming or write protection error
+ */
+static inline RAMFUNC uint8_t hal_FlashWait(void) {
+    while (FLASH->SR & FLASH_SR_BSY)
+        ;
+    uint8_t error = (FLASH->SR & (FLASH_SR_PGERR | FLASH_SR_WRPRTERR)) ?
+            1 : 0;
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
+    return error;
+}
+
+RAMFUNC uint8_t hal_FlashErasePage(uint32_t address) {
+    uint32_t disabled[2];
+    hal_FlashHoldOff(disabled);
+    FLASH->CR |= FLASH_CR_PER;
+    FLASH->AR = address;
+    FLASH->CR |= FLASH_CR_STRT;
+    uint8_t error = hal_FlashWait();
+    FLASH->CR &= ~FLASH_CR_PER;
+    hal_FlashRelease(disabled);
+    return error;
+}
+
+RAMFUNC uint8_t hal_FlashProgramWord(uint32_t address, uint32_t data) {
+    uint32_t disabled[2];
+    hal_FlashHoldOff(disabled);
+    // the flash is programmed in half words
+    FLASH->CR |= FLASH_CR_PG;
+    *(volatile uint16_t*) address = data;
+    uint8_t error = hal_FlashWait();
+    if (!error) {
+        *(volatile uint16_t*) (address + 2) = data >> 16;
+        error = hal_FlashWait();
+    }
+    FLASH->CR &= ~FLASH_CR_PG;
+    hal_FlashRelease(disabled);
+    return error;
+}
+
+RAMFUNC uint8_t hal_FlashBusy(void) {
+    return (FLASH->SR & FLASH_SR_BSY) ? 1 : 0;
+}
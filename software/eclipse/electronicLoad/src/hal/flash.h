@@ -0,0 +1,50 @@
+/**
+ * \file
+ * \brief   Flash programming hardware abstraction layer header file.
+ *
+ *          Erases and programs the flash while the control loop keeps
+ *          running. The CPU stalls on every read from the flash while
+ *          an operation is in progress, thus these functions wait in RAM
+ *          and only the interrupts with their code in RAM (see RAMFUNC)
+ *          are taken meanwhile.
+ */
+#ifndef HAL_FLASH_H_
+#define HAL_FLASH_H_
+
+#include <stdint.h>
+#include "common.h"
+
+/**
+ * \brief Erases a flash page
+ *
+ * The flash must be unlocked. Interrupts whose handlers are in flash
+ * are held off until the page is erased (up to 40ms).
+ *
+ * \param address Address within the page
+ * \return 0 on success, 1 on a programming or write protection error
+ */
+uint8_t hal_FlashErasePage(uint32_t address);
+
+/**
+ * \brief Programs a word of erased flash
+ *
+ * The flash must be unlocked. Interrupts whose handlers are in flash
+ * are held off while the two half words are programmed.
+ *
+ * \param address Address of the word
+ * \param data Word to program
+ * \return 0 on success, 1 on a programming or write protection error
+ */
+uint8_t hal_FlashProgramWord(uint32_t address, uint32_t data);
+
+/**
+ * \brief Checks for a running erase or program operation
+ *
+ * Allows interrupt handlers to skip code and constants in the flash
+ * while the CPU would stall on them.
+ *
+ * \return 1 while an operation is in progress, 0 otherwise
+ */
+uint8_t hal_FlashBusy(void);
+
+#endif
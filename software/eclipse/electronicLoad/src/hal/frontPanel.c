@@ -61,7 +61,7 @@ void hal_frontPanelInit(void) {
  * low priority interrupt. Performs a user-button multiplex
  * cycle and handles the encoder counter
  */
-void hal_frontPanelUpdate(void) {
+FLASHFUNC void hal_frontPanelUpdate(void) {
     // crude debouncing (only check buttons on every 20th call)
     static uint8_t cnt = 0;
     cnt++;
@@ -34,6 +34,54 @@ void timer_Init(void) {
     nvic.NVIC_IRQChannelPreemptionPriority = 0;
     NVIC_Init(&nvic);
 
+    // enable the cycle counter (used for profiling)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    TIMER_DWT_CYCCNT = 0;
+    TIMER_DWT_CTRL |= TIMER_DWT_CTRL_CYCCNTENA;
+}
+
+/**
+ * \brief Returns the number of CPU cycles since timer_Init()
+ *
+ * Free running 32 bit counter, overflows after ~59s at 72MHz.
+ * Only use the difference of two values.
+ */
+RAMFUNC uint32_t timer_GetCycles(void) {
+    return TIMER_DWT_CYCCNT;
+}
+
+/**
+ * \brief Waits for a number of CPU cycles
+ *
+ * For delays below 1us, uses the cycle counter.
+ *
+ * \param cycles Minimum number of cycles to wait
+ */
+void timer_waitCycles(uint32_t cycles) {
+    uint32_t start = TIMER_DWT_CYCCNT;
+    while (TIMER_DWT_CYCCNT - start < cycles)
+        ;
+}
+
+/**
+ * \brief Returns the system time in microseconds
+ *
+ * Combines timer.ms with the counter of timer 1. Overflows
+ * after ~71 minutes, only use the difference of two values.
+ */
+RAMFUNC uint32_t timer_GetTimeus(void) {
+    uint32_t ms;
+    uint16_t us;
+    do {
+        ms = timer.ms;
+        us = TIM1->CNT;
+    } while (ms != timer.ms);
+    if ((TIM1->SR & TIM_SR_UIF) && us < 500) {
+        // counter already overflowed but the interrupt
+        // has not yet incremented timer.ms
+        ms++;
+    }
+    return ms * 1000 + us;
 }
 
 /**
@@ -57,7 +105,7 @@ void timer_waitms(uint16_t ms) {
  *
  * \param us waittime in mikroseconds (maximum waittime is 999us)
  */
-void timer_waitus(uint16_t us) {
+RAMFUNC void timer_waitus(uint16_t us) {
     uint16_t timeStart = TIM1->CNT;
     uint32_t timems = timer.ms;
     uint16_t timeEnd = timeStart + us;
@@ -173,23 +221,159 @@ uint8_t timer_SetupPeriodicFunction(uint8_t timerNumber, uint32_t period,
     return 0;
 }
 
-void TIM1_UP_IRQHandler(void) {
-    if (TIM_GetITStatus(TIM1, TIM_IT_Update) == SET) {
-        TIM_ClearITPendingBit(TIM1, TIM_IT_Update);
+/**
+ * \brief Sets up a regularly called function using the SysTick timer
+ *
+ * Intended for short tasks that have to run more often than once per
+ * millisecond.
+ *
+ * \param period        Number of systicks between function calls
+ *                      (at most 2^24)
+ * \param callback      Pointer to function that will be called
+ * \param priority      Priority of interrupt from which the function
+ *                      will be called
+ */
+uint8_t timer_SetupSysTickFunction(uint32_t period, void (*callback)(),
+        uint8_t priority) {
+    if (priority > 15)
+        return 1;
+    timer.sysTickCallback = callback;
+    if (SysTick_Config(period))
+        return 1;
+    // SysTick_Config() sets the lowest priority
+    NVIC_SetPriority(SysTick_IRQn, priority);
+    return 0;
+}
+
+/**
+ * \brief Sets the next compare event
+ *
+ * \param us Time in us from the previous to the next event
+ */
+static RAMFUNC void timer_ScheduleCompare(uint32_t us) {
+    uint16_t base = timer.compareBase;
+    // timer 1 overflows every ms, longer intervals wait for several
+    // matches of the same compare value
+    timer.compareWait = (us - 1) / 1000;
+    timer.compareBase = (base + us) % 1000;
+    uint16_t ccr = timer.compareBase;
+    if (!timer.compareWait) {
+        uint16_t elapsed = (TIM1->CNT + 1000 - base) % 1000;
+        if (elapsed + 2 >= us) {
+            // the event is (almost) late, generate it as soon as possible
+            ccr = (TIM1->CNT + 2) % 1000;
+        }
+    }
+    TIM1->CCR1 = ccr;
+}
+
+RAMFUNC uint8_t timer_SetupCompareFunction(uint32_t delay,
+        uint32_t (*callback)(void), uint8_t priority) {
+    if (priority > 15 || delay < 2)
+        return 1;
+    TIM1->DIER &= ~TIM_DIER_CC1IE;
+    timer.compareCallback = callback;
+
+    // NVIC_Init() is in flash, the dynamic mode may start while the
+    // flash is busy
+    NVIC_SetPriority(TIM1_CC_IRQn, priority);
+    NVIC_EnableIRQ(TIM1_CC_IRQn);
+
+    timer.compareBase = TIM1->CNT;
+    timer_ScheduleCompare(delay);
+    TIM1->SR = ~TIM_SR_CC1IF;
+    TIM1->DIER |= TIM_DIER_CC1IE;
+    return 0;
+}
+
+RAMFUNC void timer_StopCompareFunction(void) {
+    TIM1->DIER &= ~TIM_DIER_CC1IE;
+    timer.compareCallback = 0;
+}
+
+/**
+ * \brief Sets the next compare event of the step function
+ *
+ * The interval starts now, the interrupt latency of the previous call
+ * only delays the following steps.
+ */
+static void timer_ScheduleStep(void) {
+    uint32_t period = TIM3->ARR + 1;
+    uint32_t start = TIM3->CNT;
+    // the interval is shorter than the period, no division needed
+    uint32_t compare = start + timer.stepTicks;
+    if (compare >= period)
+        compare -= period;
+    TIM3->CCR1 = compare;
+    // the counter might have passed the compare value meanwhile
+    uint32_t now = TIM3->CNT;
+    if (now < start)
+        now += period;
+    if (now - start >= timer.stepTicks)
+        TIM3->EGR = TIM_EGR_CC1G;
+}
+
+uint8_t timer_SetupStepFunction(uint16_t interval, uint8_t (*callback)(void)) {
+    if (!timer.callbacks[1])
+        return 1;
+    TIM3->DIER &= ~TIM_DIER_CC1IE;
+    timer.stepCallback = callback;
+    timer.stepTicks = (uint32_t) interval * 72 / (TIM3->PSC + 1);
+    if (!timer.stepTicks)
+        timer.stepTicks = 1;
+    TIM3->SR = ~TIM_SR_CC1IF;
+    timer_ScheduleStep();
+    TIM3->DIER |= TIM_DIER_CC1IE;
+    return 0;
+}
+
+RAMFUNC void SysTick_Handler(void) {
+    if (timer.sysTickCallback)
+        timer.sysTickCallback();
+}
+
+RAMFUNC void TIM1_UP_IRQHandler(void) {
+    if (TIM1->SR & TIM_SR_UIF) {
+        TIM1->SR = ~TIM_SR_UIF;
         timer.ms++;
     }
 }
 
-void TIM2_IRQHandler(void) {
-    if (TIM_GetITStatus(TIM2, TIM_IT_Update) == SET) {
-        TIM_ClearITPendingBit(TIM2, TIM_IT_Update);
+RAMFUNC void TIM1_CC_IRQHandler(void) {
+    if (TIM1->SR & TIM_SR_CC1IF) {
+        TIM1->SR = ~TIM_SR_CC1IF;
+        if (timer.compareWait) {
+            timer.compareWait--;
+            return;
+        }
+        uint32_t us = 0;
+        if (timer.compareCallback)
+            us = timer.compareCallback();
+        if (us)
+            timer_ScheduleCompare(us);
+        else
+            TIM1->DIER &= ~TIM_DIER_CC1IE;
+    }
+}
+
+RAMFUNC void TIM2_IRQHandler(void) {
+    if (TIM2->SR & TIM_SR_UIF) {
+        TIM2->SR = ~TIM_SR_UIF;
         timer.callbacks[0]();
     }
 }
 
+// held off while the flash is written (see hal/flash.c), stays in flash
 void TIM3_IRQHandler(void) {
-    if (TIM_GetITStatus(TIM3, TIM_IT_Update) == SET) {
-        TIM_ClearITPendingBit(TIM3, TIM_IT_Update);
+    if ((TIM3->SR & TIM_SR_CC1IF) && (TIM3->DIER & TIM_DIER_CC1IE)) {
+        TIM3->SR = ~TIM_SR_CC1IF;
+        if (timer.stepCallback())
+            timer_ScheduleStep();
+        else
+            TIM3->DIER &= ~TIM_DIER_CC1IE;
+    }
+    if (TIM3->SR & TIM_SR_UIF) {
+        TIM3->SR = ~TIM_SR_UIF;
         timer.callbacks[1]();
     }
 }
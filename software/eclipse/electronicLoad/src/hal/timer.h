@@ -9,11 +9,29 @@
 
 #include "stm32f10x.h"
 #include "stm32f10x_conf.h"
+#include "common.h"
 
 #define MS_TO_TICKS(ms) (72000*ms)
 
+// cycle counter of the data watchpoint and trace unit
+// (not defined in the CMSIS version used)
+#define TIMER_DWT_CTRL          (*(volatile uint32_t*) 0xE0001000)
+#define TIMER_DWT_CYCCNT        (*(volatile uint32_t*) 0xE0001004)
+#define TIMER_DWT_CTRL_CYCCNTENA    0x00000001
+
 struct {
     void ((*callbacks[3])());
+    void (*sysTickCallback)();
+    // see timer_SetupCompareFunction
+    uint32_t (*compareCallback)(void);
+    // overflows of timer 1 until the next call resp. counter value of
+    // the scheduled call
+    uint32_t compareWait;
+    uint16_t compareBase;
+    // see timer_SetupStepFunction
+    uint8_t (*stepCallback)(void);
+    // interval of the step function in ticks of timer 3
+    uint16_t stepTicks;
     volatile uint32_t ms;
 } timer;
 
@@ -24,6 +42,31 @@ struct {
  */
 void timer_Init(void);
 
+/**
+ * \brief Returns the number of CPU cycles since timer_Init()
+ *
+ * Free running 32 bit counter, overflows after ~59s at 72MHz.
+ * Only use the difference of two values.
+ */
+uint32_t timer_GetCycles(void);
+
+/**
+ * \brief Waits for a number of CPU cycles
+ *
+ * For delays below 1us, uses the cycle counter.
+ *
+ * \param cycles Minimum number of cycles to wait
+ */
+void timer_waitCycles(uint32_t cycles);
+
+/**
+ * \brief Returns the system time in microseconds
+ *
+ * Combines timer.ms with the counter of timer 1. Overflows
+ * after ~71 minutes, only use the difference of two values.
+ */
+uint32_t timer_GetTimeus(void);
+
 /**
  * \brief Waits for a specific amount of milliseconds
  *
@@ -74,8 +117,64 @@ uint8_t timer_TimeoutElapsed(uint32_t timeout);
 uint8_t timer_SetupPeriodicFunction(uint8_t timerNumber, uint32_t period,
         void (*callback)(), uint8_t priority);
 
+/**
+ * \brief Sets up a regularly called function using the SysTick timer
+ *
+ * Intended for short tasks that have to run more often than once per
+ * millisecond.
+ *
+ * \param period        Number of systicks between function calls
+ *                      (at most 2^24)
+ * \param callback      Pointer to function that will be called
+ * \param priority      Priority of interrupt from which the function
+ *                      will be called
+ */
+uint8_t timer_SetupSysTickFunction(uint32_t period, void (*callback)(),
+        uint8_t priority);
+
+/**
+ * \brief Sets up a function that is called at variable intervals
+ *
+ * Uses compare channel 1 of timer 1 (1us resolution). The callback
+ * returns the time in us from its scheduled call to the next one, thus
+ * the interrupt latency does not accumulate. Returning 0 stops the
+ * calls.
+ *
+ * \param delay         Time in us until the first call (at least 2)
+ * \param callback      Pointer to function that will be called
+ * \param priority      Priority of interrupt from which the function
+ *                      will be called
+ */
+uint8_t timer_SetupCompareFunction(uint32_t delay, uint32_t (*callback)(void),
+        uint8_t priority);
+
+/**
+ * \brief Stops the calls of the function set up by
+ * timer_SetupCompareFunction()
+ */
+void timer_StopCompareFunction(void);
+
+/**
+ * \brief Sets up a function that is called repeatedly at a short interval
+ *
+ * Uses compare channel 1 of timer 3, the function is called from its
+ * interrupt. Thus timer 3 must already be set up with
+ * timer_SetupPeriodicFunction(). Intended for transfers that are split
+ * into short steps instead of busy-waiting between them.
+ *
+ * \param interval      Minimum time in us between two calls
+ * \param callback      Pointer to function that will be called, returns
+ *                      0 to stop the calls
+ * \return 0 on success, 1 if timer 3 is not running
+ */
+uint8_t timer_SetupStepFunction(uint16_t interval, uint8_t (*callback)(void));
+
+void SysTick_Handler(void);
+
 void TIM1_UP_IRQHandler(void);
 
+void TIM1_CC_IRQHandler(void);
+
 void TIM2_IRQHandler(void);
 
 void TIM3_IRQHandler(void);
@@ -20,39 +20,198 @@ void load_Init(void) {
     load.voltage = settings.maxVoltage[settings.powerMode];
     load.resistance = LOAD_MAXRESISTANCE_LOWP;
     load.power = 0;
+    // discard setpoints published before
+    load.mailbox.applied = load.mailbox.published;
+    // select the kernel in the first tick
+    load.kernelKey = 0;
     load.triggerInOld = hal_getTriggerIn();
-    timer_SetupPeriodicFunction(2, MS_TO_TICKS(1), load_update, 4);
+    load.lastDACRefresh = timer.ms;
+    hal_ForceDACUpdate();
+    prof_Reset();
+    timer_SetupPeriodicFunction(2, MS_TO_TICKS(1), load_update,
+            LOAD_PRIORITY);
 }
 
+/**
+ * \brief Returns a consistent set of the latest measurements
+ *
+ * Retries if load_update() published new measurements while copying,
+ * never disables interrupts.
+ *
+ * \param s Destination
+ */
+void load_GetSnapshot(struct loadSnapshot *s) {
+    uint32_t seq;
+    do {
+        seq = load.snapshot.sequence;
+        __sync_synchronize();
+        *s = load.snapshot.data;
+        __sync_synchronize();
+    } while ((seq & 0x01) || seq != load.snapshot.sequence);
+}
+
+/**
+ * \brief Copies the measurements of this tick into the snapshot
+ */
+static RAMFUNC void load_PublishSnapshot(void) {
+    load.snapshot.sequence++;
+    __sync_synchronize();
+    load.snapshot.data = load.state;
+    __sync_synchronize();
+    load.snapshot.sequence++;
+}
+
+/**
+ * \brief Calculates average values since last call
+ *
+ * Uses the sample sums of the snapshots, the control loop's sums are
+ * left alone. Only one context (the display) may call this function.
+ *
+ * \param current Pointer to the average current
+ * \param voltage Pointer to the average voltage
+ * \param power Pointer to the average power
+ */
 void load_GetAverageAndReset(uint32_t *current, uint32_t *voltage,
         uint32_t *power) {
-    *current = load.state.currentSum / load.state.nsamples;
-    *voltage = load.state.voltageSum / load.state.nsamples;
-    *power = load.state.powerSum / load.state.nsamples;
-    load.state.currentSum = 0;
-    load.state.voltageSum = 0;
-    load.state.powerSum = 0;
-    load.state.nsamples = 0;
+    struct loadSnapshot now;
+    load_GetSnapshot(&now);
+    const struct loadSnapshot *start = &load.averageStart;
+    uint32_t n = now.nsamples - start->nsamples;
+    if (n) {
+        *current = (now.currentSum - start->currentSum) / n;
+        *voltage = (now.voltageSum - start->voltageSum) / n;
+        *power = (now.powerSum - start->powerSum) / n;
+    } else {
+        // no new sample since the last call
+        *current = now.current;
+        *voltage = now.voltage;
+        *power = now.power;
+    }
+    load.averageStart = now;
+}
+
+/**
+ * \brief Limits a setpoint record to the ranges of the power mode
+ *
+ * \param s Setpoint record
+ */
+void load_ConstrainSetpoint(struct loadSetpoint *s) {
+    if (s->current < 0)
+        s->current = 0;
+    else if (s->current > settings.maxCurrent[settings.powerMode])
+        s->current = settings.maxCurrent[settings.powerMode];
+
+    if (s->voltage < settings.minVoltage[settings.powerMode])
+        s->voltage = settings.minVoltage[settings.powerMode];
+    else if (s->voltage > settings.maxVoltage[settings.powerMode])
+        s->voltage = settings.maxVoltage[settings.powerMode];
+
+    if (s->resistance < settings.minResistance[settings.powerMode])
+        s->resistance = settings.minResistance[settings.powerMode];
+    else if (s->resistance > settings.maxResistance[settings.powerMode])
+        s->resistance = settings.maxResistance[settings.powerMode];
+
+    if (s->power < 0)
+        s->power = 0;
+    else if (s->power > settings.maxPower[settings.powerMode])
+        s->power = settings.maxPower[settings.powerMode];
+}
+
+/**
+ * \brief Returns the setpoint the load will use
+ *
+ * That is the latest published record if it has not been applied yet,
+ * the setpoint of the control loop otherwise.
+ *
+ * \param s Destination
+ */
+void load_GetSetpoint(struct loadSetpoint *s) {
+    uint32_t seq;
+    do {
+        seq = load.mailbox.published;
+        if (seq != load.mailbox.applied) {
+            *s = load.mailbox.slot[seq & (LOAD_SETPOINT_SLOTS - 1)];
+        } else {
+            s->mode = load.mode;
+            s->current = load.current;
+            s->voltage = load.voltage;
+            s->resistance = load.resistance;
+            s->power = load.power;
+        }
+        // retry if a record has been published meanwhile
+    } while (seq != load.mailbox.published);
+}
+
+/**
+ * \brief Hands a complete setpoint over to the control loop
+ *
+ * The record is limited to the ranges of the power mode and applied at
+ * the start of the next tick, all fields at once. May be called from
+ * any context below the priority of load_update(), never blocks.
+ *
+ * \param s New setpoint
+ */
+void load_PublishSetpoint(const struct loadSetpoint *s) {
+    // a writer preempted by another one keeps its own slot
+    uint32_t seq = __sync_add_and_fetch(&load.mailbox.reserved, 1);
+    struct loadSetpoint *slot = &load.mailbox.slot[seq
+            & (LOAD_SETPOINT_SLOTS - 1)];
+    *slot = *s;
+    load_ConstrainSetpoint(slot);
+    __sync_synchronize();
+    uint32_t last;
+    do {
+        last = load.mailbox.published;
+        if ((int32_t) (seq - last) <= 0)
+            // a writer that preempted this one has published a newer record
+            return;
+    } while (!__sync_bool_compare_and_swap(&load.mailbox.published, last, seq));
+}
+
+/**
+ * \brief Takes over the latest published setpoint
+ *
+ * Called at the start of a tick, the record is complete and limited
+ * already.
+ */
+static RAMFUNC void load_ApplySetpoint(void) {
+    uint32_t seq = load.mailbox.published;
+    if (seq == load.mailbox.applied)
+        return;
+    const struct loadSetpoint *s = &load.mailbox.slot[seq
+            & (LOAD_SETPOINT_SLOTS - 1)];
+    load.mode = s->mode;
+    load.current = s->current;
+    load.voltage = s->voltage;
+    load.resistance = s->resistance;
+    load.power = s->power;
+    load.mailbox.applied = seq;
 }
 
 /**
  * \brief Sets constant current mode
  *
- * \param c Current in mA
+ * \param c Current in uA
  */
 void load_set_CC(uint32_t c) {
-    load.mode = FUNCTION_CC;
-    load.current = c;
+    struct loadSetpoint s;
+    load_GetSetpoint(&s);
+    s.mode = FUNCTION_CC;
+    s.current = c;
+    load_PublishSetpoint(&s);
 }
 
 /**
  * \brief Sets constant voltage mode
  *
- * \param v Voltage in mV
+ * \param v Voltage in uV
  */
 void load_set_CV(uint32_t v) {
-    load.mode = FUNCTION_CV;
-    load.voltage = v;
+    struct loadSetpoint s;
+    load_GetSetpoint(&s);
+    s.mode = FUNCTION_CV;
+    s.voltage = v;
+    load_PublishSetpoint(&s);
 }
 
 /**
@@ -61,18 +220,24 @@ void load_set_CV(uint32_t v) {
  * \param r Resistance in mOhm
  */
 void load_set_CR(uint32_t r) {
-    load.mode = FUNCTION_CR;
-    load.resistance = r;
+    struct loadSetpoint s;
+    load_GetSetpoint(&s);
+    s.mode = FUNCTION_CR;
+    s.resistance = r;
+    load_PublishSetpoint(&s);
 }
 
 /**
  * \brief Sets constant power mode
  *
- * \param p Power in mW
+ * \param p Power in uW
  */
 void load_set_CP(uint32_t p) {
-    load.mode = FUNCTION_CP;
-    load.power = p;
+    struct loadSetpoint s;
+    load_GetSetpoint(&s);
+    s.mode = FUNCTION_CP;
+    s.power = p;
+    load_PublishSetpoint(&s);
 }
 
 /**
@@ -85,50 +250,250 @@ void load_set_CP(uint32_t p) {
  * \param mode New load mode
  */
 void load_setMode(loadMode_t mode) {
-    load.mode = mode;
+    struct loadSetpoint s;
+    load_GetSetpoint(&s);
+    s.mode = mode;
+    load_PublishSetpoint(&s);
 }
 
-void load_ConstrainSettings(void) {
-    if (load.current < 0)
-        load.current = 0;
-    else if (load.current > settings.maxCurrent[settings.powerMode])
-        load.current = settings.maxCurrent[settings.powerMode];
-
-    if (load.voltage < settings.minVoltage[settings.powerMode])
-        load.voltage = settings.minVoltage[settings.powerMode];
-    else if (load.voltage > settings.maxVoltage[settings.powerMode])
-        load.voltage = settings.maxVoltage[settings.powerMode];
-
-    if (load.resistance < settings.minResistance[settings.powerMode])
-        load.resistance = settings.minResistance[settings.powerMode];
-    else if (load.resistance > settings.maxResistance[settings.powerMode])
-        load.resistance = settings.maxResistance[settings.powerMode];
-
-    if (load.power < 0)
-        load.power = 0;
-    else if (load.power > settings.maxPower[settings.powerMode])
-        load.power = settings.maxPower[settings.powerMode];
+/**
+ * \brief Returns the setpoint of the active load mode
+ *
+ * Published setpoints are limited already, the ones written by the
+ * events, waveforms and arbitrary sequences during the tick are limited
+ * here. Only the active mode is checked.
+ *
+ * \return Current in uA, voltage in uV, resistance in mOhm resp. power in uW
+ */
+static RAMFUNC int32_t load_Setpoint(void) {
+    int32_t value, min = 0, max;
+    switch (load.mode) {
+    case FUNCTION_CV:
+        value = load.voltage;
+        min = settings.minVoltage[settings.powerMode];
+        max = settings.maxVoltage[settings.powerMode];
+        break;
+    case FUNCTION_CR:
+        value = load.resistance;
+        min = settings.minResistance[settings.powerMode];
+        max = settings.maxResistance[settings.powerMode];
+        break;
+    case FUNCTION_CP:
+        value = load.power;
+        max = settings.maxPower[settings.powerMode];
+        break;
+    default:
+        value = load.current;
+        max = settings.maxCurrent[settings.powerMode];
+        break;
+    }
+    if (value < min)
+        return min;
+    if (value > max)
+        return max;
+    return value;
 }
 
 /**
- * \brief Updates the current drawn by load according to selected load function
+ * \brief Returns the mode of the analog control loop for the active load mode
  *
- * This function is called from an interrupt (using timer 2) every millisecond
+ * The digital CR/CP modes control the current, the calibration always
+ * calibrates the analog mode.
+ *
+ * \return HAL_MODE_CC, HAL_MODE_CV, HAL_MODE_CR or HAL_MODE_CP
+ */
+static RAMFUNC uint8_t load_ControlMode(void) {
+    switch (load.mode) {
+    case FUNCTION_CV:
+        return HAL_MODE_CV;
+    case FUNCTION_CR:
+        if (settings.analogCRCP || cal.active)
+            return HAL_MODE_CR;
+        break;
+    case FUNCTION_CP:
+        if (settings.analogCRCP || cal.active)
+            return HAL_MODE_CP;
+        break;
+    default:
+        break;
+    }
+    return HAL_MODE_CC;
+}
+
+/**
+ * \brief Constant current, optionally switched by the dynamic mode
+ */
+static RAMFUNC void load_KernelCC(int32_t setpoint) {
+    if (dyn.enabled) {
+        // the DAC is set by the timer interrupt
+        dyn_Update();
+    } else {
+        dyn_Stop();
+        cal_setCurrent(setpoint);
+    }
+}
+
+/**
+ * \brief Constant voltage, regulated by the analog control loop
+ */
+static RAMFUNC void load_KernelCV(int32_t setpoint) {
+    cal_setVoltage(setpoint);
+}
+
+/**
+ * \brief Constant resistance in digital mode: sets the current depending
+ * on the voltage
+ */
+static RAMFUNC void load_KernelCRDigital(int32_t setpoint) {
+    // the division runs from flash, a new resistance is applied once the
+    // flash is idle
+    if (setpoint != load.crCache.resistance && !hal_FlashBusy()) {
+        common_Fraction(&load.crCache.conductance, 1000, setpoint);
+        load.crCache.resistance = setpoint;
+    }
+    uint32_t current = common_ApplyFactor(&load.crCache.conductance,
+            load.state.voltage);
+    current = reg_Update(FUNCTION_CR, current, load.state.current,
+            settings.maxCurrent[settings.powerMode]);
+    cal_setCurrent(current);
+}
+
+/**
+ * \brief Constant power in digital mode: sets the current depending on
+ * the voltage
  */
-void load_update(void) {
-    hal_frontPanelUpdate();
+static RAMFUNC void load_KernelCPDigital(int32_t setpoint) {
+    // the division runs from flash, the reciprocal of the last voltage is
+    // held while the flash is busy and the regulator corrects the rest
+    if (!hal_FlashBusy()) {
+        uint32_t voltage = load.state.voltage;
+        if (voltage < LOAD_CP_MIN_VOLTAGE)
+            voltage = LOAD_CP_MIN_VOLTAGE;
+        common_Fraction(&load.cpReciprocal, 1000000, voltage);
+    }
+    uint32_t current = common_ApplyFactor(&load.cpReciprocal, setpoint);
+    current = reg_Update(FUNCTION_CP, current, load.state.current,
+            settings.maxCurrent[settings.powerMode]);
+    cal_setCurrent(current);
+}
+
+/**
+ * \brief Constant resistance, regulated by the analog control loop
+ */
+static RAMFUNC void load_KernelCRAnalog(int32_t setpoint) {
+    cal_setResistance(setpoint);
+}
+
+/**
+ * \brief Constant power, regulated by the analog control loop
+ */
+static RAMFUNC void load_KernelCPAnalog(int32_t setpoint) {
+    cal_setPower(setpoint);
+}
+
+/**
+ * \brief Calibration: the DAC value is set by the calibration routines
+ */
+static RAMFUNC void load_KernelCalibration(int32_t setpoint) {
+    hal_setDAC(load.DACoverride);
+}
 
-    if (load.disableIOcontrol)
+struct loadKernel {
+    // sets the DAC for a setpoint while the input is enabled
+    void (*control)(int32_t setpoint);
+    // DAC value while the input is disabled
+    uint16_t idleDAC;
+};
+
+static const struct loadKernel load_kernels[LOAD_NUM_KERNELS] RAMDATA = {
+        [LOAD_KERNEL_CC] = { load_KernelCC, 0 },
+        [LOAD_KERNEL_CV] = { load_KernelCV, HAL_DAC_MAX },
+        [LOAD_KERNEL_CR_DIGITAL] = { load_KernelCRDigital, 0 },
+        [LOAD_KERNEL_CP_DIGITAL] = { load_KernelCPDigital, 0 },
+        [LOAD_KERNEL_CR_ANALOG] = { load_KernelCRAnalog, 0 },
+        [LOAD_KERNEL_CP_ANALOG] = { load_KernelCPAnalog, 0 },
+        [LOAD_KERNEL_CALIBRATION] = { load_KernelCalibration, 0 } };
+
+/**
+ * \brief Selects the control kernel, shunt and analog control mode
+ *
+ * Only does work if the mode, the analog CR/CP setting, the power mode,
+ * the error shutdown or the calibration state changed since the last
+ * tick. The regulator and the dynamic mode start over in a new kernel.
+ */
+static RAMFUNC void load_SelectKernel(void) {
+    uint8_t shuntOff = settings.turnOffOnError && error.code;
+    uint8_t key = 0x80 | (load.mode & 0x03) | (settings.analogCRCP ? 0x04 : 0)
+            | (cal.active ? 0x08 : 0) | (settings.powerMode ? 0x10 : 0)
+            | (shuntOff ? 0x20 : 0);
+    if (key == load.kernelKey)
         return;
+    load.kernelKey = key;
 
-    if (settings.turnOffOnError && error.code) {
-        load.powerOn = 0;
+    uint8_t kernel;
+    if (cal.active) {
+        kernel = LOAD_KERNEL_CALIBRATION;
+    } else {
+        switch (load.mode) {
+        case FUNCTION_CV:
+            kernel = LOAD_KERNEL_CV;
+            break;
+        case FUNCTION_CR:
+            kernel = settings.analogCRCP ?
+                    LOAD_KERNEL_CR_ANALOG : LOAD_KERNEL_CR_DIGITAL;
+            break;
+        case FUNCTION_CP:
+            kernel = settings.analogCRCP ?
+                    LOAD_KERNEL_CP_ANALOG : LOAD_KERNEL_CP_DIGITAL;
+            break;
+        default:
+            kernel = LOAD_KERNEL_CC;
+            break;
+        }
+    }
+    if (kernel != load.kernel) {
+        reg_Reset();
+        dyn_Stop();
+        if (kernel == LOAD_KERNEL_CALIBRATION)
+            slew_Reset();
+        // no current until the first reciprocal has been calculated
+        load.cpReciprocal.factor = 0;
+        load.kernel = kernel;
+    }
+
+    if (shuntOff) {
         hal_SelectShunt(HAL_SHUNT_NONE);
     } else if (settings.powerMode) {
         hal_SelectShunt(HAL_SHUNT_R01);
     } else {
         hal_SelectShunt(HAL_SHUNT_1R);
     }
+    hal_SetControlMode(load_ControlMode());
+}
+
+/**
+ * \brief Updates the current drawn by load according to selected load function
+ *
+ * This function is called from an interrupt (using timer 2) every millisecond
+ */
+RAMFUNC void load_update(void) {
+    prof_TickStart();
+
+    // runs from flash, buttons and encoder pause during a flash operation
+    if (!hal_FlashBusy())
+        hal_frontPanelUpdate();
+    PROF_STAGE_END(PROF_STAGE_FRONTPANEL);
+
+    if (load.disableIOcontrol) {
+        // calibration or selftest own the analog board, close the tick
+        prof_TickEnd();
+        return;
+    }
+
+    if (settings.turnOffOnError && error.code) {
+        // the shunt is disconnected by load_SelectKernel()
+        load.powerOn = 0;
+    }
 
     load.state.voltage = cal_getVoltage();
 
@@ -137,12 +502,16 @@ void load_update(void) {
     load.state.power = (uint64_t) load.state.voltage * load.state.current
             / 1000000UL;
 
-    // update average values
+    // sums for the averages
     load.state.voltageSum += load.state.voltage;
     load.state.currentSum += load.state.current;
     load.state.powerSum += load.state.power;
     load.state.nsamples++;
+    PROF_STAGE_END(PROF_STAGE_ADC);
 
+    // conversions of the temperatures and the supply rails, the
+    // results are available in the next ticks
+    tele_Update();
     load.state.temp1 = cal_getTemp1();
     load.state.temp2 = cal_getTemp2();
     uint16_t highTemp = load.state.temp1;
@@ -155,76 +524,64 @@ void load_update(void) {
     else if (highTemp <= LOAD_FANOFF_TEMP)
         hal_setFan(0);
 
+    load_PublishSnapshot();
+
+    PROF_STAGE_END(PROF_STAGE_TEMPERATURE);
+
     uint8_t triggerIn = hal_getTriggerIn();
     events.triggerInState = triggerIn - load.triggerInOld;
     load.triggerInOld = triggerIn;
 
+    // the DAC is only written if its value changes, rewrite it now and
+    // then in case it has been corrupted
+    if (timer.ms - load.lastDACRefresh >= LOAD_DAC_REFRESH_INTERVAL) {
+        load.lastDACRefresh = timer.ms;
+        hal_ForceDACUpdate();
+    }
+
     if (!cal.active) {
         // only run function that can potentially change settings
         // while calibration is not active
+        load_ApplySetpoint();
         events_decrementTimers();
         events_updateWaveformPhase();
-        events_HandleEvents();
+        // evaluated from flash, the events are held while a flash
+        // operation is in progress (trigger input edges are lost)
+        if (!hal_FlashBusy())
+            events_HandleEvents();
+        PROF_STAGE_END(PROF_STAGE_EVENTS);
 
         arb_Update();
+        PROF_STAGE_END(PROF_STAGE_ARBITRARY);
         waveform_Update();
-        characteristic_Update();
-        load_ConstrainSettings();
-
-        uint32_t current = 0;
-//    uint32_t currentLimit = ((uint64_t) settings.maxPower[settings.powerMode]
-//            * 1000000) / load.state.voltage;
+        PROF_STAGE_END(PROF_STAGE_WAVEFORM);
+        // only recorded from its menu, never while the flash is written,
+        // thus its code stays in flash
+        if (characteristic.active)
+            characteristic_Update();
+        PROF_STAGE_END(PROF_STAGE_CHARACTERISTIC);
 
         uint8_t enableInput = load.powerOn;
         if (highTemp > LOAD_MAX_TEMP) {
             // disable input if temperature too high
             enableInput = 0;
         }
-        switch (load.mode) {
-        case FUNCTION_CC:
-//        if (load.current > currentLimit)
-//            current = currentLimit;
-//        else
-            current = load.current;
-            hal_SetControlMode(HAL_MODE_CC);
-            if (enableInput) {
-                cal_setCurrent(current);
-            } else {
-                hal_setDAC(0);
-            }
-            break;
-        case FUNCTION_CV:
-            hal_SetControlMode(HAL_MODE_CV);
-            if (enableInput) {
-                cal_setVoltage(load.voltage);
-            } else {
-                hal_setDAC(HAL_DAC_MAX);
-            }
-            break;
-        case FUNCTION_CR:
-            // control resistance in digital mode: set current depending on voltage
-            hal_SetControlMode(HAL_MODE_CC);
-            if (enableInput) {
-                // calculate necessary current
-                current = ((uint64_t) load.state.voltage * 1000)
-                        / load.resistance;
-                cal_setCurrent(current);
-            } else {
-                hal_setDAC(0);
-            }
-            break;
-        case FUNCTION_CP:
-            // control control in digital mode: set current depending on voltage
-            hal_SetControlMode(HAL_MODE_CC);
-            if (enableInput) {
-                // calculate necessary current
-                current = ((uint64_t) load.power * 1000000)
-                        / load.state.voltage;
-                cal_setCurrent(current);
-            } else {
-                hal_setDAC(0);
-            }
-            break;
+        // the shunt and the control mode reach the AVR in a single frame,
+        // before the DAC is set for the new mode
+        load_SelectKernel();
+        hal_UpdateAVRGPIOs();
+        const struct loadKernel *kernel = &load_kernels[load.kernel];
+        if (enableInput) {
+            // setpoint of the active mode, limited to the configured slew
+            // rate
+            kernel->control(slew_Update(load.mode, load_Setpoint()));
+        } else {
+            // the ramp, the regulator and the dynamic mode start over when
+            // the input is enabled again
+            slew_Reset();
+            reg_Reset();
+            dyn_Stop();
+            hal_setDAC(kernel->idleDAC);
         }
         // update trigger out
         if(events.triggerOutState==1){
@@ -232,25 +589,19 @@ void load_update(void) {
         } else if(events.triggerOutState==-1){
             hal_setTriggerOut(0);
         }
+        PROF_STAGE_END(PROF_STAGE_CONTROL);
         errors_Check();
+        PROF_STAGE_END(PROF_STAGE_ERRORS);
     } else {
         // calibration is active
-        switch (load.mode) {
-        case FUNCTION_CC:
-            hal_SetControlMode(HAL_MODE_CC);
-            break;
-        case FUNCTION_CV:
-            hal_SetControlMode(HAL_MODE_CV);
-            break;
-        case FUNCTION_CR:
-            hal_SetControlMode(HAL_MODE_CC);
-            break;
-        case FUNCTION_CP:
-            hal_SetControlMode(HAL_MODE_CC);
-            break;
-        }
-        hal_setDAC(load.DACoverride);
+        load_SelectKernel();
+        hal_UpdateAVRGPIOs();
+        load_kernels[load.kernel].control(0);
+        PROF_STAGE_END(PROF_STAGE_CONTROL);
     }
 
     stats_Update();
+    PROF_STAGE_END(PROF_STAGE_STATISTICS);
+
+    prof_TickEnd();
 }
@@ -8,6 +8,7 @@
 #define LOADFUNCTIONS_H_
 
 #include <stdint.h>
+#include "common.h"
 #include "currentSink.h"
 #include "calibration.h"
 #include "statistics.h"
@@ -16,15 +17,72 @@
 #include "characteristic.h"
 #include "errors.h"
 #include "arbitrary.h"
+#include "profiler.h"
+#include "regulator.h"
+#include "dynamic.h"
+#include "slew.h"
 
 #define LOAD_MAX_TEMP           100
 #define LOAD_FANON_TEMP         35
 #define LOAD_FANOFF_TEMP        30
 
+// below this voltage (in uV) CP mode calculates the current as if this
+// voltage was applied (limits the current, avoids division by zero)
+#define LOAD_CP_MIN_VOLTAGE     100000
+
+// interrupt priority of load_update() (timer 2)
+#define LOAD_PRIORITY           4
+
+// interval in ms in which the DAC is rewritten even if its value is
+// unchanged (recovers from glitches on the DAC lines)
+#define LOAD_DAC_REFRESH_INTERVAL   100
+
 typedef enum {
     FUNCTION_CC = 0, FUNCTION_CV = 1, FUNCTION_CR = 2, FUNCTION_CP = 3
 } loadMode_t;
 
+// control kernels, see load_SelectKernel()
+#define LOAD_KERNEL_CC              0
+#define LOAD_KERNEL_CV              1
+#define LOAD_KERNEL_CR_DIGITAL      2
+#define LOAD_KERNEL_CP_DIGITAL      3
+#define LOAD_KERNEL_CR_ANALOG       4
+#define LOAD_KERNEL_CP_ANALOG       5
+#define LOAD_KERNEL_CALIBRATION     6
+#define LOAD_NUM_KERNELS            7
+
+// slots of the setpoint mailbox (power of two), must exceed the number of
+// contexts that publish setpoints (main loop and communication)
+#define LOAD_SETPOINT_SLOTS         4
+
+// measurements of one tick
+struct loadSnapshot {
+    int32_t current;
+    int32_t voltage;
+    int32_t power;
+    uint16_t temp1;
+    uint16_t temp2;
+    // sums of all samples since load_Init() and their number, averages
+    // are calculated from the difference of two snapshots
+    uint64_t currentSum;
+    uint64_t voltageSum;
+    uint64_t powerSum;
+    uint32_t nsamples;
+};
+
+// complete setpoint record as published by load_PublishSetpoint()
+struct loadSetpoint {
+    loadMode_t mode;
+    // constant current in uA
+    int32_t current;
+    // constant voltage in uV
+    int32_t voltage;
+    // constant resistance in mOhm
+    int32_t resistance;
+    // constant power in uW
+    int32_t power;
+};
+
 #include "events.h"
 
 struct {
@@ -41,22 +99,49 @@ struct {
 
     uint8_t powerOn;
 
+    // Setpoints of the UI and the communication. Each writer fills its
+    // own slot and then publishes the slot's sequence number,
+    // load_update() takes over the latest published record at the start
+    // of a tick.
+    struct {
+        struct loadSetpoint slot[LOAD_SETPOINT_SLOTS];
+        // last sequence number handed out to a writer
+        volatile uint32_t reserved;
+        // sequence number of the latest complete record
+        volatile uint32_t published;
+        // sequence number of the record load_update() applied last
+        volatile uint32_t applied;
+    } mailbox;
+
     uint8_t triggerInOld;
 
     uint16_t DACoverride;
+    // control kernel of the active mode and the mode, power mode, shunt
+    // and calibration state it was selected for
+    uint8_t kernel;
+    uint8_t kernelKey;
+    // timer.ms of the last forced DAC update
+    uint32_t lastDACRefresh;
+
+    // 1000/resistance for CR mode and the resistance it was calculated for
+    struct {
+        int32_t resistance;
+        struct fixedFactor conductance;
+    } crCache;
+    // 1000000/voltage for CP mode, from the last tick the flash was idle
+    struct fixedFactor cpReciprocal;
 
+    // measurements of the running tick, only valid within load_update()
+    struct loadSnapshot state;
+    // copy of state for readers outside of load_update(), see
+    // load_GetSnapshot()
     struct {
-        int32_t current;
-        int32_t voltage;
-        int32_t power;
-        uint16_t temp1;
-        uint16_t temp2;
-        // average variables for display
-        uint64_t currentSum;
-        uint64_t voltageSum;
-        uint64_t powerSum;
-        uint32_t nsamples;
-    } state;
+        // odd while load_update() writes data
+        volatile uint32_t sequence;
+        struct loadSnapshot data;
+    } snapshot;
+    // snapshot of the last load_GetAverageAndReset() call
+    struct loadSnapshot averageStart;
 
     uint8_t disableIOcontrol;
 } load;
@@ -71,9 +156,22 @@ struct {
  */
 void load_Init(void);
 
+/**
+ * \brief Returns a consistent set of the latest measurements
+ *
+ * Retries if load_update() published new measurements while copying,
+ * never disables interrupts.
+ *
+ * \param s Destination
+ */
+void load_GetSnapshot(struct loadSnapshot *s);
+
 /**
  * \brief Calculates average values since last call
  *
+ * Uses the sample sums of the snapshots, the control loop's sums are
+ * left alone. Only one context (the display) may call this function.
+ *
  * \param current Pointer to the average current
  * \param voltage Pointer to the average voltage
  * \param power Pointer to the average power
@@ -81,17 +179,45 @@ void load_Init(void);
 void load_GetAverageAndReset(uint32_t *current, uint32_t *voltage,
         uint32_t *power);
 
+/**
+ * \brief Limits a setpoint record to the ranges of the power mode
+ *
+ * \param s Setpoint record
+ */
+void load_ConstrainSetpoint(struct loadSetpoint *s);
+
+/**
+ * \brief Returns the setpoint the load will use
+ *
+ * That is the latest published record if it has not been applied yet,
+ * the setpoint of the control loop otherwise.
+ *
+ * \param s Destination
+ */
+void load_GetSetpoint(struct loadSetpoint *s);
+
+/**
+ * \brief Hands a complete setpoint over to the control loop
+ *
+ * The record is limited to the ranges of the power mode and applied at
+ * the start of the next tick, all fields at once. May be called from
+ * any context below the priority of load_update(), never blocks.
+ *
+ * \param s New setpoint
+ */
+void load_PublishSetpoint(const struct loadSetpoint *s);
+
 /**
  * \brief Sets constant current mode
  *
- * \param c Current in mA
+ * \param c Current in uA
  */
 void load_set_CC(uint32_t c);
 
 /**
  * \brief Sets constant voltage mode
  *
- * \param v Voltage in mV
+ * \param v Voltage in uV
  */
 void load_set_CV(uint32_t v);
 
@@ -105,7 +231,7 @@ void load_set_CR(uint32_t r);
 /**
  * \brief Sets constant power mode
  *
- * \param p Power in mW
+ * \param p Power in uW
  */
 void load_set_CP(uint32_t p);
 
@@ -120,11 +246,6 @@ void load_set_CP(uint32_t p);
  */
 void load_setMode(loadMode_t mode);
 
-/**
- * brief Limits the load settigns
- */
-void load_ConstrainSettings(void);
-
 /**
  * \brief Updates the current drawn by load according to selected load function
  *
@@ -1,5 +1,26 @@
 #include "main.h"
 
+// period of the background timer in ms
+#define MAIN_BACKGROUND_PERIOD  5
+// period of the communication in background timer periods
+#define MAIN_COM_DIVIDER        2
+
+/**
+ * \brief Low priority background tasks, called from timer 3
+ *
+ * Refreshes the display and handles the communication every second
+ * call. Timer 4 is used by the AVR link and no longer available for
+ * the communication.
+ */
+static void main_BackgroundTasks(void) {
+    static uint8_t comDivider = 0;
+    hal_updateDisplay();
+    if (++comDivider >= MAIN_COM_DIVIDER) {
+        comDivider = 0;
+        com_Update();
+    }
+}
+
 void _exit(int a) {
     while (1) {
     };
@@ -8,7 +29,6 @@ void _exit(int a) {
 int main(int argc, char* argv[]) {
     /* TODO move this section into HAL */
     SystemInit();
-    SysTick_Config(72000);
     NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4);
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
     GPIO_PinRemapConfig(GPIO_Remap_SWJ_JTAGDisable, ENABLE);
@@ -36,11 +56,14 @@ int main(int argc, char* argv[]) {
     events_Init();
     waveform_Init();
     arb_Init();
+    acq_Init();
+    tele_Init();
+    dyn_Init();
     load_Init();
-    com_Init();
     stats_Reset();
 
-    timer_SetupPeriodicFunction(3, MS_TO_TICKS(5), hal_updateDisplay, 12);
+    timer_SetupPeriodicFunction(3, MS_TO_TICKS(MAIN_BACKGROUND_PERIOD),
+            main_BackgroundTasks, 10);
 
     selftest_Run();
 
@@ -53,6 +76,7 @@ int main(int argc, char* argv[]) {
         screen_FastString6x8("Not calibrated.", 0, 2);
         screen_FastString6x8("Continue anyway?", 0, 3);
         screen_SetSoftButton("Yes", 2);
+        screen_Commit();
         while (!(hal_getButton() & HAL_BUTTON_SOFT2))
             ;
         while (hal_getButton())
@@ -71,6 +95,7 @@ int main(int argc, char* argv[]) {
     menu_AddMainMenuEntry("Calibration", calibrationMenu);
     menu_AddMainMenuEntry("Tests", test_Menu);
     menu_AddMainMenuEntry("Errors", error_Menu);
+    menu_AddMainMenuEntry("Diagnostics", prof_Display);
 
     menu_DefaultScreenHandler();
 }
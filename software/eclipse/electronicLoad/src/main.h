@@ -19,5 +19,7 @@
 #include "test.h"
 #include "errors.h"
 #include "arbitrary.h"
+#include "profiler.h"
+#include "acquisition.h"
 
 #endif
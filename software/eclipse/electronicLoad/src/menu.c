@@ -29,7 +29,9 @@ void menu_DefaultScreenHandler(void) {
         // set default screen entries
         screen_Clear();
         char buf[22];
-        if (load.state.temp1 > LOAD_MAX_TEMP || load.state.temp2 > LOAD_MAX_TEMP) {
+        struct loadSnapshot m;
+        load_GetSnapshot(&m);
+        if (m.temp1 > LOAD_MAX_TEMP || m.temp2 > LOAD_MAX_TEMP) {
             screen_FastString12x16("HIGH TEMP", 10, 4);
         } else if (!load.powerOn) {
             screen_FastString12x16("INPUT OFF", 10, 4);
@@ -44,10 +46,15 @@ void menu_DefaultScreenHandler(void) {
         uint32_t current, voltage, power;
         load_GetAverageAndReset(&current, &voltage, &power);
 
+        // edited locally, the control loop takes over complete records
+        struct loadSetpoint sp;
+        load_GetSetpoint(&sp);
+        uint8_t publish = 0;
+
         char bigUnit[8];
         char smallUnit1[8];
         char smallUnit2[8];
-        switch (load.mode) {
+        switch (sp.mode) {
         case FUNCTION_CC:
             string_fromUintUnit(current, bigUnit, 4, 6, 'A');
             string_fromUintUnit(voltage, smallUnit1, 4, 6, 'V');
@@ -55,20 +62,20 @@ void menu_DefaultScreenHandler(void) {
 
             screen_FastString6x8("CC-Mode:", 0, 3);
             if (settings.powerMode) {
-                string_fromUint(load.current / 1000, buf, 5, 3);
+                string_fromUint(sp.current / 1000, buf, 5, 3);
                 screen_FastChar6x8('A', 114, 3);
                 baseInkrement = 1000;
                 dotPosition = 3;
                 maxEncoderPosition = 5;
             } else {
-                string_fromUint(load.current / 10, buf, 5, 2);
+                string_fromUint(sp.current / 10, buf, 5, 2);
                 screen_FastString6x8("mA", 114, 3);
                 baseInkrement = 10;
                 dotPosition = 2;
                 maxEncoderPosition = 5;
             }
             screen_FastString6x8(buf, 78, 3);
-            setvalue = &load.current;
+            setvalue = &sp.current;
             minValue = 0;
             maxValue = settings.maxCurrent[settings.powerMode];
             break;
@@ -78,14 +85,14 @@ void menu_DefaultScreenHandler(void) {
             string_fromUintUnit(power, smallUnit2, 4, 6, 'W');
 
             screen_FastString6x8("CV-Mode:", 0, 3);
-            string_fromUint(load.voltage / 10000, buf, 5, 2);
+            string_fromUint(sp.voltage / 10000, buf, 5, 2);
             screen_FastChar6x8('V', 114, 3);
             baseInkrement = 10000;
             dotPosition = 2;
             maxEncoderPosition = 5;
 
             screen_FastString6x8(buf, 78, 3);
-            setvalue = &load.voltage;
+            setvalue = &sp.voltage;
             minValue = settings.minVoltage[settings.powerMode];
             maxValue = settings.maxVoltage[settings.powerMode];
             break;
@@ -96,13 +103,13 @@ void menu_DefaultScreenHandler(void) {
 
             screen_FastString6x8("CR-Mode:", 0, 3);
             if (settings.powerMode) {
-                string_fromUint(load.resistance / 10, buf, 5, 2);
+                string_fromUint(sp.resistance / 10, buf, 5, 2);
                 screen_FastChar6x8('R', 114, 3);
                 baseInkrement = 10;
                 dotPosition = 2;
                 maxEncoderPosition = 5;
             } else {
-                string_fromUint(load.resistance / 1000, buf, 5, 3);
+                string_fromUint(sp.resistance / 1000, buf, 5, 3);
                 screen_FastString6x8("kR", 114, 3);
                 baseInkrement = 1000;
                 dotPosition = 3;
@@ -110,7 +117,7 @@ void menu_DefaultScreenHandler(void) {
             }
             screen_FastString6x8(buf, 78, 3);
 
-            setvalue = &load.resistance;
+            setvalue = &sp.resistance;
             minValue = settings.minResistance[settings.powerMode];
             maxValue = settings.maxResistance[settings.powerMode];
             break;
@@ -121,13 +128,13 @@ void menu_DefaultScreenHandler(void) {
 
             screen_FastString6x8("CP-Mode:", 0, 3);
             if (settings.powerMode) {
-                string_fromUint(load.power / 10000, buf, 5, 2);
+                string_fromUint(sp.power / 10000, buf, 5, 2);
                 screen_FastChar6x8('W', 114, 3);
                 baseInkrement = 10000;
                 dotPosition = 2;
                 maxEncoderPosition = 5;
             } else {
-                string_fromUint(load.power / 100, buf, 5, 1);
+                string_fromUint(sp.power / 100, buf, 5, 1);
                 screen_FastString6x8("mW", 114, 3);
                 baseInkrement = 100;
                 dotPosition = 1;
@@ -135,7 +142,7 @@ void menu_DefaultScreenHandler(void) {
             }
             screen_FastString6x8(buf, 78, 3);
 
-            setvalue = &load.power;
+            setvalue = &sp.power;
             minValue = 0;
             maxValue = settings.maxPower[settings.powerMode];
             break;
@@ -146,11 +153,11 @@ void menu_DefaultScreenHandler(void) {
 
         screen_InvertChar6x8(108 - encoderPosition * 6, 3);
 
-        string_fromUintUnit(load.state.temp1, buf, 3, 0, 0);
+        string_fromUintUnit(m.temp1, buf, 3, 0, 0);
         buf[3] = '\xf8';
         buf[4] = 'C';
         buf[5] = '/';
-        string_fromUintUnit(load.state.temp2, &buf[6], 3, 0, 0);
+        string_fromUintUnit(m.temp2, &buf[6], 3, 0, 0);
         buf[9] = '\xf8';
         buf[10] = 'C';
         screen_FastString6x8(buf, 62, 2);
@@ -162,6 +169,7 @@ void menu_DefaultScreenHandler(void) {
         screen_SetSoftButton("\x1b", 0);
         screen_SetSoftButton("\x1a", 1);
         screen_SetSoftButton("Menu", 2);
+        screen_Commit();
 
         uint32_t button;
         int32_t encoder;
@@ -177,39 +185,43 @@ void menu_DefaultScreenHandler(void) {
          * four standard modes (CC, CV, CR, CP)
          ********************************************************/
         if (button & HAL_BUTTON_CC) {
-            if (menu_getInputValue(&load.current, "'load current'", 0,
+            if (menu_getInputValue(&sp.current, "'load current'", 0,
                     settings.maxCurrent[settings.powerMode], NULL, "mA", "A")) {
-                load.mode = FUNCTION_CC;
+                sp.mode = FUNCTION_CC;
+                publish = 1;
                 load.powerOn = 0;
                 waveform.form = WAVE_NONE;
                 encoderPosition = 0;
             }
         }
         if (button & HAL_BUTTON_CV) {
-            if (menu_getInputValue(&load.voltage, "'load voltage'",
+            if (menu_getInputValue(&sp.voltage, "'load voltage'",
                     settings.minVoltage[settings.powerMode],
                     settings.maxVoltage[settings.powerMode], NULL, "mV", "V")) {
-                load.mode = FUNCTION_CV;
+                sp.mode = FUNCTION_CV;
+                publish = 1;
                 load.powerOn = 0;
                 waveform.form = WAVE_NONE;
                 encoderPosition = 0;
             }
         }
         if (button & HAL_BUTTON_CR) {
-            if (menu_getInputValue(&load.resistance, "'load resistance'",
+            if (menu_getInputValue(&sp.resistance, "'load resistance'",
                     settings.minResistance[settings.powerMode],
                     settings.maxResistance[settings.powerMode], "mOhm", "Ohm",
                     NULL)) {
-                load.mode = FUNCTION_CR;
+                sp.mode = FUNCTION_CR;
+                publish = 1;
                 load.powerOn = 0;
                 waveform.form = WAVE_NONE;
                 encoderPosition = 0;
             }
         }
         if (button & HAL_BUTTON_CP) {
-            if (menu_getInputValue(&load.power, "'load power'", 0,
+            if (menu_getInputValue(&sp.power, "'load power'", 0,
                     settings.maxPower[settings.powerMode], NULL, "mW", "W")) {
-                load.mode = FUNCTION_CP;
+                sp.mode = FUNCTION_CP;
+                publish = 1;
                 load.powerOn = 0;
                 waveform.form = WAVE_NONE;
                 encoderPosition = 0;
@@ -254,11 +266,14 @@ void menu_DefaultScreenHandler(void) {
                     inkrement *= 10;
             }
             *setvalue += encoder * inkrement * baseInkrement;
+            if (*setvalue < minValue)
+                *setvalue = minValue;
+            if (*setvalue > maxValue)
+                *setvalue = maxValue;
+            publish = 1;
         }
-        if (*setvalue < minValue)
-            *setvalue = minValue;
-        if (*setvalue > maxValue)
-            *setvalue = maxValue;
+        if (publish)
+            load_PublishSetpoint(&sp);
         /*********************************************************
          * enter main menu
          ********************************************************/
@@ -375,6 +390,7 @@ uint8_t menu_getInputValue(uint32_t *value, char *descr, uint32_t min,
             input[i] = 0;
         // get input
         do {
+            screen_Commit();
             while (!(button = hal_getButton()))
                 ;
             if (inputPosition < 10) {
@@ -466,6 +482,7 @@ uint8_t menu_getInputValue(uint32_t *value, char *descr, uint32_t min,
             screen_FastString6x8("Max. parameter:", 0, 5);
             string_fromUint(max, buf, 9, dot);
             screen_FastString12x16(buf, 0, 6);
+            screen_Commit();
             uint32_t timeout = timer_SetTimeout(6000);
             // display error message for 3 seconds
             // (can be aborted by pressing escape button)
@@ -510,6 +527,7 @@ int8_t menu_ItemChooseDialog(const char *title, const char **items,
         }
         // display arrow at selected menu entry
         screen_FastChar6x8(0x1A, 0, 1 + selectedItem - firstDisplayedItem);
+        screen_Commit();
 
         uint32_t button;
         int32_t encoder;
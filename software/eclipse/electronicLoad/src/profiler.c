@@ -0,0 +1,247 @@
+/**
+ * \file
+ * \brief   Profiler source file.
+ *
+ * Timing diagnostics of the control loop: measures the CPU cycles spent
+ * in the different stages of load_update() and monitors whether it is
+ * called in time.
+ */
+#include "profiler.h"
+
+const char prof_stageNames[PROF_STAGE_NUM][8] = { "FPANEL", "ADC", "TEMP",
+        "EVENTS", "ARB", "WAVE", "CHAR", "CONTROL", "ERRORS", "STATS" };
+
+const uint16_t prof_jitterLimits[PROF_JITTER_BINS - 1] RAMDATA = { 5, 10, 50,
+        100, 500 };
+
+static void prof_ResetValue(struct profValue *v) {
+    v->min = UINT32_MAX;
+    v->max = 0;
+    v->sum = 0;
+    v->nsamples = 0;
+}
+
+static void prof_UpdateValue(struct profValue *v, uint32_t cycles) {
+    if (cycles > v->max)
+        v->max = cycles;
+    if (cycles < v->min)
+        v->min = cycles;
+    v->sum += cycles;
+    v->nsamples++;
+}
+
+/**
+ * \brief Requests a reset of all profiling data
+ *
+ * The data is owned by the load_update() interrupt, the reset itself
+ * is done at the start of the next call.
+ */
+void prof_Reset(void) {
+    profiler.resetRequest = 1;
+}
+
+static FLASHFUNC void prof_ResetData(void) {
+    uint8_t i;
+    for (i = 0; i < PROF_STAGE_NUM; i++) {
+        prof_ResetValue(&profiler.data.stage[i]);
+        profiler.data.worstTick[i] = 0;
+    }
+    prof_ResetValue(&profiler.data.tick);
+    memset(&profiler.data.timing, 0, sizeof(profiler.data.timing));
+    hal.DACwrites = 0;
+    hal.DACskipped = 0;
+    profiler.resetRequest = 0;
+}
+
+/**
+ * \brief Accounts the cycles of the finished call to the statistics
+ *
+ * \param cycles Cycles of the complete call
+ */
+static FLASHFUNC void prof_UpdateStages(uint32_t cycles) {
+    uint8_t i;
+    for (i = 0; i < PROF_STAGE_NUM; i++) {
+        prof_UpdateValue(&profiler.data.stage[i], profiler.current[i]);
+    }
+    if (cycles > profiler.data.tick.max) {
+        memcpy(profiler.data.worstTick, profiler.current,
+                sizeof(profiler.data.worstTick));
+    }
+    prof_UpdateValue(&profiler.data.tick, cycles);
+}
+
+RAMFUNC void prof_TickStart(void) {
+    // the reset and the statistics run from flash, they are skipped while
+    // a flash operation would stall the control loop
+    if (profiler.resetRequest && !hal_FlashBusy())
+        prof_ResetData();
+    profiler.tickStartus = timer_GetTimeus();
+    profiler.deadlineMissed = 0;
+    if (profiler.lastTickValid) {
+        uint32_t period = profiler.tickStartus - profiler.lastTickStartus;
+        uint32_t jitter;
+        if (period > PROF_TICK_PERIOD_US)
+            jitter = period - PROF_TICK_PERIOD_US;
+        else
+            jitter = PROF_TICK_PERIOD_US - period;
+        if (jitter > profiler.data.timing.maxJitter)
+            profiler.data.timing.maxJitter = jitter;
+        uint8_t bin;
+        for (bin = 0; bin < PROF_JITTER_BINS - 1; bin++) {
+            if (jitter < prof_jitterLimits[bin])
+                break;
+        }
+        profiler.data.timing.jitter[bin]++;
+        if (period >= PROF_TICK_PERIOD_US * 3 / 2) {
+            // at least one complete period without a call
+            profiler.data.timing.missedTicks += (period
+                    + PROF_TICK_PERIOD_US / 2) / PROF_TICK_PERIOD_US - 1;
+            profiler.deadlineMissed = 1;
+        }
+    }
+    profiler.lastTickStartus = profiler.tickStartus;
+    profiler.lastTickValid = 1;
+#if PROF_ENABLED
+    memset(profiler.current, 0, sizeof(profiler.current));
+    profiler.tickStart = timer_GetCycles();
+    profiler.stageStart = profiler.tickStart;
+#endif
+}
+
+/**
+ * \brief Marks the end of a stage
+ *
+ * All cycles since the end of the previous stage (or the start of
+ * load_update()) are accounted to this stage. A stage may end several
+ * times per call, the cycles are summed up.
+ *
+ * \param stage Stage that just finished
+ */
+RAMFUNC void prof_StageEnd(profStage_t stage) {
+    uint32_t now = timer_GetCycles();
+    profiler.current[stage] += now - profiler.stageStart;
+    profiler.stageStart = now;
+}
+
+RAMFUNC void prof_TickEnd(void) {
+#if PROF_ENABLED
+    uint32_t cycles = timer_GetCycles() - profiler.tickStart;
+    if (!hal_FlashBusy())
+        prof_UpdateStages(cycles);
+#endif
+    profiler.data.timing.ticks++;
+    if (timer_GetTimeus() - profiler.tickStartus > PROF_TICK_PERIOD_US) {
+        profiler.data.timing.overruns++;
+        profiler.deadlineMissed = 1;
+    }
+    if (profiler.deadlineMissed) {
+        profiler.consecutiveMisses++;
+        if (profiler.consecutiveMisses
+                > profiler.data.timing.maxConsecutiveMisses)
+            profiler.data.timing.maxConsecutiveMisses =
+                    profiler.consecutiveMisses;
+        if (settings.deadlineTrip
+                && profiler.consecutiveMisses >= settings.deadlineTrip
+                && load.powerOn) {
+            load.powerOn = 0;
+            error.code |= (1UL << (LOAD_ERROR_MISSED_DEADLINE - 1));
+        }
+    } else {
+        profiler.consecutiveMisses = 0;
+    }
+}
+
+/**
+ * \brief Copies a consistent set of profiling data
+ *
+ * The profiling data is written by load_update(). The DAC counters
+ * belong to the DAC driver, which the dynamic mode also drives from its
+ * interrupt, so interrupts up to DYN_PRIORITY are masked during the
+ * copy. The system time keeps running.
+ *
+ * \param d Destination
+ */
+void prof_GetData(struct profData *d) {
+    uint32_t basepri = __get_BASEPRI();
+    if (!basepri || basepri > (DYN_PRIORITY << (8 - __NVIC_PRIO_BITS)))
+        __set_BASEPRI(DYN_PRIORITY << (8 - __NVIC_PRIO_BITS));
+    memcpy(d, &profiler.data, sizeof(struct profData));
+    d->dacWrites = hal.DACwrites;
+    d->dacSkipped = hal.DACskipped;
+    __set_BASEPRI(basepri);
+}
+
+uint32_t prof_GetAverage(const struct profValue *v) {
+    if (!v->nsamples)
+        return 0;
+    return v->sum / v->nsamples;
+}
+
+void prof_Display(void) {
+    uint32_t button;
+    // 0: counters
+    // 1: jitter histogram
+    uint8_t mode = 0;
+    do {
+        struct profData d;
+        prof_GetData(&d);
+        screen_Clear();
+        screen_SetSoftButton("Reset", 1);
+        char buf[22];
+        if (mode == 0) {
+            screen_SetSoftButton("Jitter", 0);
+            const char descr[5][11] = { "Ticks:", "Overruns:", "Missed:",
+                    "Consec.:", "Jitter us:" };
+            const uint32_t values[5] = { d.timing.ticks, d.timing.overruns,
+                    d.timing.missedTicks, d.timing.maxConsecutiveMisses,
+                    d.timing.maxJitter };
+            uint8_t i;
+            for (i = 0; i < 5; i++) {
+                screen_FastString6x8(descr[i], 0, i);
+                string_fromUint(values[i], buf, 10, 0);
+                screen_FastString6x8(buf, 66, i);
+            }
+            string_fromUint(prof_GetAverage(&d.tick), buf, 6, 0);
+            screen_FastString6x8("Cycles:", 0, 5);
+            screen_FastString6x8(buf, 48, 5);
+            string_fromUint(d.tick.max, buf, 6, 0);
+            screen_FastString6x8(buf, 90, 5);
+        } else {
+            screen_SetSoftButton("Counts", 0);
+            uint8_t i;
+            for (i = 0; i < PROF_JITTER_BINS; i++) {
+                if (i < PROF_JITTER_BINS - 1) {
+                    buf[0] = '<';
+                    string_fromUint(prof_jitterLimits[i], &buf[1], 3, 0);
+                } else {
+                    strcpy(buf, ">=");
+                    string_fromUint(prof_jitterLimits[i - 1], &buf[2], 3, 0);
+                }
+                screen_FastString6x8(buf, 0, i);
+                string_fromUint(d.timing.jitter[i], buf, 10, 0);
+                screen_FastString6x8(buf, 66, i);
+            }
+        }
+        screen_Commit();
+
+        while (hal_getButton())
+            ;
+        // wait for 500ms or until a button is pressed
+        uint8_t i;
+        for (i = 0; i < 50; i++) {
+            timer_waitms(10);
+            button = hal_getButton();
+            if (button & HAL_BUTTON_ESC) {
+                break;
+            }
+            if (button & HAL_BUTTON_SOFT1) {
+                prof_Reset();
+                break;
+            }
+            if (button & HAL_BUTTON_SOFT0) {
+                mode = !mode;
+                break;
+            }
+        }
+    } while (!(button & HAL_BUTTON_ESC));
+}
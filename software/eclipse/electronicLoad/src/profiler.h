@@ -0,0 +1,127 @@
+/**
+ * \file
+ * \brief   Profiler header file.
+ *
+ * Timing diagnostics of the control loop: measures the CPU cycles spent
+ * in the different stages of load_update() and monitors whether it is
+ * called in time.
+ */
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "timer.h"
+#include "loadFunctions.h"
+
+// set to 0 to remove the per stage instrumentation from load_update()
+#define PROF_ENABLED            1
+
+// nominal period of load_update() in us
+#define PROF_TICK_PERIOD_US     1000
+// number of bins in the jitter histogram
+#define PROF_JITTER_BINS        6
+
+typedef enum {
+    PROF_STAGE_FRONTPANEL = 0,
+    PROF_STAGE_ADC,
+    PROF_STAGE_TEMPERATURE,
+    PROF_STAGE_EVENTS,
+    PROF_STAGE_ARBITRARY,
+    PROF_STAGE_WAVEFORM,
+    PROF_STAGE_CHARACTERISTIC,
+    PROF_STAGE_CONTROL,
+    PROF_STAGE_ERRORS,
+    PROF_STAGE_STATISTICS,
+    // number of stages, must always be the last entry
+    PROF_STAGE_NUM
+} profStage_t;
+
+struct profValue {
+    uint32_t min, max;
+    uint64_t sum;
+    uint32_t nsamples;
+};
+
+struct profTiming {
+    // number of monitored calls
+    uint32_t ticks;
+    // calls that took longer than the period
+    uint32_t overruns;
+    // periods in which load_update() was not called at all
+    uint32_t missedTicks;
+    // longest run of calls that missed their deadline
+    uint32_t maxConsecutiveMisses;
+    // maximum deviation from the nominal period in us
+    uint32_t maxJitter;
+    // deviation from the nominal period, binned by prof_jitterLimits
+    uint32_t jitter[PROF_JITTER_BINS];
+};
+
+struct profData {
+    // cycles per stage
+    struct profValue stage[PROF_STAGE_NUM];
+    // cycles per complete load_update() call
+    struct profValue tick;
+    // stage breakdown of the slowest call so far
+    uint32_t worstTick[PROF_STAGE_NUM];
+    struct profTiming timing;
+    // DAC transfers done resp. skipped because the value was unchanged
+    uint32_t dacWrites;
+    uint32_t dacSkipped;
+};
+
+struct {
+    struct profData data;
+    // stage breakdown of the running call
+    uint32_t current[PROF_STAGE_NUM];
+    uint32_t tickStart;
+    uint32_t stageStart;
+    // system time in us at the start of the running and the previous call
+    uint32_t tickStartus;
+    uint32_t lastTickStartus;
+    uint8_t lastTickValid;
+    uint8_t deadlineMissed;
+    uint32_t consecutiveMisses;
+    volatile uint8_t resetRequest;
+} profiler;
+
+extern const char prof_stageNames[PROF_STAGE_NUM][8];
+// upper limits of the jitter bins in us (the last bin has no limit)
+extern const uint16_t prof_jitterLimits[PROF_JITTER_BINS - 1];
+
+#if PROF_ENABLED
+#define PROF_STAGE_END(stage)   prof_StageEnd(stage)
+#else
+#define PROF_STAGE_END(stage)
+#endif
+
+void prof_Reset(void);
+
+/**
+ * \brief Marks the start of load_update()
+ *
+ * Must be called first thing in every call of load_update()
+ */
+void prof_TickStart(void);
+
+void prof_StageEnd(profStage_t stage);
+
+/**
+ * \brief Marks the end of load_update()
+ *
+ * Updates the statistics and checks the deadline. Turns the load off
+ * if the deadline has been missed settings.deadlineTrip times in a row.
+ */
+void prof_TickEnd(void);
+
+void prof_GetData(struct profData *d);
+
+uint32_t prof_GetAverage(const struct profValue *v);
+
+/**
+ * \brief Displays the timing diagnostics of the control loop
+ */
+void prof_Display(void);
+
+#endif
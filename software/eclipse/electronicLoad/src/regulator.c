@@ -0,0 +1,78 @@
+/**
+ * \file
+ * \brief   Digital CR/CP regulator source file.
+ *
+ * PI regulator with feed-forward for the digital CR and CP modes. The
+ * feed-forward term is the current calculated from the last voltage
+ * sample, the PI part removes the remaining difference between this
+ * current and the measured current (calibration errors, voltage
+ * changes during the tick). Optionally limits the rate of change of
+ * the set current.
+ */
+#include "regulator.h"
+
+/**
+ * \brief Discards the regulator state
+ *
+ * Must be called whenever the set current is not determined by the
+ * regulator (other modes, input disabled).
+ */
+RAMFUNC void reg_Reset(void) {
+    reg.reset = 1;
+}
+
+/**
+ * \brief Calculates the set current for the digital CR/CP modes
+ *
+ * \param mode Active load mode, the state is reset on mode changes
+ * \param feedForward Current calculated from the last voltage sample in uA
+ * \param measured Measured current in uA
+ * \param max Maximum set current in uA
+ * \return Set current in uA
+ */
+RAMFUNC uint32_t reg_Update(uint8_t mode, uint32_t feedForward,
+        uint32_t measured, uint32_t max) {
+    if (reg.reset || mode != reg.mode) {
+        // start bumpless from the current that is actually flowing
+        reg.integral = 0;
+        reg.output = measured;
+        reg.feedForward = feedForward;
+        reg.mode = mode;
+        reg.reset = 0;
+    }
+    int32_t kp = REG_GAIN_FROM_PERMILLE(settings.regKp);
+    int32_t ki = REG_GAIN_FROM_PERMILLE(settings.regKi);
+    // the measured current is the response to the last update, compare
+    // it with the feed-forward current of that update. Otherwise every
+    // setpoint or voltage step would be integrated as an error.
+    int32_t error = reg.feedForward - (int32_t) measured;
+    reg.feedForward = feedForward;
+    int64_t unlimited = feedForward
+            + (((int64_t) error * kp + reg.integral) >> REG_GAIN_SHIFT);
+
+    int64_t output = unlimited;
+    if (output < 0)
+        output = 0;
+    else if (output > max)
+        output = max;
+    if (settings.regMaxRate) {
+        if (output > reg.output + (int64_t) settings.regMaxRate)
+            output = reg.output + settings.regMaxRate;
+        else if (output < reg.output - (int64_t) settings.regMaxRate)
+            output = reg.output - settings.regMaxRate;
+    }
+
+    // anti-windup: stop integrating while a limit prevents the output
+    // from following the error
+    if (!(output < unlimited && error > 0)
+            && !(output > unlimited && error < 0)) {
+        reg.integral += (int64_t) error * ki;
+        int64_t maxIntegral = (int64_t) max << REG_GAIN_SHIFT;
+        if (reg.integral > maxIntegral)
+            reg.integral = maxIntegral;
+        else if (reg.integral < -maxIntegral)
+            reg.integral = -maxIntegral;
+    }
+    reg.output = output;
+    return output;
+}
@@ -0,0 +1,57 @@
+/**
+ * \file
+ * \brief   Digital CR/CP regulator header file.
+ *
+ * PI regulator with feed-forward for the digital CR and CP modes. The
+ * feed-forward term is the current calculated from the last voltage
+ * sample, the PI part removes the remaining difference between this
+ * current and the measured current (calibration errors, voltage
+ * changes during the tick). Optionally limits the rate of change of
+ * the set current.
+ */
+#ifndef REGULATOR_H_
+#define REGULATOR_H_
+
+#include <stdint.h>
+#include "settings.h"
+
+// fractional bits of the internal gains
+#define REG_GAIN_SHIFT          10
+// converts the gains in settings (1/1000) into REG_GAIN_SHIFT
+// fractional bits without a division (1000 * 1049 >> 10 = 1024)
+#define REG_GAIN_FROM_PERMILLE(g)   (((g) * 1049UL) >> 10)
+
+struct {
+    // integral part of the correction in uA << REG_GAIN_SHIFT
+    int64_t integral;
+    // last set current in uA
+    int32_t output;
+    // feed-forward current of the last update in uA
+    int32_t feedForward;
+    // load mode the state belongs to
+    uint8_t mode;
+    // the next update starts from the measured current
+    uint8_t reset;
+} reg;
+
+/**
+ * \brief Discards the regulator state
+ *
+ * Must be called whenever the set current is not determined by the
+ * regulator (other modes, input disabled).
+ */
+void reg_Reset(void);
+
+/**
+ * \brief Calculates the set current for the digital CR/CP modes
+ *
+ * \param mode Active load mode, the state is reset on mode changes
+ * \param feedForward Current calculated from the last voltage sample in uA
+ * \param measured Measured current in uA
+ * \param max Maximum set current in uA
+ * \return Set current in uA
+ */
+uint32_t reg_Update(uint8_t mode, uint32_t feedForward, uint32_t measured,
+        uint32_t max);
+
+#endif
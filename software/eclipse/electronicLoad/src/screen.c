@@ -4,7 +4,8 @@
  *
  * Contains functions to write and draw on the display.
  * All functions don't modify the actual display content
- * but rather the internal display buffer from display.h
+ * but rather the internal display buffer from display.h.
+ * A drawn frame is shown after calling screen_Commit().
  */
 #include "screen.h"
 
@@ -1043,7 +1044,37 @@ void screen_Clear(void) {
     uint16_t i;
     for (i = 0; i < 1024; i++)
         display.buffer[i] = 0;
-    display.updateTime = timer_SetTimeout(2);
+}
+
+/**
+ * \brief Commits the drawn frame for the transfer to the display
+ *
+ * Copies the changed bytes of the display buffer into the front buffer
+ * and marks their columns for the transfer. Waits for a running
+ * transfer to complete first, thus the display never shows a partially
+ * drawn frame.
+ */
+void screen_Commit(void) {
+    // no transfer is started until the frame is committed
+    display.committing = 1;
+    while (display.transfer.running)
+        ;
+    uint16_t i;
+    for (i = 0; i < 1024; i += 64) {
+        const uint8_t *back = &display.buffer[i];
+        uint8_t *front = &display.front[i];
+        uint64_t dirty = 0;
+        uint8_t x;
+        for (x = 0; x < 64; x++) {
+            if (back[x] != front[x]) {
+                front[x] = back[x];
+                dirty |= 1ULL << x;
+            }
+        }
+        // 64 columns are one page half
+        display.dirty[i >> 7][(i >> 6) & 1] |= dirty;
+    }
+    display.committing = 0;
 }
 
 /*
@@ -1064,7 +1095,6 @@ void screen_SetPixel(uint8_t x, uint8_t y, PixelState_t s) {
     } else {
         display.buffer[byte] &= ~bit;
     }
-    display.updateTime = timer_SetTimeout(2);
 }
 
 /**
@@ -1078,30 +1108,76 @@ void screen_SetByte(uint8_t x, uint8_t page, uint8_t b) {
     if (x >= 128 || page >= 8)
         return;
     display.buffer[x + page * 128] = b;
-    display.updateTime = timer_SetTimeout(2);
 }
 
-void screen_VerticalLine(uint8_t x, uint8_t y, uint8_t length) {
-    uint8_t s = y;
-    for (; y < s + length; y++) {
-        screen_SetPixel(x, y, PIXEL_ON);
+/**
+ * \brief Sets the pixels of a vertical span in the display data buffer
+ *
+ * Sets all rows of the span that fall into one page with a single
+ * masked OR.
+ * \param x X-coordinate, (left = 0, right = 127)
+ * \param y0 Y-coordinate of the first pixel
+ * \param y1 Y-coordinate behind the last pixel, at most 64
+ */
+static void screen_VerticalSpan(uint8_t x, uint8_t y0, uint8_t y1) {
+    if (x >= 128 || y0 >= y1)
+        return;
+    uint8_t *p = &display.buffer[x + (y0 >> 3) * 128];
+    uint8_t *last = &display.buffer[x + ((y1 - 1) >> 3) * 128];
+    uint8_t mask = 0xFF << (y0 & 7);
+    for (; p < last; p += 128) {
+        *p |= mask;
+        mask = 0xFF;
     }
+    *p |= mask & (0xFF >> (7 - ((y1 - 1) & 7)));
+}
+
+/**
+ * \brief Sets the pixels of a horizontal span in the display data buffer
+ *
+ * \param x0 X-coordinate of the first pixel
+ * \param x1 X-coordinate behind the last pixel, at most 128
+ * \param y Y-coordinate, (up = 0, down = 63)
+ */
+static void screen_HorizontalSpan(uint8_t x0, uint8_t x1, uint8_t y) {
+    if (y >= 64 || x0 >= x1)
+        return;
+    uint8_t *p = &display.buffer[x0 + (y >> 3) * 128];
+    uint8_t *end = p + (x1 - x0);
+    uint8_t bit = 1 << (y & 7);
+    while (p < end)
+        *p++ |= bit;
+}
+
+void screen_VerticalLine(uint8_t x, uint8_t y, uint8_t length) {
+    uint16_t end = y + length;
+    screen_VerticalSpan(x, y, end < 64 ? end : 64);
 }
 
 void screen_HorizontalLine(uint8_t x, uint8_t y, uint8_t length) {
-    uint8_t s = x;
-    for (; x < s + length; x++) {
-        screen_SetPixel(x, y, PIXEL_ON);
-    }
+    uint16_t end = x + length;
+    screen_HorizontalSpan(x, end < 128 ? end : 128, y);
 }
 
 void screen_Line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
     uint8_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
     uint8_t dy = abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
     int8_t err = (dx > dy ? dx : -dy) / 2, e2;
+    // the pixels of a column within one page are set at once
+    uint8_t *p = NULL;
+    uint8_t mask = 0;
 
     for (;;) {
-        screen_SetPixel(x0, y0, PIXEL_ON);
+        if (x0 < 128 && y0 < 64) {
+            uint8_t *byte = &display.buffer[x0 + (y0 >> 3) * 128];
+            if (byte != p) {
+                if (p)
+                    *p |= mask;
+                p = byte;
+                mask = 0;
+            }
+            mask |= 1 << (y0 & 7);
+        }
         if (x0 == x1 && y0 == y1)
             break;
         e2 = err;
@@ -1114,6 +1190,8 @@ void screen_Line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
             y0 += sy;
         }
     }
+    if (p)
+        *p |= mask;
 }
 
 void screen_Circle(int x0, int y0, int radius) {
@@ -1158,15 +1236,13 @@ void screen_Circle(int x0, int y0, int radius) {
  * \param y2    Y-coordinate of bottom right corner
  */
 void screen_Rectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2) {
-    uint8_t i;
-    for (i = x1; i <= x2; i++) {
-        screen_SetPixel(i, y1, PIXEL_ON);
-        screen_SetPixel(i, y2, PIXEL_ON);
-    }
-    for (i = y1 + 1; i < y2; i++) {
-        screen_SetPixel(x1, i, PIXEL_ON);
-        screen_SetPixel(x2, i, PIXEL_ON);
-    }
+    uint8_t right = x2 < 128 ? x2 + 1 : 128;
+    screen_HorizontalSpan(x1, right, y1);
+    screen_HorizontalSpan(x1, right, y2);
+    uint8_t top = y1 + 1;
+    uint8_t bottom = y2 < 64 ? y2 : 64;
+    screen_VerticalSpan(x1, top, bottom);
+    screen_VerticalSpan(x2, top, bottom);
 }
 
 /**
@@ -1196,7 +1272,6 @@ void screen_InvertChar12x16(uint8_t x, uint8_t ypage) {
     for (i = 0; i < 12; i++) {
         display.buffer[x + i + ypage * 128] ^= 0xFF;
         display.buffer[x + i + (ypage + 1) * 128] ^= 0xFF;
-        display.updateTime = timer_SetTimeout(2);
     }
 }
 
@@ -1225,7 +1300,69 @@ void screen_InvertChar6x8(uint8_t x, uint8_t ypage) {
     uint8_t i;
     for (i = 0; i < 6; i++) {
         display.buffer[x + i + ypage * 128] ^= 0xFF;
-        display.updateTime = timer_SetTimeout(2);
+    }
+}
+
+/**
+ * \brief Overwrites a glyph column that spans several pages
+ *
+ * \param p Column in the page of the topmost glyph row
+ * \param page Page of the topmost glyph row
+ * \param bits Glyph column, shifted to its row within the page
+ * \param mask Rows of the glyph, shifted like bits
+ */
+static inline void screen_BlitColumn(uint8_t *p, uint8_t page, uint32_t bits,
+        uint32_t mask) {
+    for (; mask && page < 8; page++) {
+        *p = (*p & ~mask) | bits;
+        bits >>= 8;
+        mask >>= 8;
+        p += 128;
+    }
+}
+
+/**
+ * \brief Writes a 12x16 font character at any y-coordinate
+ *
+ * Shifts the glyph columns across the (up to three) pages they cover.
+ * Only the 16 rows of the character are overwritten.
+ * \param c Character to be displayed
+ * \param x X-coordinate, (left = 0, right = 127)
+ * \param y Y-coordinate of the top row, (up = 0, down = 63)
+ */
+void screen_Char12x16(char c, uint8_t x, uint8_t y) {
+    if (x >= 128 || y >= 64)
+        return;
+    uint8_t *p = &display.buffer[x + (y >> 3) * 128];
+    uint8_t shift = y & 7;
+    const char *glyph = font12x16[(uint8_t) c];
+    uint8_t i;
+    for (i = 0; i < 12 && x + i < 128; i++) {
+        uint32_t bits = (uint8_t) glyph[i * 2 + 1]
+                | (uint32_t) (uint8_t) glyph[i * 2] << 8;
+        screen_BlitColumn(p + i, y >> 3, bits << shift, 0xFFFFUL << shift);
+    }
+}
+
+/**
+ * \brief Writes a 6x8 font character at any y-coordinate
+ *
+ * Shifts the glyph columns across the two pages they cover. Only the
+ * 8 rows of the character are overwritten.
+ * \param c Character to be displayed
+ * \param x X-coordinate, (left = 0, right = 127)
+ * \param y Y-coordinate of the top row, (up = 0, down = 63)
+ */
+void screen_Char6x8(char c, uint8_t x, uint8_t y) {
+    if (x >= 128 || y >= 64)
+        return;
+    uint8_t *p = &display.buffer[x + (y >> 3) * 128];
+    uint8_t shift = y & 7;
+    const char *glyph = font6x8[(uint8_t) c];
+    uint8_t i;
+    for (i = 0; i < 6 && x + i < 128; i++) {
+        screen_BlitColumn(p + i, y >> 3, (uint32_t) (uint8_t) glyph[i] << shift,
+                0xFFUL << shift);
     }
 }
 
@@ -1263,6 +1400,34 @@ void screen_FastString6x8(const char *src, uint8_t x, uint8_t ypage) {
     }
 }
 
+/**
+ * \brief Writes a 12x16 string at any y-coordinate
+ *
+ * \param src Pointer to the string
+ * \param x X-coordinate, (left = 0, right = 127)
+ * \param y Y-coordinate of the top row, (up = 0, down = 63)
+ */
+void screen_String12x16(const char *src, uint8_t x, uint8_t y) {
+    while (*src && x < 128) {
+        screen_Char12x16(*src++, x, y);
+        x += 12;
+    }
+}
+
+/**
+ * \brief Writes a 6x8 string at any y-coordinate
+ *
+ * \param src Pointer to the string
+ * \param x X-coordinate, (left = 0, right = 127)
+ * \param y Y-coordinate of the top row, (up = 0, down = 63)
+ */
+void screen_String6x8(const char *src, uint8_t x, uint8_t y) {
+    while (*src && x < 128) {
+        screen_Char6x8(*src++, x, y);
+        x += 6;
+    }
+}
+
 void screen_SetSoftButton(const char *descr, uint8_t num) {
     // calculate descr length to center text (up to 6 chars)
     uint8_t length;
@@ -4,7 +4,8 @@
  *
  * Contains functions to write and draw on the display.
  * All functions don't modify the actual display content
- * but rather the internal display buffer from display.h
+ * but rather the internal display buffer from display.h.
+ * A drawn frame is shown after calling screen_Commit().
  */
 #ifndef SCREEN_H_
 #define SCREEN_H_
@@ -24,6 +25,15 @@ typedef enum {
  */
 void screen_Clear(void);
 
+/**
+ * \brief Commits the drawn frame for the transfer to the display
+ *
+ * Must be called when a frame is complete, e.g. before
+ * waiting for user input. Only the changes since the last
+ * commit are transferred.
+ */
+void screen_Commit(void);
+
 /*
  * \brief Sets or clears a specific pixel in the display data buffer
  *
@@ -112,6 +122,28 @@ void screen_FastChar6x8(char c, uint8_t x, uint8_t ypage);
 
 void screen_InvertChar6x8(uint8_t x,uint8_t ypage);
 
+/**
+ * \brief Writes a 12x16 font character at any y-coordinate
+ *
+ * Shifts the glyph columns across the (up to three) pages they cover.
+ * Only the 16 rows of the character are overwritten.
+ * \param c Character to be displayed
+ * \param x X-coordinate, (left = 0, right = 127)
+ * \param y Y-coordinate of the top row, (up = 0, down = 63)
+ */
+void screen_Char12x16(char c, uint8_t x, uint8_t y);
+
+/**
+ * \brief Writes a 6x8 font character at any y-coordinate
+ *
+ * Shifts the glyph columns across the two pages they cover. Only the
+ * 8 rows of the character are overwritten.
+ * \param c Character to be displayed
+ * \param x X-coordinate, (left = 0, right = 127)
+ * \param y Y-coordinate of the top row, (up = 0, down = 63)
+ */
+void screen_Char6x8(char c, uint8_t x, uint8_t y);
+
 /**
  * \brief Writes a 12x16 string into the display data buffer
  *
@@ -136,6 +168,24 @@ void screen_FastString12x16(const char *src, uint8_t x, uint8_t ypage);
  */
 void screen_FastString6x8(const char *src, uint8_t x, uint8_t ypage);
 
+/**
+ * \brief Writes a 12x16 string at any y-coordinate
+ *
+ * \param src Pointer to the string
+ * \param x X-coordinate, (left = 0, right = 127)
+ * \param y Y-coordinate of the top row, (up = 0, down = 63)
+ */
+void screen_String12x16(const char *src, uint8_t x, uint8_t y);
+
+/**
+ * \brief Writes a 6x8 string at any y-coordinate
+ *
+ * \param src Pointer to the string
+ * \param x X-coordinate, (left = 0, right = 127)
+ * \param y Y-coordinate of the top row, (up = 0, down = 63)
+ */
+void screen_String6x8(const char *src, uint8_t x, uint8_t y);
+
 /**
  * \brief Displays a soft button
  *
@@ -3,16 +3,19 @@
 uint8_t selftest_Run(void) {
     screen_Clear();
     screen_FastString6x8("Running selftest...", 0, 0);
+    screen_Commit();
     int32_t rail5V = hal_ReadVoltageRail(HAL_RAIL_P5V);
     int32_t rail15V = hal_ReadVoltageRail(HAL_RAIL_P15V);
     int32_t railn15V = hal_ReadVoltageRail(HAL_RAIL_N15V);
+    uint8_t railn15VOK = railn15V >= TELE_N15V_MIN
+            && railn15V <= TELE_N15V_MAX;
     char value[15];
 
     do {
         screen_FastString6x8("5V rail:", 0, 1);
         string_fromUintUnit(rail5V, value, 4, 3, 'V');
         screen_FastString6x8(value, 60, 1);
-        if (rail5V < 4500 || rail5V > 5500) {
+        if (rail5V < TELE_P5V_MIN || rail5V > TELE_P5V_MAX) {
             uart_writeString("selftest failed: 5V rail\n");
             break;
         }
@@ -20,7 +23,7 @@ uint8_t selftest_Run(void) {
         screen_FastString6x8("15V rail:", 0, 2);
         string_fromUintUnit(rail15V, value, 5, 3, 'V');
         screen_FastString6x8(value, 60, 2);
-        if (rail15V < 13500 || rail15V > 16500) {
+        if (rail15V < TELE_P15V_MIN || rail15V > TELE_P15V_MAX) {
             uart_writeString("selftest failed: 15V rail\n");
             break;
         }
@@ -37,12 +40,13 @@ uint8_t selftest_Run(void) {
         ptr--;
         *ptr = '-';
         screen_FastString6x8(value, 66, 3);
-        if (railn15V < 13500 || railn15V > 16500) {
+        if (!railn15VOK) {
             uart_writeString("selftest failed: -15V rail\n");
             break;
         }
 
         screen_FastString12x16("PASSED", 28, 6);
+        screen_Commit();
         uart_writeString("selftest passed.\n");
         // show 'passed' message for 5 seconds or until any button is pressed
         uint16_t wait;
@@ -56,6 +60,7 @@ uint8_t selftest_Run(void) {
         return 0;
     } while (0);
     screen_FastString12x16("FAILED", 28, 6);
+    screen_Commit();
     // wait for user input
     while (!hal_getButton())
         ;
@@ -66,6 +71,7 @@ uint8_t selftest_Run(void) {
     screen_FastString6x8("Selftest has failed.", 0, 2);
     screen_FastString6x8("Continue anyway?", 0, 3);
     screen_SetSoftButton("Yes", 2);
+    screen_Commit();
     while (!(hal_getButton() & HAL_BUTTON_SOFT2))
         ;
     while (hal_getButton())
@@ -3,6 +3,7 @@
 #define SELFTEST_H_
 
 #include "currentSink.h"
+#include "telemetry.h"
 #include "screen.h"
 
 uint8_t selftest_Run(void);
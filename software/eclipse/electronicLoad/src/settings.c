@@ -16,6 +16,14 @@ void settings_Init(void) {
     settings.minResistance[1] = LOAD_MINRESISTANCE_HIGHP;
     settings.maxResistance[1] = LOAD_MAXRESISTANCE_HIGHP;
     settings.turnOffOnError = 1;
+    settings.deadlineTrip = 0;
+    settings.analogCRCP = 0;
+    settings.regKp = SETTINGS_DEF_REG_KP;
+    settings.regKi = SETTINGS_DEF_REG_KI;
+    settings.regMaxRate = 0;
+    settings.filterType = SETTINGS_DEF_FILTER_TYPE;
+    settings.filterShift = SETTINGS_DEF_FILTER_SHIFT;
+    memset(settings.slewRate, 0, sizeof(settings.slewRate));
 }
 
 uint8_t settings_readFromFlash(void) {
@@ -40,25 +48,25 @@ void settings_writeToFlash(void) {
     FLASH_Unlock();
     FLASH_ClearFlag(
     FLASH_FLAG_BSY | FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
-    FLASH_ErasePage(0x0807E000);
+    hal_FlashErasePage(0x0807E000);
     if (sizeof(settings) >= 0x400)
-        FLASH_ErasePage(0x0807E400);
+        hal_FlashErasePage(0x0807E400);
     if (sizeof(settings) >= 0x800)
-        FLASH_ErasePage(0x0807E800);
+        hal_FlashErasePage(0x0807E800);
     if (sizeof(settings) >= 0xC00)
-        FLASH_ErasePage(0x0807EC00);
+        hal_FlashErasePage(0x0807EC00);
     // FLASH is ready to be written at this point
     uint8_t i;
     uint32_t *from = (uint32_t*) &settings;
     uint32_t *to = (uint32_t*) FLASH_SETTINGS_DATA;
     uint8_t words = (sizeof(settings) + 3) / 4;
     for (i = 0; i < words; i++) {
-        FLASH_ProgramWord((uint32_t) to, *from);
+        hal_FlashProgramWord((uint32_t) to, *from);
         to++;
         from++;
     }
     // set valid data indicator
-    FLASH_ProgramWord((uint32_t) FLASH_VALID_SETTINGS_INDICATOR,
+    hal_FlashProgramWord((uint32_t) FLASH_VALID_SETTINGS_INDICATOR,
     SETTINGS_INDICATOR);
     FLASH_Lock();
 }
@@ -80,6 +88,13 @@ void settings_Menu(void) {
         char maxResist[21] = "Max. Resist: ";
         char settingHigh[21];
         char onError[21];
+        char deadlineTrip[21] = "Deadline trip: ";
+        char analogCRCP[21];
+        char regKp[21] = "Reg. Kp: ";
+        char regKi[21] = "Reg. Ki: ";
+        char regMaxRate[21] = "Max dI:";
+        char filterType[21] = "Filter: ";
+        char filterLength[21] = "Filter len: ";
 
         if (settings.powerMode) {
             strcpy(settingHigh, "Mode: high power");
@@ -106,6 +121,35 @@ void settings_Menu(void) {
             strcpy(onError, "On error: keep on");
         }
 
+        if (settings.analogCRCP) {
+            strcpy(analogCRCP, "CR/CP: analog");
+        } else {
+            strcpy(analogCRCP, "CR/CP: digital");
+        }
+
+        string_fromUint(settings.regKp, &regKp[9], 4, 3);
+        string_fromUint(settings.regKi, &regKi[9], 4, 3);
+        if (settings.regMaxRate) {
+            string_fromUintUnit(settings.regMaxRate, &regMaxRate[7], 4, 6,
+                    'A');
+            strcat(regMaxRate, "/ms");
+        } else {
+            strcpy(&regMaxRate[7], " off");
+        }
+
+        const char filterNames[3][7] = { "boxcar", "CIC", "exp" };
+        strcpy(&filterType[8], filterNames[settings.filterType % 3]);
+        string_fromUintUnit(1 << settings.filterShift, &filterLength[12], 3,
+                0, 0);
+
+        if (settings.deadlineTrip) {
+            string_fromUint(settings.deadlineTrip, &deadlineTrip[15], 4, 0);
+            deadlineTrip[19] = 'x';
+            deadlineTrip[20] = 0;
+        } else {
+            strcpy(&deadlineTrip[15], "off");
+        }
+
         string_fromUintUnit(settings.maxCurrent[settings.powerMode],
                 &maxCurrent[13], 4, 6, 'A');
         string_fromUintUnit(settings.maxPower[settings.powerMode],
@@ -128,6 +172,13 @@ void settings_Menu(void) {
         entries[6] = minResist;
         entries[7] = maxResist;
         entries[8] = onError;
+        entries[9] = deadlineTrip;
+        entries[10] = analogCRCP;
+        entries[11] = regKp;
+        entries[12] = regKi;
+        entries[13] = regMaxRate;
+        entries[14] = filterType;
+        entries[15] = filterLength;
 
         char resetToDefault[21] = "Reset to default";
         entries[SETTINGS_NUM_ENTRIES] = resetToDefault;
@@ -174,6 +225,31 @@ void settings_Menu(void) {
             case 8:
                 settings.turnOffOnError = !settings.turnOffOnError;
                 break;
+            case 9:
+                menu_getInputValue(&settings.deadlineTrip, deadlineTrip, 0,
+                        1000, "Times", NULL, NULL);
+                break;
+            case 10:
+                settings.analogCRCP = !settings.analogCRCP;
+                break;
+            case 11:
+                menu_getInputValue(&settings.regKp, regKp, 0,
+                        SETTINGS_MAX_REG_GAIN, "/1000", NULL, NULL);
+                break;
+            case 12:
+                menu_getInputValue(&settings.regKi, regKi, 0,
+                        SETTINGS_MAX_REG_GAIN, "/1000", NULL, NULL);
+                break;
+            case 13:
+                menu_getInputValue(&settings.regMaxRate, regMaxRate, 0, maxA,
+                        "uA/ms", "mA/ms", "A/ms");
+                break;
+            case 14:
+                settings.filterType = (settings.filterType + 1) % 3;
+                break;
+            case 15:
+                settings_SelectFilterLength();
+                break;
             case SETTINGS_NUM_ENTRIES:
                 settings_ResetToDefaultMenu();
                 break;
@@ -184,6 +260,11 @@ void settings_Menu(void) {
                 settings_SaveMenu();
                 break;
             }
+            // the limits may have changed, publish the setpoint again to
+            // limit it
+            struct loadSetpoint sp;
+            load_GetSetpoint(&sp);
+            load_PublishSetpoint(&sp);
         }
     } while (sel >= 0);
 }
@@ -231,6 +312,21 @@ void settings_SelectBaudrate(void) {
     }
 }
 
+void settings_SelectFilterLength(void) {
+    char *entries[9];
+    const char availableLengths[9][4] = { "1", "2", "4", "8", "16", "32",
+            "64", "128", "256" };
+    int8_t sel;
+    for (sel = 0; sel < 9; sel++) {
+        entries[sel] = availableLengths[sel];
+    }
+    sel = menu_ItemChooseDialog("\xCD\xCDSELECT FILTER LEN\xCD\xCD",
+            entries, 9, settings.filterShift);
+    if (sel >= 0) {
+        settings.filterShift = sel;
+    }
+}
+
 void settings_ResetToDefaultMenu(void) {
     // wait for all buttons to be released
     while (hal_getButton())
@@ -241,6 +337,7 @@ void settings_ResetToDefaultMenu(void) {
     screen_SetSoftButton("No", 0);
     screen_SetSoftButton("Yes", 2);
     uint32_t button;
+    screen_Commit();
     do {
         button = hal_getButton();
     } while (!(button & (HAL_BUTTON_ESC | HAL_BUTTON_SOFT0 | HAL_BUTTON_SOFT2)));
@@ -261,6 +358,7 @@ void settings_LoadMenu(void) {
     screen_SetSoftButton("No", 0);
     screen_SetSoftButton("Yes", 2);
     uint32_t button;
+    screen_Commit();
     do {
         button = hal_getButton();
     } while (!(button & (HAL_BUTTON_ESC | HAL_BUTTON_SOFT0 | HAL_BUTTON_SOFT2)));
@@ -275,6 +373,7 @@ void settings_LoadMenu(void) {
             screen_FastString6x8("No saved values", 0, 0);
             screen_FastString6x8("available", 0, 1);
             screen_SetSoftButton("OK", 2);
+            screen_Commit();
             while (!(hal_getButton() & (HAL_BUTTON_ESC | HAL_BUTTON_SOFT2)))
                 ;
         }
@@ -291,6 +390,7 @@ void settings_SaveMenu(void) {
     screen_SetSoftButton("No", 0);
     screen_SetSoftButton("Yes", 2);
     uint32_t button;
+    screen_Commit();
     do {
         button = hal_getButton();
     } while (!(button & (HAL_BUTTON_ESC | HAL_BUTTON_SOFT0 | HAL_BUTTON_SOFT2)));
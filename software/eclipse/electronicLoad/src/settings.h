@@ -5,14 +5,15 @@
 #include "common.h"
 #include "menu.h"
 #include "stringFunctions.h"
+#include "flash.h"
 
 // position of settings in flash memory (take care not to collide with calibration data)
 #define FLASH_SETTINGS_DATA             0x0801E004
 #define FLASH_VALID_SETTINGS_INDICATOR  0x0801E000
 
-#define SETTINGS_INDICATOR              0x03
+#define SETTINGS_INDICATOR              0x08
 
-#define SETTINGS_NUM_ENTRIES            9
+#define SETTINGS_NUM_ENTRIES            16
 
 #define LOAD_MAXVOLTAGE_LOWP            100000000
 #define LOAD_MINVOLTAGE_LOWP            100000
@@ -30,6 +31,21 @@
 
 #define SETTINGS_DEF_BAUDRATE           9600
 
+// gains of the digital CR/CP regulator in 1/1000
+#define SETTINGS_DEF_REG_KP             100
+#define SETTINGS_DEF_REG_KI             100
+#define SETTINGS_MAX_REG_GAIN           4000
+
+// index of settings.slewRate, same order as loadMode_t
+#define SETTINGS_SLEW_CURRENT           0
+#define SETTINGS_SLEW_VOLTAGE           1
+#define SETTINGS_SLEW_RESISTANCE        2
+#define SETTINGS_SLEW_POWER             3
+
+// measurement filter: 16 sample boxcar
+#define SETTINGS_DEF_FILTER_TYPE        0
+#define SETTINGS_DEF_FILTER_SHIFT       4
+
 struct {
     uint32_t baudrate;
     uint8_t powerMode;
@@ -40,6 +56,23 @@ struct {
     uint32_t minResistance[2];
     uint32_t maxResistance[2];
     uint8_t turnOffOnError;
+    // number of consecutive missed control loop deadlines
+    // after which the load is turned off (0: disabled)
+    uint32_t deadlineTrip;
+    // 0: CR/CP emulated by CC mode, 1: CR/CP by the analog control loop
+    uint8_t analogCRCP;
+    // gains of the digital CR/CP regulator in 1/1000
+    uint32_t regKp;
+    uint32_t regKi;
+    // maximum change of the digital CR/CP current in uA per ms
+    // (0: unlimited)
+    uint32_t regMaxRate;
+    // measurement filter (ACQ_FILTER_x) and its length (log2)
+    uint8_t filterType;
+    uint8_t filterShift;
+    // maximum change of the setpoint per ms in uA, uV, mOhm resp. uW,
+    // indexed by SETTINGS_SLEW_x (0: step)
+    uint32_t slewRate[4];
 } settings;
 
 void settings_Init(void);
@@ -52,6 +85,8 @@ void settings_Menu(void);
 
 void settings_SelectBaudrate(void);
 
+void settings_SelectFilterLength(void);
+
 void settings_ResetToDefaultMenu(void);
 
 void settings_LoadMenu(void);
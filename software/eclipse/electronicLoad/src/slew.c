@@ -0,0 +1,88 @@
+/**
+ * \file
+ * \brief   Setpoint slew rate limiter source file.
+ *
+ * Ramps the setpoint of the active mode towards its target with the
+ * maximum rate in settings.slewRate instead of applying changes as a
+ * step. Costs a few compares per tick, the progress of the running
+ * ramp is available for the communication.
+ */
+#include "slew.h"
+
+/**
+ * \brief Discards the ramp state
+ *
+ * Must be called whenever the input is disabled, the next update
+ * starts at the setpoint that draws the least current (0A, 0W,
+ * maximum voltage resp. resistance).
+ */
+RAMFUNC void slew_Reset(void) {
+    slew.reset = 1;
+}
+
+/**
+ * \brief Returns the setpoint of a mode that draws the least current
+ */
+static RAMFUNC int32_t slew_IdleValue(uint8_t mode) {
+    switch (mode) {
+    case SETTINGS_SLEW_VOLTAGE:
+        return settings.maxVoltage[settings.powerMode];
+    case SETTINGS_SLEW_RESISTANCE:
+        return settings.maxResistance[settings.powerMode];
+    default:
+        return 0;
+    }
+}
+
+/**
+ * \brief Moves the setpoint towards its target
+ *
+ * Called from load_update() every millisecond.
+ *
+ * \param mode Active load mode, the state is reset on mode changes
+ * \param target Setpoint of the mode (uA, uV, mOhm resp. uW)
+ * \return Setpoint to apply in this tick
+ */
+RAMFUNC int32_t slew_Update(uint8_t mode, int32_t target) {
+    if (slew.reset || mode != slew.mode) {
+        slew.value = slew_IdleValue(mode);
+        slew.start = slew.value;
+        slew.target = slew.value;
+        slew.mode = mode;
+        slew.reset = 0;
+    }
+    if (target != slew.target) {
+        // a new ramp starts where the previous one is
+        slew.start = slew.value;
+        slew.target = target;
+    }
+    int32_t rate = settings.slewRate[mode & 0x03];
+    if (!rate || slew.value == target) {
+        slew.value = target;
+    } else if (target > slew.value) {
+        if (target - slew.value > rate)
+            slew.value += rate;
+        else
+            slew.value = target;
+    } else {
+        if (slew.value - target > rate)
+            slew.value -= rate;
+        else
+            slew.value = target;
+    }
+    return slew.value;
+}
+
+/**
+ * \brief Returns the progress of the running ramp
+ *
+ * \return Progress in %, 100 if the target has been reached
+ */
+uint8_t slew_Progress(void) {
+    int32_t value = slew.value;
+    int32_t target = slew.target;
+    int32_t start = slew.start;
+    if (value == target || start == target)
+        return 100;
+    return ((int64_t) (value - start) * 100) / (target - start);
+}
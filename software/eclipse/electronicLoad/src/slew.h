@@ -0,0 +1,55 @@
+/**
+ * \file
+ * \brief   Setpoint slew rate limiter header file.
+ *
+ * Ramps the setpoint of the active mode towards its target with the
+ * maximum rate in settings.slewRate instead of applying changes as a
+ * step. Costs a few compares per tick, the progress of the running
+ * ramp is available for the communication.
+ */
+#ifndef SLEW_H_
+#define SLEW_H_
+
+#include <stdint.h>
+#include "settings.h"
+
+struct {
+    // setpoint of the last update and its target
+    int32_t value;
+    int32_t target;
+    // setpoint at which the running ramp started
+    int32_t start;
+    // load mode the state belongs to
+    uint8_t mode;
+    // the next update starts at the idle setpoint
+    uint8_t reset;
+} slew;
+
+/**
+ * \brief Discards the ramp state
+ *
+ * Must be called whenever the input is disabled, the next update
+ * starts at the setpoint that draws the least current (0A, 0W,
+ * maximum voltage resp. resistance).
+ */
+void slew_Reset(void);
+
+/**
+ * \brief Moves the setpoint towards its target
+ *
+ * Called from load_update() every millisecond.
+ *
+ * \param mode Active load mode, the state is reset on mode changes
+ * \param target Setpoint of the mode (uA, uV, mOhm resp. uW)
+ * \return Setpoint to apply in this tick
+ */
+int32_t slew_Update(uint8_t mode, int32_t target);
+
+/**
+ * \brief Returns the progress of the running ramp
+ *
+ * \return Progress in %, 100 if the target has been reached
+ */
+uint8_t slew_Progress(void);
+
+#endif
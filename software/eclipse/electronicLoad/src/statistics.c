@@ -14,7 +14,7 @@ void stats_ResetValue(struct statStruct *s) {
     s->nsamples = 0;
 }
 
-void stats_UpdateValue(struct statStruct *s, uint32_t currentValue) {
+RAMFUNC void stats_UpdateValue(struct statStruct *s, uint32_t currentValue) {
     if (currentValue > s->max)
         s->max = currentValue;
     if (currentValue < s->min)
@@ -31,7 +31,7 @@ void stats_Reset(void) {
     stats.energyConsumed = 0;
 }
 
-void stats_Update(void) {
+RAMFUNC void stats_Update(void) {
     // update min/max/avg values
     stats_UpdateValue(&stats.voltage, load.state.voltage);
     stats_UpdateValue(&stats.current, load.state.current);
@@ -95,6 +95,7 @@ void stats_Display(void) {
             screen_FastChar12x16('h', 108, 2);
             screen_SetSoftButton("Max", 0);
         }
+        screen_Commit();
 
         while(hal_getButton());
         // wait for 500ms or until a button is pressed
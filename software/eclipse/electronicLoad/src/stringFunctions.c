@@ -104,7 +104,6 @@ void string_fromUintUnits(uint32_t value, char *dest, uint8_t digits,
     for (; firstDigit < digits; digits--) {
         *dest++ = ' ';
     }
-    char prefix = 0;
     uint8_t dot = 0;
     char *unit = unit0;
     // calculate prefix
@@ -155,3 +154,46 @@ int string_compare(const char *s1, const char *s2) {
     }
     return 0;
 }
+
+/**
+ * \brief Returns the value of a digit in bases up to 36
+ *
+ * \param c Character
+ * \return Value of the digit, 0xFF for any other character
+ */
+static uint8_t string_DigitValue(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A' + 10;
+    return 0xFF;
+}
+
+int32_t string_toInt(const char *s) {
+    while (*s == ' ' || (*s >= '\t' && *s <= '\r'))
+        s++;
+    uint8_t negative = 0;
+    if (*s == '-' || *s == '+')
+        negative = *s++ == '-';
+    uint8_t base = 10;
+    if (s[0] == '0') {
+        base = 8;
+        if ((s[1] == 'x' || s[1] == 'X') && string_DigitValue(s[2]) < 16) {
+            base = 16;
+            s += 2;
+        }
+    }
+    // magnitude of the limit in this direction
+    uint32_t limit = negative ? (uint32_t) INT32_MAX + 1 : INT32_MAX;
+    uint32_t value = 0;
+    uint8_t digit;
+    while ((digit = string_DigitValue(*s++)) < base) {
+        if (value > (limit - digit) / base)
+            value = limit;
+        else
+            value = value * base + digit;
+    }
+    return negative ? (int32_t) -value : (int32_t) value;
+}
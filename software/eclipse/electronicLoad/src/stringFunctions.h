@@ -98,4 +98,18 @@ void string_copyn(char *dest, const char *src, uint8_t n);
  */
 int string_compare(const char *s1, const char *s2);
 
+/**
+ * \brief Converts a string into a signed integer
+ *
+ * Like strtol(s, NULL, 0): skips leading spaces, accepts a sign and
+ * decimal, hexadecimal (0x) or octal (leading 0) numbers and stops at
+ * the first invalid character. Values out of range are limited to
+ * INT32_MIN/INT32_MAX. Unlike strtol it does not need the reentrancy
+ * data of the C library (about 1kB of RAM).
+ *
+ * \param *s String to be converted
+ * \return Value of the number, 0 if there is none
+ */
+int32_t string_toInt(const char *s);
+
 #endif
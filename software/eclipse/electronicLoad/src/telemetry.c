@@ -0,0 +1,142 @@
+/**
+ * \file
+ * \brief   AVR telemetry source file.
+ *
+ * Reads the temperature sensors and the supply rails through the ADC of
+ * the AVR in the background. load_update() starts at most one conversion
+ * per tick, the channels are visited round-robin whenever their period
+ * has elapsed. The results are filtered and converted once, readers only
+ * get the cached values.
+ */
+#include "telemetry.h"
+
+// AVR ADC channel of each telemetry channel
+static const uint8_t tele_avrChannels[TELE_NUM_CHANNELS] RAMDATA = {
+        HAL_AVR_ADC_TEMP1, HAL_AVR_ADC_TEMP2, HAL_AVR_ADC_P5V,
+        HAL_AVR_ADC_P15V, HAL_AVR_ADC_N15V };
+
+/**
+ * \brief Converts the filtered ADC result of a channel
+ */
+static RAMFUNC int16_t tele_Convert(uint8_t channel) {
+    uint16_t raw = tele.ch[channel].filtered >> TELE_FRACTION_BITS;
+    switch (channel) {
+    case TELE_TEMP1:
+    case TELE_TEMP2:
+        return hal_ConvertTemperature(raw);
+    case TELE_P5V:
+        return hal_ConvertVoltageRail(HAL_RAIL_P5V, raw);
+    case TELE_P15V:
+        return hal_ConvertVoltageRail(HAL_RAIL_P15V, raw);
+    case TELE_N15V:
+        return hal_ConvertVoltageRail(HAL_RAIL_N15V, raw);
+    }
+    return 0;
+}
+
+/**
+ * \brief Adds a conversion result to the filter of the active channel
+ *
+ * Called by the HAL once the conversion is complete.
+ */
+static RAMFUNC void tele_Complete(uint16_t raw) {
+    if (tele.active >= TELE_NUM_CHANNELS)
+        return;
+    struct teleChannel *c = &tele.ch[tele.active];
+    uint32_t sample = (uint32_t) raw << TELE_FRACTION_BITS;
+    if (!c->conversions) {
+        // start the filter at the first result
+        c->filtered = sample;
+    } else {
+        c->filtered += ((int32_t) (sample - c->filtered)) >> TELE_FILTER_SHIFT;
+    }
+    c->conversions++;
+    c->value = tele_Convert(tele.active);
+    tele.active = TELE_NUM_CHANNELS;
+}
+
+/**
+ * \brief Sets the default periods and reads all channels once
+ *
+ * Waits for the conversions, the values are valid afterwards.
+ */
+void tele_Init(void) {
+    uint8_t i;
+    tele.next = 0;
+    tele.active = TELE_NUM_CHANNELS;
+    for (i = 0; i < TELE_NUM_CHANNELS; i++) {
+        struct teleChannel *c = &tele.ch[i];
+        c->period =
+                (i == TELE_TEMP1 || i == TELE_TEMP2) ?
+                        TELE_DEF_PERIOD_TEMP : TELE_DEF_PERIOD_RAIL;
+        c->conversions = 0;
+        c->lastStart = timer.ms;
+        tele.active = i;
+        tele_Complete(hal_ReadAVRADC(tele_avrChannels[i]));
+    }
+}
+
+/**
+ * \brief Starts the conversion of the next channel that is due
+ *
+ * Called from load_update() every millisecond. Returns immediately if
+ * a conversion is still in progress or no channel is due.
+ */
+RAMFUNC void tele_Update(void) {
+    if (tele.active < TELE_NUM_CHANNELS)
+        return;
+    uint8_t i;
+    uint8_t channel = tele.next;
+    for (i = 0; i < TELE_NUM_CHANNELS; i++) {
+        struct teleChannel *c = &tele.ch[channel];
+        if (c->period && timer.ms - c->lastStart >= c->period) {
+            c->lastStart = timer.ms;
+            tele.active = channel;
+            // continue with the following channel next time
+            tele.next = channel + 1;
+            if (tele.next >= TELE_NUM_CHANNELS)
+                tele.next = 0;
+            hal_ReadAVRADCAsync(tele_avrChannels[channel], tele_Complete);
+            return;
+        }
+        if (++channel >= TELE_NUM_CHANNELS)
+            channel = 0;
+    }
+}
+
+/**
+ * \brief Changes the conversion period of a channel
+ *
+ * \param channel TELE_TEMP1, TELE_TEMP2, TELE_P5V, TELE_P15V or TELE_N15V
+ * \param ms Conversion period in ms, 0 disables the channel
+ */
+void tele_SetPeriod(uint8_t channel, uint16_t ms) {
+    if (channel < TELE_NUM_CHANNELS)
+        tele.ch[channel].period = ms;
+}
+
+/**
+ * \brief Returns the filtered value of a channel
+ *
+ * \param channel TELE_TEMP1, TELE_TEMP2, TELE_P5V, TELE_P15V or TELE_N15V
+ * \return Temperature in °C resp. voltage in mV
+ */
+RAMFUNC int16_t tele_GetValue(uint8_t channel) {
+    if (channel >= TELE_NUM_CHANNELS)
+        return 0;
+    return tele.ch[channel].value;
+}
+
+/**
+ * \brief Checks the supply rails against their allowed range
+ *
+ * \return 1 if all rails are within range, 0 otherwise
+ */
+RAMFUNC uint8_t tele_RailsOK(void) {
+    int16_t p5V = tele.ch[TELE_P5V].value;
+    int16_t p15V = tele.ch[TELE_P15V].value;
+    int16_t n15V = tele.ch[TELE_N15V].value;
+    return p5V >= TELE_P5V_MIN && p5V <= TELE_P5V_MAX && p15V >= TELE_P15V_MIN
+            && p15V <= TELE_P15V_MAX && n15V >= TELE_N15V_MIN
+            && n15V <= TELE_N15V_MAX;
+}
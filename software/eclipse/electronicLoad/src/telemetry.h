@@ -0,0 +1,101 @@
+/**
+ * \file
+ * \brief   AVR telemetry header file.
+ *
+ * Reads the temperature sensors and the supply rails through the ADC of
+ * the AVR in the background. load_update() starts at most one conversion
+ * per tick, the channels are visited round-robin whenever their period
+ * has elapsed. The results are filtered and converted once, readers only
+ * get the cached values.
+ */
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include "currentSink.h"
+#include "timer.h"
+
+#define TELE_TEMP1              0
+#define TELE_TEMP2              1
+#define TELE_P5V                2
+#define TELE_P15V               3
+#define TELE_N15V               4
+#define TELE_NUM_CHANNELS       5
+
+// default conversion periods in ms
+#define TELE_DEF_PERIOD_TEMP    100
+#define TELE_DEF_PERIOD_RAIL    50
+
+// time constant of the exponential filter in conversions (log2)
+#define TELE_FILTER_SHIFT       3
+// fractional bits of the filter state
+#define TELE_FRACTION_BITS      6
+
+// allowed range of the supply rails in mV (also used by the selftest)
+#define TELE_P5V_MIN            4500
+#define TELE_P5V_MAX            5500
+#define TELE_P15V_MIN           13500
+#define TELE_P15V_MAX           16500
+#define TELE_N15V_MIN           -16500
+#define TELE_N15V_MAX           -13500
+
+struct teleChannel {
+    // conversion period in ms (0: disabled)
+    uint16_t period;
+    // timer.ms of the last conversion start
+    uint32_t lastStart;
+    // filtered ADC result with TELE_FRACTION_BITS fractional bits
+    uint32_t filtered;
+    // converted value in °C resp. mV
+    int16_t value;
+    // number of completed conversions
+    uint32_t conversions;
+};
+
+struct {
+    struct teleChannel ch[TELE_NUM_CHANNELS];
+    // channel that is checked first in the next update
+    uint8_t next;
+    // channel with a conversion in progress (TELE_NUM_CHANNELS: none)
+    uint8_t active;
+} tele;
+
+/**
+ * \brief Sets the default periods and reads all channels once
+ *
+ * Waits for the conversions, the values are valid afterwards.
+ */
+void tele_Init(void);
+
+/**
+ * \brief Starts the conversion of the next channel that is due
+ *
+ * Called from load_update() every millisecond. Returns immediately if
+ * a conversion is still in progress or no channel is due.
+ */
+void tele_Update(void);
+
+/**
+ * \brief Changes the conversion period of a channel
+ *
+ * \param channel TELE_TEMP1, TELE_TEMP2, TELE_P5V, TELE_P15V or TELE_N15V
+ * \param ms Conversion period in ms, 0 disables the channel
+ */
+void tele_SetPeriod(uint8_t channel, uint16_t ms);
+
+/**
+ * \brief Returns the filtered value of a channel
+ *
+ * \param channel TELE_TEMP1, TELE_TEMP2, TELE_P5V, TELE_P15V or TELE_N15V
+ * \return Temperature in °C resp. voltage in mV
+ */
+int16_t tele_GetValue(uint8_t channel);
+
+/**
+ * \brief Checks the supply rails against their allowed range
+ *
+ * \return 1 if all rails are within range, 0 otherwise
+ */
+uint8_t tele_RailsOK(void);
+
+#endif
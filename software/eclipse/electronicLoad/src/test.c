@@ -52,6 +52,7 @@ void test_Font(void) {
     screen_FastString6x8("Navigate: 2,4,6,8", 0, 3);
     screen_FastString6x8("Toggle font size: 5", 0, 4);
     screen_SetSoftButton("Start", 2);
+    screen_Commit();
     while (!(hal_getButton() & HAL_BUTTON_SOFT2))
         ;
     uint8_t active = 1;
@@ -109,6 +110,7 @@ void test_Font(void) {
                         (selectedChar & 0x0f) + '7';
         screen_FastChar6x8(hex10, 114, 1);
         screen_FastChar6x8(hex1, 120, 1);
+        screen_Commit();
         uint32_t button;
         // wait for button press
         while (!(button = hal_getButton()))
@@ -199,6 +201,7 @@ void test_Buttons(void) {
     screen_SetSoftButton("Start", 0);
     screen_SetSoftButton("Start", 1);
     screen_SetSoftButton("Start", 2);
+    screen_Commit();
     while (!(hal_getButton()
             & (HAL_BUTTON_SOFT2 | HAL_BUTTON_SOFT1 | HAL_BUTTON_SOFT0)))
         ;
@@ -249,6 +252,7 @@ void test_Buttons(void) {
             screen_SetSoftButton("Soft1", 1);
         if (button & HAL_BUTTON_SOFT2)
             screen_SetSoftButton("Soft2", 2);
+        screen_Commit();
         while (hal_getButton() == button)
             ;
         button = hal_getButton();
@@ -295,6 +299,7 @@ void test_AVRGPIO(void) {
         hal_SetAVRGPIO(gpios);
         // update actual ports on AVR
         hal_UpdateAVRGPIOs();
+        screen_Commit();
 
         timer_waitms(10);
 
@@ -353,6 +358,7 @@ void test_AVRADC(void) {
             screen_FastChar6x8(':', x + 6, y);
             screen_FastString6x8(buf, x + 12, y);
         }
+        screen_Commit();
 
         timer_waitms(100);
 
@@ -384,6 +390,7 @@ void test_DAC(void) {
         screen_SetSoftButton("Value", 2);
 
         hal_setDAC(DACvalue);
+        screen_Commit();
 
         uint32_t button;
         while (!(button = hal_getButton()))
@@ -416,6 +423,7 @@ void test_ADC(void) {
         screen_FastString6x8("Raw ADC overview", 0, 0);
         // display ADC channels
         hal_SelectADCChannel(HAL_ADC_CURRENT);
+        hal_UpdateAVRGPIOs();
         timer_waitms(1);
         uint16_t adc = hal_getADC(16);
         char buf[6];
@@ -424,11 +432,13 @@ void test_ADC(void) {
         screen_FastString6x8(buf, 54, 2);
 
         hal_SelectADCChannel(HAL_ADC_VOLTAGE);
+        hal_UpdateAVRGPIOs();
         timer_waitms(1);
         adc = hal_getADC(16);
         string_fromUint(adc, buf, 5, 0);
         screen_FastString6x8("Voltage:", 0, 3);
         screen_FastString6x8(buf, 54, 3);
+        screen_Commit();
 
         timer_waitms(100);
 
@@ -456,6 +466,7 @@ void test_Snake(void) {
     string_fromUint(highscore, buf, 3, 0);
     screen_FastString6x8(buf, 60, 5);
     screen_SetSoftButton("Start", 2);
+    screen_Commit();
     while (!(hal_getButton() & HAL_BUTTON_SOFT2))
         ;
     int8_t snakeCoords[200][2];
@@ -511,6 +522,7 @@ void test_Snake(void) {
         // draw meal
         screen_Rectangle(5 + 6 * mealX, 3 + 6 * mealY, 8 + 6 * mealX,
                 6 + 6 * mealY);
+        screen_Commit();
         // handle user input
         timer_waitms(100);
         uint32_t timeout = timer_SetTimeout(400);
@@ -625,6 +637,7 @@ void test_Snake(void) {
                         3 + 6 * snakeCoords[i][1], 4);
             }
         }
+        screen_Commit();
         uint32_t timeout = timer_SetTimeout(200);
         do {
             if (hal_getButton() & HAL_BUTTON_ESC) {
@@ -652,6 +665,7 @@ void test_Snake(void) {
         highscore = points;
         screen_FastString12x16("HIGHSCORE", 10, 5);
     }
+    screen_Commit();
     while (!(hal_getButton() & HAL_BUTTON_ESC))
         ;
     while (hal_getButton())
@@ -1,5 +1,7 @@
 #include "waveforms.h"
+#include "flash.h"
 
+// stays in flash, see waveform_Update()
 const uint16_t wave_SineLookup[1025] = { 0, 101, 201, 302, 402, 503, 603, 704,
         804, 905, 1005, 1106, 1206, 1307, 1407, 1508, 1608, 1709, 1809, 1910,
         2010, 2111, 2211, 2312, 2412, 2513, 2613, 2714, 2814, 2914, 3015, 3115,
@@ -120,19 +122,23 @@ void waveform_Init(void) {
     waveform.period = 1000;
 }
 
-void waveform_Update(void) {
+RAMFUNC void waveform_Update(void) {
     static uint32_t phaseAcc;
     phaseAcc += (UINT32_MAX / waveform.period);
     waveform.phase = phaseAcc >> 16;
 
     if (waveform.form == WAVE_NONE)
         return;
+    // the sine is calculated from flash, the value is held while a flash
+    // operation would stall the control loop
+    if (waveform.form == WAVE_SINE && hal_FlashBusy())
+        return;
     if (waveform.param) {
         *(waveform.param) = waveform_GetValue(waveform.phase);
     }
 }
 
-int32_t waveform_GetValue(uint16_t wavetime) {
+RAMFUNC int32_t waveform_GetValue(uint16_t wavetime) {
     int32_t value;
     switch (waveform.form) {
     case WAVE_NONE:
@@ -163,7 +169,7 @@ int32_t waveform_GetValue(uint16_t wavetime) {
     return value;
 }
 
-int32_t waveform_Sine(uint16_t arg) {
+FLASHFUNC int32_t waveform_Sine(uint16_t arg) {
     int8_t sign;
     if (arg >= 49152) {
         sign = -1;
@@ -290,6 +296,7 @@ void waveform_Menu(void) {
             screen_Line(i, y, i - 1, y_last);
             y_last = y;
         }
+        screen_Commit();
 
         // wait for user input
         do {
@@ -329,7 +336,7 @@ void waveform_Menu(void) {
                         // This works correctly because load.mode and paramNum
                         // are using the same coding for the 4 different
                         // modes/paramters
-                        load.mode = waveform.paramNum;
+                        load_setMode(waveform.paramNum);
                     }
                 }
             } else if (selectedRow == 2) {
@@ -373,7 +380,7 @@ void waveform_Menu(void) {
                         // This works correctly because load.mode and paramNum
                         // are using the same coding for the 4 different
                         // modes/paramters
-                        load.mode = waveform.paramNum;
+                        load_setMode(waveform.paramNum);
                     }
                 }
             }
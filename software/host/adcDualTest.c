@@ -0,0 +1,118 @@
+/**
+ * \file
+ * \brief   Host test for reading two ADCs in the same SPI burst.
+ *
+ * Simulates two ADCs shifting out their 24 bit frames on DOUT1 (PC14)
+ * and DOUT2 (PC13) and runs the sampling loop of hal_ConvertADCDual()
+ * against the simulated GPIOC->IDR. Both results must be bit-identical
+ * to what the single channel loop of hal_ConvertADC() returns for the
+ * same frame.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "adcDual.h"
+
+#define TEST_RANDOM_FRAMES      100000
+
+// simulated state of both converters during a burst
+static struct {
+    uint32_t frame[2];
+    uint8_t bit;
+    // pins on GPIOC that are not driven by the converters
+    uint32_t otherPins;
+} sim;
+
+static void sim_Start(uint32_t dout1, uint32_t dout2, uint32_t otherPins) {
+    sim.frame[0] = dout1 & 0xFFFFFF;
+    sim.frame[1] = dout2 & 0xFFFFFF;
+    sim.bit = 0;
+    sim.otherPins = otherPins & ~HAL_DUAL_DOUT_MASK;
+}
+
+// value of GPIOC->IDR while the current bit is presented (MSB first)
+static uint32_t sim_ReadIDR(void) {
+    uint32_t idr = sim.otherPins;
+    if (sim.frame[0] & (0x800000 >> sim.bit))
+        idr |= 0x4000;
+    if (sim.frame[1] & (0x800000 >> sim.bit))
+        idr |= 0x2000;
+    return idr;
+}
+
+// clock pulse, the converters present the next bit afterwards
+static void sim_Clock(void) {
+    sim.bit++;
+}
+
+/**
+ * \brief Reference: single channel loop of hal_ConvertADC() on DOUT1
+ */
+static uint16_t test_ReadSingle(void) {
+    uint32_t adc = 0;
+    uint8_t p;
+    for (p = 0; p < 24; p++) {
+        adc <<= 1;
+        if (sim_ReadIDR() & 0x4000)
+            adc |= 0x01;
+        sim_Clock();
+    }
+    return adc;
+}
+
+/**
+ * \brief Loop of hal_ConvertADCDual()
+ */
+static void test_ReadDual(uint16_t *dout1, uint16_t *dout2) {
+    uint32_t word = 0;
+    uint8_t p;
+    for (p = 0; p < 24; p++) {
+        word = hal_DualADCShift(word, sim_ReadIDR());
+        sim_Clock();
+    }
+    hal_DualADCSplit(word, dout1, dout2);
+}
+
+static uint32_t test_Frame(uint32_t a, uint32_t b, uint32_t otherPins) {
+    // the second converter on its own is read through DOUT1 as well
+    sim_Start(a, 0, otherPins);
+    uint16_t expected1 = test_ReadSingle();
+    sim_Start(b, 0, otherPins);
+    uint16_t expected2 = test_ReadSingle();
+
+    uint16_t dout1, dout2;
+    sim_Start(a, b, otherPins);
+    test_ReadDual(&dout1, &dout2);
+    if (dout1 != expected1 || dout2 != expected2) {
+        printf("FAIL: frames %06x/%06x: got %04x/%04x, expected %04x/%04x\n",
+                a, b, dout1, dout2, expected1, expected2);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    const uint32_t patterns[] = { 0x000000, 0xFFFFFF, 0x00FFFF, 0xFF0000,
+            0x005555, 0x00AAAA, 0x008000, 0x000001, 0xA5C3E1 };
+    const uint32_t npatterns = sizeof(patterns) / sizeof(patterns[0]);
+    uint32_t failures = 0;
+    uint32_t tests = 0;
+    uint32_t i, j;
+    for (i = 0; i < npatterns; i++) {
+        for (j = 0; j < npatterns; j++) {
+            // other inputs on GPIOC must not influence the results
+            failures += test_Frame(patterns[i], patterns[j], 0);
+            failures += test_Frame(patterns[i], patterns[j], 0xFFFF);
+            tests += 2;
+        }
+    }
+    srand(1);
+    for (i = 0; i < TEST_RANDOM_FRAMES; i++) {
+        uint32_t a = ((uint32_t) rand() << 8) ^ rand();
+        uint32_t b = ((uint32_t) rand() << 8) ^ rand();
+        failures += test_Frame(a, b, rand());
+        tests++;
+    }
+    printf("adcDualTest: %u frames, %u failures\n", tests, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * \file
+ * \brief   Host test for the AVR GPIO frames of the control loop.
+ *
+ * The HAL setters only stage the AVR pins, load_update() and the
+ * acquisition commit them once. This test switches between all load
+ * modes (analog and digital CR/CP, both shunts, calibration, input
+ * off) and checks the exact number of frames on the bus: one frame in
+ * the tick that changes the shunt and/or the control mode, none in
+ * the following ticks, and one frame per channel switch of the
+ * acquisition. It also checks the pins the AVR ends up with.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "loadFunctions.h"
+#include "halStub.h"
+
+// ticks before and after the mode change
+#define TEST_TICKS              50
+// acquisition steps checked individually
+#define TEST_ACQ_STEPS          1000
+
+#define TEST_MODE_PINS          (HAL_GPIO_MODE_A | HAL_GPIO_MODE_B)
+#define TEST_SHUNT_PINS         (HAL_GPIO_SHUNT_EN1 | HAL_GPIO_SHUNT_EN2 \
+        | HAL_GPIO_SHUNTSEL)
+
+typedef struct {
+    const char *name;
+    // changes the load configuration after TEST_TICKS
+    void (*setup)(void);
+    // expected AVR pins (without the analog mux)
+    uint8_t pins;
+} testCase_t;
+
+static void test_Reset(void) {
+    halStub_ResetLoop();
+    load.powerOn = 1;
+    load.current = 1000000;
+    load.voltage = 5000000;
+    load.resistance = 10000;
+    load.power = 5000000;
+}
+
+static void test_CC(void) {
+    load.mode = FUNCTION_CC;
+}
+
+static void test_CV(void) {
+    load.mode = FUNCTION_CV;
+}
+
+static void test_CRDigital(void) {
+    load.mode = FUNCTION_CR;
+}
+
+static void test_CPDigital(void) {
+    load.mode = FUNCTION_CP;
+}
+
+static void test_CRAnalog(void) {
+    settings.analogCRCP = 1;
+    load.mode = FUNCTION_CR;
+}
+
+static void test_CPAnalog(void) {
+    settings.analogCRCP = 1;
+    load.mode = FUNCTION_CP;
+}
+
+static void test_CVHighPower(void) {
+    // shunt and control mode change in the same tick
+    settings.powerMode = 1;
+    load.mode = FUNCTION_CV;
+}
+
+static void test_CPHighPower(void) {
+    settings.powerMode = 1;
+    settings.analogCRCP = 1;
+    load.mode = FUNCTION_CP;
+}
+
+static void test_InputOff(void) {
+    load.powerOn = 0;
+    load.mode = FUNCTION_CR;
+}
+
+static void test_CalibrationCR(void) {
+    // digital CR still calibrates the analog loop
+    cal.active = 1;
+    load.mode = FUNCTION_CR;
+}
+
+static const testCase_t test_Cases[] = {
+        { "CC", test_CC, HAL_GPIO_SHUNT_EN1 },
+        { "CV", test_CV, HAL_GPIO_SHUNT_EN1 | HAL_GPIO_MODE_A },
+        { "CR digital", test_CRDigital, HAL_GPIO_SHUNT_EN1 },
+        { "CP digital", test_CPDigital, HAL_GPIO_SHUNT_EN1 },
+        { "CR analog", test_CRAnalog, HAL_GPIO_SHUNT_EN1 | HAL_GPIO_MODE_A
+                | HAL_GPIO_MODE_B },
+        { "CP analog", test_CPAnalog, HAL_GPIO_SHUNT_EN1 | HAL_GPIO_MODE_B },
+        { "CV high power", test_CVHighPower, HAL_GPIO_SHUNT_EN2
+                | HAL_GPIO_SHUNTSEL | HAL_GPIO_MODE_A },
+        { "CP high power", test_CPHighPower, HAL_GPIO_SHUNT_EN2
+                | HAL_GPIO_SHUNTSEL | HAL_GPIO_MODE_B },
+        { "input off", test_InputOff, HAL_GPIO_SHUNT_EN1 },
+        { "calibration CR", test_CalibrationCR, HAL_GPIO_SHUNT_EN1
+                | HAL_GPIO_MODE_A | HAL_GPIO_MODE_B } };
+
+/**
+ * \brief Runs one tick and returns the frames sent by load_update()
+ */
+static uint32_t test_Tick(void) {
+    halStub_Tick();
+    halStub_ResetCounters();
+    load_update();
+    return halStub.avrFrames;
+}
+
+/**
+ * \brief Checks the frames of a mode change
+ *
+ * \return Number of failures
+ */
+static uint32_t test_ModeChange(const testCase_t *c) {
+    uint32_t i, failures = 0;
+    test_Reset();
+    for (i = 0; i < TEST_TICKS; i++)
+        test_Tick();
+    uint8_t before = halStub.avrPins & (TEST_MODE_PINS | TEST_SHUNT_PINS);
+    c->setup();
+    uint32_t expected = before != c->pins;
+    uint32_t frames = test_Tick();
+    uint8_t pins = halStub.avrPins & (TEST_MODE_PINS | TEST_SHUNT_PINS);
+    uint32_t later = 0;
+    for (i = 0; i < TEST_TICKS; i++)
+        later += test_Tick();
+    uint8_t ok = frames == expected && pins == c->pins && !later;
+    printf("%-16s %6u %8u %8u   0x%02x   0x%02x %s\n", c->name, expected,
+            frames, later, c->pins, pins, ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+    return failures;
+}
+
+/**
+ * \brief Checks that the acquisition sends one frame per channel switch
+ *
+ * \return Number of failures
+ */
+static uint32_t test_Acquisition(void) {
+    uint32_t i, failures = 0, frames = 0, switches = 0;
+    test_Reset();
+    test_Tick();
+    for (i = 0; i < TEST_ACQ_STEPS; i++) {
+        uint8_t mux = hal.AVRgpio & HAL_GPIO_ANALOG_MUX;
+        uint8_t start = acq.step == 0;
+        halStub_ResetCounters();
+        acq_Update();
+        uint8_t switched = start
+                && (hal.AVRgpio & HAL_GPIO_ANALOG_MUX) != mux;
+        if (halStub.avrFrames != switched)
+            failures++;
+        frames += halStub.avrFrames;
+        switches += switched;
+    }
+    printf("acquisition: %u steps, %u channel switches, %u frames %s\n",
+            TEST_ACQ_STEPS, switches, frames, failures ? "FAIL" : "");
+#ifndef HAL_DUAL_ADC
+    // the channels must alternate at all
+    if (!switches)
+        failures++;
+#endif
+    return failures;
+}
+
+int main(void) {
+    uint8_t i;
+    uint32_t failures = 0;
+    printf("%-16s %6s %8s %8s %6s %6s\n", "mode change", "expect", "frames",
+            "later", "pins", "AVR");
+    for (i = 0; i < sizeof(test_Cases) / sizeof(test_Cases[0]); i++)
+        failures += test_ModeChange(&test_Cases[i]);
+    failures += test_Acquisition();
+    printf("avrFrameTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
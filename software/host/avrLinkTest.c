@@ -0,0 +1,139 @@
+/**
+ * \file
+ * \brief   Host test for the AVR link edge sequence.
+ *
+ * Replays the sequences of hal_AVRBuildFrame() on a model of the port
+ * pins and an SPI slave (mode 0, MSB first) and checks:
+ * - the AVR is selected for the whole frame and deselected afterwards
+ * - the data is stable for at least one slot before every rising clock
+ *   edge and matches the sent word
+ * - the clock pulses are at least 250ns long and the gaps between the
+ *   bytes at least 6us
+ * - hal_AVRDecodeFrame() returns the word shifted out by the slave
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "avrLink.h"
+
+#define TEST_RANDOM_FRAMES      100000
+// minimum clock pulse length of the AVR in ns
+#define TEST_MIN_PULSE_NS       250
+// minimum gap between two bytes in ns
+#define TEST_MIN_GAP_NS         6000
+#define TEST_SLOT_NS            (HAL_AVR_SLOT_CYCLES * 1000.0 / 72)
+
+struct testPins {
+    uint32_t a, c;
+};
+
+static void test_Apply(uint32_t *port, uint32_t bsrr) {
+    *port |= bsrr & 0xFFFF;
+    *port &= ~(bsrr >> 16);
+}
+
+static uint8_t test_Selected(const struct testPins *p) {
+    return (p->a & (HAL_AVR_PIN_CS_A | HAL_AVR_PIN_CS_B))
+            == (HAL_AVR_PIN_CS_A | HAL_AVR_PIN_CS_B);
+}
+
+/**
+ * \brief Replays a frame
+ *
+ * \param word Word sent by the master
+ * \param response Word shifted out by the slave
+ * \return 0 if the frame is correct, 1 otherwise
+ */
+static uint8_t test_Frame(uint32_t word, uint8_t bits, uint32_t response) {
+    static struct halAVRFrame f;
+    static uint16_t idr[HAL_AVR_MAX_SLOTS];
+    if (!hal_AVRBuildFrame(&f, word, bits) || f.slots > HAL_AVR_MAX_SLOTS)
+        return 1;
+    struct testPins pins = { 0, 0 };
+    uint32_t received = 0;
+    uint8_t edges = 0;
+    // slot of the last data and clock change
+    int32_t dataChange = -1;
+    int32_t clockChange = -1;
+    uint8_t dout = (response >> (bits - 1)) & 0x01;
+    uint16_t i;
+    for (i = 0; i < f.slots; i++) {
+        struct testPins old = pins;
+        test_Apply(&pins.a, f.porta[i]);
+        test_Apply(&pins.c, f.portc[i]);
+        if ((pins.c ^ old.c) & HAL_AVR_PIN_DIN)
+            dataChange = i;
+        uint32_t clk = pins.a & HAL_AVR_PIN_CLK;
+        // duration of the phase that ends with this slot
+        double phase = (i - clockChange) * TEST_SLOT_NS;
+        if (clk != (old.a & HAL_AVR_PIN_CLK)) {
+            if (clockChange >= 0 && phase < TEST_MIN_PULSE_NS)
+                return 1;
+            clockChange = i;
+        }
+        if (clk && !(old.a & HAL_AVR_PIN_CLK)) {
+            // rising edge: the slave samples DIN
+            if (!test_Selected(&pins) || dataChange >= i)
+                return 1;
+            // the first bit of a byte follows the gap
+            if (edges && !(edges & 0x07) && phase < TEST_MIN_GAP_NS)
+                return 1;
+            received = (received << 1) | ((pins.c & HAL_AVR_PIN_DIN) ? 1 : 0);
+            edges++;
+        }
+        if (!clk && (old.a & HAL_AVR_PIN_CLK) && edges < bits) {
+            // falling edge: the slave shifts out the next bit
+            dout = (response >> (bits - 1 - edges)) & 0x01;
+        }
+        // sampled at the end of the slot
+        idr[i] = dout ? HAL_AVR_PIN_DOUT : 0;
+    }
+    if (test_Selected(&pins) || (pins.a & HAL_AVR_PIN_CLK)
+            || (pins.c & HAL_AVR_PIN_DIN))
+        return 1;
+    uint32_t mask = bits < 32 ? (1UL << bits) - 1 : 0xFFFFFFFF;
+    if (edges != bits || received != (word & mask))
+        return 1;
+    if (hal_AVRDecodeFrame(&f, idr) != (response & mask))
+        return 1;
+    return 0;
+}
+
+int main(void) {
+    uint32_t failures = 0;
+    uint32_t i;
+    static struct halAVRFrame f;
+
+    if (TEST_SLOT_NS < TEST_MIN_PULSE_NS) {
+        printf("slot of %.0fns is shorter than %uns\n", TEST_SLOT_NS,
+                TEST_MIN_PULSE_NS);
+        failures++;
+    }
+    // invalid lengths
+    if (hal_AVRBuildFrame(&f, 0, 0) || hal_AVRBuildFrame(&f, 0, 12)
+            || hal_AVRBuildFrame(&f, 0, HAL_AVR_MAX_BITS + 8))
+        failures++;
+
+    // frames used by the HAL: pin update and ADC read
+    for (i = 0; i < 0x80; i++)
+        failures += test_Frame(i, 8, 0);
+    for (i = 0; i < 9; i++)
+        failures += test_Frame(0x00C08080 | (i << 16), 24, 0x3FF - i * 100);
+
+    uint32_t frames = 0;
+    for (i = 0; i < TEST_RANDOM_FRAMES; i++) {
+        uint8_t bits = 8 * (1 + rand() % (HAL_AVR_MAX_BITS / 8));
+        uint32_t word = ((uint32_t) rand() << 16) ^ rand();
+        uint32_t response = ((uint32_t) rand() << 16) ^ rand();
+        failures += test_Frame(word, bits, response);
+        frames++;
+    }
+    hal_AVRBuildFrame(&f, 0, 8);
+    uint16_t slots8 = f.slots;
+    hal_AVRBuildFrame(&f, 0, 24);
+    printf("slot %.0fns, 8 bit frame %u slots (%.1fus), 24 bit frame %u slots"
+            " (%.1fus)\n", TEST_SLOT_NS, slots8, slots8 * TEST_SLOT_NS / 1000,
+            f.slots, f.slots * TEST_SLOT_NS / 1000);
+    printf("avrLinkTest: %u random frames, %u failures\n", frames, failures);
+    return failures ? 1 : 0;
+}
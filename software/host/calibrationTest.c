@@ -0,0 +1,290 @@
+/**
+ * \file
+ * \brief   Host test for the fixed point calibration coefficients.
+ *
+ * Compares the measurement conversion over the full 16 bit ADC range
+ * and the setpoint conversion over the full DAC range against the
+ * previous common_Map() implementation and against the exact result,
+ * for several calibrations and both power modes.
+ *
+ * The new conversion rounds to nearest and must stay within one LSB of
+ * the exact value. The setpoints are tested in steps smaller than one
+ * DAC LSB (1uA resp. 3uA for current, 7uV for voltage), so every DAC
+ * code is hit many times. The analog CP and CR setpoints are compared
+ * against the commented out common_Map() implementation they replaced.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "loadFunctions.h"
+#include "halStub.h"
+
+struct testResult {
+    // maximum deviation from the exact result
+    double maxErrorNew, maxErrorOld;
+    // maximum difference between new and old result
+    int32_t maxDiff;
+    uint32_t values;
+};
+
+static void test_Update(struct testResult *r, int32_t newValue,
+        int32_t oldValue, double exact) {
+    double errNew = fabs(newValue - exact);
+    double errOld = fabs(oldValue - exact);
+    int32_t diff = abs(newValue - oldValue);
+    if (errNew > r->maxErrorNew)
+        r->maxErrorNew = errNew;
+    if (errOld > r->maxErrorOld)
+        r->maxErrorOld = errOld;
+    if (diff > r->maxDiff)
+        r->maxDiff = diff;
+    r->values++;
+}
+
+static double test_Exact(int32_t table[2][2], uint8_t from, double value) {
+    uint8_t to = !from;
+    return table[0][to]
+            + (value - table[0][from]) * (table[1][to] - table[0][to])
+                    / (table[1][from] - table[0][from]);
+}
+
+static double test_Clamp(double value, double min, double max) {
+    if (value < min)
+        return min;
+    if (value > max)
+        return max;
+    return value;
+}
+
+static void test_CurrentSense(struct testResult *r) {
+    uint32_t adc;
+    for (adc = 0; adc <= UINT16_MAX; adc++) {
+        acq.ch[HAL_ADC_CURRENT].filter.result = adc << ACQ_FRACTION_BITS;
+        int32_t newValue = cal_getCurrent();
+        // previous implementation
+        int32_t oldValue = common_Map(adc, calData.currentSenseTable[0][0],
+                calData.currentSenseTable[1][0],
+                calData.currentSenseTable[0][1],
+                calData.currentSenseTable[1][1]);
+        if (settings.powerMode)
+            oldValue = ((int64_t) oldValue * calData.shuntFactor) / 100;
+        if (oldValue < 0)
+            oldValue = 0;
+        double exact = test_Exact(calData.currentSenseTable, 0, adc);
+        if (settings.powerMode)
+            exact = exact * calData.shuntFactor / 100;
+        test_Update(r, newValue, oldValue, test_Clamp(exact, 0, INT32_MAX));
+    }
+}
+
+static void test_VoltageSense(struct testResult *r) {
+    uint32_t adc;
+    for (adc = 0; adc <= UINT16_MAX; adc++) {
+        acq.ch[HAL_ADC_VOLTAGE].filter.result = adc << ACQ_FRACTION_BITS;
+        int32_t newValue = cal_getVoltage();
+        int32_t oldValue = common_Map(adc, calData.voltageSenseTable[0][0],
+                calData.voltageSenseTable[1][0],
+                calData.voltageSenseTable[0][1],
+                calData.voltageSenseTable[1][1]);
+        if (oldValue < 0)
+            oldValue = 0;
+        double exact = test_Exact(calData.voltageSenseTable, 0, adc);
+        test_Update(r, newValue, oldValue, test_Clamp(exact, 0, INT32_MAX));
+    }
+}
+
+static void test_CurrentSet(struct testResult *r) {
+    uint32_t uA;
+    uint32_t max = settings.maxCurrent[settings.powerMode];
+    uint32_t step = settings.powerMode ? 3 : 1;
+    for (uA = 0; uA <= max; uA += step) {
+        cal_setCurrent(uA);
+        int32_t newValue = halStub.dac;
+        uint32_t scaled = uA;
+        if (settings.powerMode)
+            scaled = ((int64_t) uA * 100) / calData.shuntFactor;
+        int32_t oldValue = common_Map(scaled, calData.currentSetTable[0][1],
+                calData.currentSetTable[1][1],
+                calData.currentSetTable[0][0],
+                calData.currentSetTable[1][0]);
+        oldValue = test_Clamp(oldValue, 0, HAL_DAC_MAX);
+        double exact = uA;
+        if (settings.powerMode)
+            exact = exact * 100 / calData.shuntFactor;
+        exact = test_Exact(calData.currentSetTable, 1, exact);
+        test_Update(r, newValue, oldValue, test_Clamp(exact, 0, HAL_DAC_MAX));
+    }
+}
+
+static void test_VoltageSet(struct testResult *r) {
+    uint32_t uV;
+    uint32_t min = settings.minVoltage[settings.powerMode];
+    uint32_t max = settings.maxVoltage[settings.powerMode];
+    for (uV = min; uV <= max; uV += 7) {
+        cal_setVoltage(uV);
+        int32_t newValue = halStub.dac;
+        int32_t oldValue = common_Map(uV, calData.voltageSetTable[0][1],
+                calData.voltageSetTable[1][1],
+                calData.voltageSetTable[0][0],
+                calData.voltageSetTable[1][0]);
+        oldValue = test_Clamp(oldValue, 0, HAL_DAC_MAX);
+        double exact = test_Exact(calData.voltageSetTable, 1, uV);
+        test_Update(r, newValue, oldValue, test_Clamp(exact, 0, HAL_DAC_MAX));
+    }
+}
+
+static void test_PowerSet(struct testResult *r) {
+    uint32_t uW;
+    uint32_t max = settings.maxPower[settings.powerMode];
+    uint32_t step = max / 1000000 + 1;
+    for (uW = 0; uW <= max; uW += step) {
+        cal_setPower(uW);
+        int32_t newValue = halStub.dac;
+        uint32_t scaled = uW;
+        if (settings.powerMode)
+            scaled = ((int64_t) uW * 100) / calData.shuntFactor;
+        int32_t oldValue = common_Map(scaled, calData.powerSetTable[0][1],
+                calData.powerSetTable[1][1], calData.powerSetTable[0][0],
+                calData.powerSetTable[1][0]);
+        oldValue = test_Clamp(oldValue, 0, HAL_DAC_MAX);
+        double exact = uW;
+        if (settings.powerMode)
+            exact = exact * 100 / calData.shuntFactor;
+        exact = test_Exact(calData.powerSetTable, 1, exact);
+        test_Update(r, newValue, oldValue, test_Clamp(exact, 0, HAL_DAC_MAX));
+    }
+}
+
+static void test_ResistanceSet(struct testResult *r) {
+    uint32_t mR;
+    uint32_t min = settings.minResistance[settings.powerMode];
+    uint32_t max = settings.maxResistance[settings.powerMode];
+    // logarithmic steps, the conductance changes fastest at low resistance
+    for (mR = min; mR <= max; mR += mR / 10000 + 1) {
+        cal_setResistance(mR);
+        int32_t newValue = halStub.dac;
+        uint32_t scaled = mR;
+        if (settings.powerMode)
+            scaled = ((int64_t) mR * calData.shuntFactor) / 100;
+        int32_t uS = ((int64_t) 1000000000LL) / scaled;
+        int32_t oldValue = common_Map(uS, calData.conductanceSetTable[0][1],
+                calData.conductanceSetTable[1][1],
+                calData.conductanceSetTable[0][0],
+                calData.conductanceSetTable[1][0]);
+        oldValue = test_Clamp(oldValue, 0, HAL_DAC_MAX);
+        double exact = 1e9 / mR;
+        if (settings.powerMode)
+            exact = exact * 100 / calData.shuntFactor;
+        exact = test_Exact(calData.conductanceSetTable, 1, exact);
+        test_Update(r, newValue, oldValue, test_Clamp(exact, 0, HAL_DAC_MAX));
+    }
+}
+
+static void test_SetTable(int32_t table[2][2], int32_t raw0, int32_t value0,
+        int32_t raw1, int32_t value1) {
+    table[0][0] = raw0;
+    table[0][1] = value0;
+    table[1][0] = raw1;
+    table[1][1] = value1;
+}
+
+/**
+ * \brief Typical result of the calibration routines
+ */
+static void test_SetMeasuredCalibration(void) {
+    test_SetTable(calData.currentSetTable, 321, 1012, 57800, 181234);
+    test_SetTable(calData.currentSenseTable, 297, 1012, 53210, 181234);
+    test_SetTable(calData.voltageSetTable, 624, 1003211, 18096, 29012345);
+    test_SetTable(calData.voltageSenseTable, 611, 1003211, 17987, 29012345);
+    test_SetTable(calData.powerSetTable, 321, 10123, 57870, 1801234);
+    test_SetTable(calData.conductanceSetTable, 328, 1012, 5907, 18123);
+    calData.shuntFactor = 9876;
+}
+
+/**
+ * \brief Calibration with large offsets, negative values at ADC/DAC zero
+ */
+static void test_SetOffsetCalibration(void) {
+    test_SetTable(calData.currentSetTable, 2345, 1000, 60000, 190000);
+    test_SetTable(calData.currentSenseTable, 1234, 1000, 61000, 190000);
+    test_SetTable(calData.voltageSetTable, 3000, 1000000, 20000, 29000000);
+    test_SetTable(calData.voltageSenseTable, 2500, 1000000, 19000, 29000000);
+    test_SetTable(calData.powerSetTable, 2000, 10000, 60000, 1900000);
+    test_SetTable(calData.conductanceSetTable, 700, 1000, 6000, 18000);
+    calData.shuntFactor = 10123;
+}
+
+/**
+ * \brief Erased calibration data, all tables and the shunt factor read
+ * back as 0xFF
+ */
+static void test_SetErasedCalibration(void) {
+    memset(&calData, 0xFF, sizeof(calData));
+}
+
+/**
+ * \brief Calibration with equal points in some tables, these fall back to
+ * the default
+ */
+static void test_SetEqualPointsCalibration(void) {
+    test_SetMeasuredCalibration();
+    test_SetTable(calData.currentSetTable, 321, 1012, 321, 181234);
+    test_SetTable(calData.voltageSenseTable, 611, 1003211, 17987, 1003211);
+    test_SetTable(calData.conductanceSetTable, 0, 0, 0, 0);
+    calData.shuntFactor = 0;
+}
+
+typedef struct {
+    const char *name;
+    void (*test)(struct testResult *r);
+    // unit of the result
+    const char *unit;
+} testCase_t;
+
+static const testCase_t test_Cases[] = {
+        { "current sense", test_CurrentSense, "uA" },
+        { "voltage sense", test_VoltageSense, "uV" },
+        { "current set", test_CurrentSet, "LSB" },
+        { "voltage set", test_VoltageSet, "LSB" },
+        { "power set", test_PowerSet, "LSB" },
+        { "resistance set", test_ResistanceSet, "LSB" } };
+
+int main(void) {
+    const struct {
+        const char *name;
+        void (*setup)(void);
+    } calibrations[] = { { "default", cal_setDefaultCalibration }, {
+            "measured", test_SetMeasuredCalibration }, { "offset",
+            test_SetOffsetCalibration }, { "erased",
+            test_SetErasedCalibration }, { "equal",
+            test_SetEqualPointsCalibration } };
+    uint8_t i, j, mode;
+    uint32_t failures = 0;
+    settings_Init();
+    printf("%-9s %-4s %-14s %9s %9s %9s %7s\n", "cal", "mode", "conversion",
+            "values", "err new", "err old", "diff");
+    for (i = 0; i < sizeof(calibrations) / sizeof(calibrations[0]); i++) {
+        cal_setDefaultCalibration();
+        calibrations[i].setup();
+        cal_UpdateCoefficients();
+        for (mode = 0; mode < 2; mode++) {
+            settings.powerMode = mode;
+            for (j = 0; j < sizeof(test_Cases) / sizeof(test_Cases[0]); j++) {
+                struct testResult r;
+                memset(&r, 0, sizeof(r));
+                test_Cases[j].test(&r);
+                uint8_t ok = r.maxErrorNew < 1.0;
+                printf("%-9s %-4s %-14s %9u %9.3f %9.3f %7d %s %s\n",
+                        calibrations[i].name, mode ? "high" : "low",
+                        test_Cases[j].name, r.values, r.maxErrorNew,
+                        r.maxErrorOld, r.maxDiff, test_Cases[j].unit,
+                        ok ? "" : "FAIL");
+                if (!ok)
+                    failures++;
+            }
+        }
+    }
+    printf("calibrationTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
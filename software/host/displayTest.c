@@ -0,0 +1,221 @@
+/**
+ * \file
+ * \brief   Host test for the display refresh.
+ *
+ * Draws typical screens with the screen functions, commits them with
+ * screen_Commit() and transfers them with hal_updateDisplay() to the
+ * KS0108 model of the HAL stub. Checks that
+ * - the display RAM equals the committed frame after every transfer
+ * - the first transfer after the initialization sends the complete
+ *   buffer
+ * - the transfer completes in steps called from the timer, one step
+ *   per byte
+ * - redrawing an unchanged screen doesn't transfer anything
+ * - changing a digit of the readout only transfers its columns
+ * - clearing and redrawing the screen (like the menus do) doesn't
+ *   transfer anything
+ * - nothing is transferred before the frame is committed
+ * - scattered changes are transferred with few address commands
+ * - the data bus words of every byte value drive exactly the data bus
+ *   pins of the board
+ * The command and data bytes of every transfer are reported.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "screen.h"
+#include "halStub.h"
+
+static void test_Reset(void) {
+    halStub_ResetLoop();
+    memset(&display, 0, sizeof(display));
+    memset(&timer, 0, sizeof(timer));
+    // the panel content is undefined after power up
+    memset(halStub.panel, 0xA5, sizeof(halStub.panel));
+}
+
+/**
+ * \brief Draws a screen like the main menu does
+ *
+ * \param readout Value of the large readout
+ */
+static void test_MainScreen(const char *readout) {
+    screen_FastString12x16(readout, 0, 0);
+    screen_FastString6x8("mA", 86, 0);
+    screen_FastString6x8("A", 86, 1);
+    screen_FastString6x8("12.000V", 62, 2);
+    screen_FastString6x8("CC-Mode:", 0, 3);
+    screen_FastString6x8("1.2345", 78, 3);
+    screen_FastChar6x8('A', 114, 3);
+    screen_SetSoftButton("\x1b", 0);
+    screen_SetSoftButton("\x1a", 1);
+    screen_SetSoftButton("Menu", 2);
+}
+
+/**
+ * \brief Commits the frame, transfers it and checks the display content
+ *
+ * \param name Description of the transfer
+ * \param maxCommands Upper limit for the command bytes
+ * \param maxWrites Upper limit for the data bytes
+ * \return 1 on failure, 0 otherwise
+ */
+static uint32_t test_Update(const char *name, uint32_t maxCommands,
+        uint32_t maxWrites) {
+    halStub_ResetCounters();
+    screen_Commit();
+    hal_updateDisplay();
+    // the steps of the transfer run from the timer
+    uint32_t ms = 0;
+    while (display.transfer.running && ms < 100) {
+        halStub_Tick();
+        ms++;
+    }
+    uint8_t clean = !display.transfer.running && !timer.stepCallback;
+    uint8_t page;
+    for (page = 0; page < 8; page++)
+        if (display.dirty[page][0] || display.dirty[page][1])
+            clean = 0;
+    // one step per byte, the last transfer is kept if nothing changed
+    uint32_t bytes = halStub.displayCommands + halStub.displayWrites;
+    if (bytes && display.lastTransfer.bytes != bytes)
+        clean = 0;
+    uint8_t ok = clean
+            && !memcmp(halStub.panel, display.front, sizeof(display.front))
+            && !memcmp(display.front, display.buffer, sizeof(display.buffer))
+            && halStub.displayCommands <= maxCommands
+            && halStub.displayWrites <= maxWrites;
+    printf("%-24s %4u commands, %4u data bytes, %2ums %s\n", name,
+            halStub.displayCommands, halStub.displayWrites, ms,
+            ok ? "" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+/**
+ * \brief Initializes the display and transfers the complete frame
+ */
+static uint32_t test_Init(void) {
+    test_Reset();
+    hal_displayInit();
+    // strobes the last command of the initialization
+    halStub_ApplyGPIO();
+    // page and address for each page half
+    uint32_t failures = test_Update("initialization", 32, 1024);
+    if (halStub.displayWrites != 1024) {
+        printf("initialization didn't transfer the complete frame FAIL\n");
+        failures++;
+    }
+    return failures;
+}
+
+static uint32_t test_Screens(void) {
+    uint32_t failures = test_Init();
+    screen_Clear();
+    test_MainScreen("1.2345");
+    failures += test_Update("main screen", 64, 512);
+    test_MainScreen("1.2345");
+    failures += test_Update("unchanged redraw", 0, 0);
+    // one 12x16 digit spans two pages, columns that are equal in both
+    // digits might need additional addressing
+    test_MainScreen("1.2346");
+    failures += test_Update("changed digit", 2 * 4, 2 * 12);
+    // only the committed frame is compared
+    screen_Clear();
+    test_MainScreen("1.2346");
+    failures += test_Update("cleared and redrawn", 0, 0);
+    // a frame that is still being drawn is not transferred
+    screen_Clear();
+    halStub_ResetCounters();
+    hal_updateDisplay();
+    if (display.transfer.running || halStub.displayWrites) {
+        printf("uncommitted frame was transferred FAIL\n");
+        failures++;
+    }
+    failures += test_Update("clear", 64, 512);
+    return failures;
+}
+
+static uint32_t test_Scattered(void) {
+    uint32_t failures = test_Init();
+    // columns 10, 12 and 40 of page 5 in the left half, 63 and 64 at the
+    // boundary of the halves
+    screen_SetPixel(10, 42, PIXEL_ON);
+    screen_SetPixel(12, 42, PIXEL_ON);
+    screen_SetPixel(40, 42, PIXEL_ON);
+    screen_SetPixel(63, 42, PIXEL_ON);
+    screen_SetPixel(64, 42, PIXEL_ON);
+    // left: page, address 10, 3 bytes, address 40, 1 byte, address 63,
+    // 1 byte; right: page, address 0, 1 byte
+    failures += test_Update("scattered pixels", 6, 6);
+    // writing the same pixel again is no change
+    screen_SetPixel(10, 42, PIXEL_ON);
+    screen_SetByte(127, 7, 0);
+    failures += test_Update("unchanged pixels", 0, 0);
+    screen_SetPixel(10, 42, PIXEL_OFF);
+    screen_HorizontalLine(0, 63, 128);
+    failures += test_Update("line and cleared pixel", 6, 1 + 128);
+    // the cursor of the main menu
+    screen_InvertChar6x8(96, 3);
+    failures += test_Update("inverted character", 3, 6);
+    return failures;
+}
+
+/**
+ * \brief Checks the data bus words against the pin mapping of the board
+ */
+static uint32_t test_BusMapping(void) {
+    static const struct {
+        GPIO_TypeDef *port;
+        uint16_t pin;
+    } dataPins[8] = { { GPIOB, GPIO_Pin_3 }, { GPIOA, GPIO_Pin_15 }, {
+            GPIOC, GPIO_Pin_10 }, { GPIOC, GPIO_Pin_11 }, { GPIOC,
+            GPIO_Pin_12 }, { GPIOA, GPIO_Pin_12 }, { GPIOA, GPIO_Pin_11 }, {
+            GPIOA, GPIO_Pin_10 } };
+    GPIO_TypeDef *ports[3] = { GPIOA, GPIOB, GPIOC };
+    uint32_t wrong = 0;
+    uint16_t data;
+    for (data = 0; data < 256; data++) {
+        const struct displayBus *bus = &hal_displayBus[data];
+        uint32_t words[3] = { bus->a, bus->b, bus->c };
+        uint8_t i, p;
+        for (p = 0; p < 3; p++) {
+            uint16_t set = 0, reset = 0;
+            for (i = 0; i < 8; i++) {
+                if (dataPins[i].port != ports[p])
+                    continue;
+                if (data & (1 << i))
+                    set |= dataPins[i].pin;
+                else
+                    reset |= dataPins[i].pin;
+            }
+            if (words[p] != (set | (uint32_t) reset << 16))
+                wrong++;
+        }
+    }
+    // the words on the ports, starting from the opposite pin states
+    memset(&halStub, 0, sizeof(halStub));
+    for (data = 0; data < 256; data++) {
+        uint8_t i;
+        for (i = 0; i < 8; i++)
+            GPIO_WriteBit(dataPins[i].port, dataPins[i].pin,
+                    (data & (1 << i)) ? Bit_RESET : Bit_SET);
+        hal_DisplaySetDatabus(data);
+        // applies the stores of the bit set/reset registers
+        hal_SelectDisplay1();
+        for (i = 0; i < 8; i++)
+            if (!(dataPins[i].port->ODR & dataPins[i].pin)
+                    != !(data & (1 << i)))
+                wrong++;
+    }
+    printf("data bus words: %u wrong %s\n", wrong, wrong ? "FAIL" : "");
+    return wrong ? 1 : 0;
+}
+
+int main(void) {
+    uint32_t failures = 0;
+    failures += test_BusMapping();
+    failures += test_Screens();
+    failures += test_Scattered();
+    printf("displayTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,260 @@
+/**
+ * \file
+ * \brief   Host test for the dynamic (A/B) load switching.
+ *
+ * Checks the tables of dyn_BuildTable() for a range of frequencies,
+ * duty cycles and transition times:
+ * - the steps add up to the period and are at least DYN_MIN_STEP_US long
+ * - level A is left after its share of the period (duty cycle)
+ * - the transitions are monotonic and reach the levels within the
+ *   configured time
+ *
+ * Then runs load_update() with the compare interrupt of the HAL stub
+ * and checks that the interrupt writes both levels at the configured
+ * times, that the control loop does not write the DAC meanwhile and
+ * that changes and stopping take effect.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "loadFunctions.h"
+#include "halStub.h"
+
+#define TEST_TICKS              100
+#define TEST_MAX_WRITES         100000
+
+/**
+ * \brief Checks the table of one configuration
+ *
+ * \return 0 if the table is correct, 1 otherwise
+ */
+static uint8_t test_Table(const struct dynConfig *c, uint16_t dacA,
+        uint16_t dacB) {
+    static struct dynTable t;
+    dyn_BuildTable(&t, c, dacA, dacB);
+    uint32_t period = 1000000 / c->frequency;
+    uint32_t timeA = (uint64_t) period * c->duty / 100;
+    if (timeA < DYN_MIN_STEP_US)
+        timeA = DYN_MIN_STEP_US;
+    if (timeA > period - DYN_MIN_STEP_US)
+        timeA = period - DYN_MIN_STEP_US;
+    uint32_t rampA = dacA > dacB ? c->riseTime : c->fallTime;
+    uint32_t rampB = dacA > dacB ? c->fallTime : c->riseTime;
+    if (rampB > period - timeA)
+        rampB = period - timeA;
+    if (!t.nsteps || t.nsteps > DYN_MAX_STEPS)
+        return 1;
+    // start of the first step at level A, the first step that leaves it
+    // and the first step at level B
+    int32_t reachA = -1, leaveA = -1, reachB = -1;
+    uint32_t time = 0;
+    uint16_t last = dacB;
+    uint8_t i;
+    for (i = 0; i < t.nsteps; i++) {
+        if (t.duration[i] < DYN_MIN_STEP_US)
+            return 1;
+        uint16_t target = leaveA < 0 ? dacA : dacB;
+        if (reachA >= 0 && leaveA < 0 && t.dac[i] != dacA) {
+            leaveA = time;
+            target = dacB;
+        }
+        // monotonic towards the level
+        if (abs((int32_t) target - t.dac[i]) > abs((int32_t) target - last))
+            return 1;
+        if (reachA < 0 && t.dac[i] == dacA)
+            reachA = time;
+        if (leaveA >= 0 && reachB < 0 && t.dac[i] == dacB)
+            reachB = time;
+        last = t.dac[i];
+        time += t.duration[i];
+    }
+    if (time != period || reachA < 0 || leaveA < 0 || reachB < 0)
+        return 1;
+    // both levels are reached within the transition time, level A is
+    // left after its share of the period
+    if (reachA > rampA || leaveA < timeA || reachB > timeA + rampB)
+        return 1;
+    return 0;
+}
+
+static uint32_t test_Tables(void) {
+    const uint32_t frequencies[] = { 1, 50, 1000, 5000, 20000 };
+    const uint8_t duties[] = { 0, 10, 50, 90, 100 };
+    const uint16_t ramps[] = { 0, 5, 30, 200, 5000 };
+    const uint16_t dacs[][2] = { { 40000, 1000 }, { 1000, 40000 },
+            { 65535, 0 }, { 100, 103 } };
+    uint32_t failures = 0, tables = 0;
+    uint8_t f, d, r, s, l;
+    for (f = 0; f < 5; f++)
+        for (d = 0; d < 5; d++)
+            for (r = 0; r < 5; r++)
+                for (s = 0; s < 5; s++)
+                    for (l = 0; l < 4; l++) {
+                        struct dynConfig c = { 0, 0, frequencies[f],
+                                duties[d], ramps[r], ramps[s] };
+                        if (test_Table(&c, dacs[l][0], dacs[l][1])) {
+                            printf("table %uHz %u%% rise %uus fall %uus "
+                                    "A 0x%04x B 0x%04x FAIL\n",
+                                    c.frequency, c.duty, c.riseTime,
+                                    c.fallTime, dacs[l][0], dacs[l][1]);
+                            failures++;
+                        }
+                        tables++;
+                    }
+    printf("%u tables, %u failures\n", tables, failures);
+    return failures;
+}
+
+static struct {
+    uint64_t time[TEST_MAX_WRITES];
+    uint16_t dac[TEST_MAX_WRITES];
+    uint32_t n;
+} test_writes;
+
+static void test_Trace(uint16_t dac) {
+    if (test_writes.n < TEST_MAX_WRITES) {
+        test_writes.time[test_writes.n] = halStub.compareTime;
+        test_writes.dac[test_writes.n] = dac;
+        test_writes.n++;
+    }
+}
+
+static void test_Reset(void) {
+    halStub_ResetLoop();
+    halStub.dacDirectTrace = test_Trace;
+    test_writes.n = 0;
+    load.mode = FUNCTION_CC;
+    load.current = 50000;
+    load.powerOn = 1;
+}
+
+/**
+ * \brief Runs ticks and counts the DAC writes of the control loop
+ */
+static uint32_t test_Run(uint32_t ticks) {
+    uint32_t i, loopWrites = 0;
+    for (i = 0; i < ticks; i++) {
+        halStub_Tick();
+        halStub_ResetCounters();
+        load_update();
+        loopWrites += halStub.dacWrites;
+    }
+    return loopWrites;
+}
+
+/**
+ * \brief Checks the recorded writes against a square wave
+ *
+ * \param from First write to check
+ * \return 0 if the writes alternate between both levels at the
+ * configured times, 1 otherwise
+ */
+static uint8_t test_Square(uint32_t from, uint16_t dacA, uint16_t dacB,
+        uint32_t timeA, uint32_t timeB) {
+    uint32_t i;
+    if (test_writes.n < from + 4)
+        return 1;
+    // the recording may start at either level
+    uint8_t atA = test_writes.dac[from] == dacA;
+    for (i = from; i < test_writes.n; i++) {
+        if (test_writes.dac[i] != (atA ? dacA : dacB))
+            return 1;
+        if (i > from
+                && test_writes.time[i] - test_writes.time[i - 1]
+                        != (atA ? timeB : timeA))
+            return 1;
+        atA = !atA;
+    }
+    return 0;
+}
+
+static uint32_t test_Runtime(void) {
+    uint32_t failures = 0;
+    test_Reset();
+    test_Run(10);
+    dyn.config.currentA = 150000;
+    dyn.config.currentB = 20000;
+    dyn.config.frequency = 5000;
+    dyn.config.duty = 30;
+    dyn.enabled = 1;
+    uint16_t dacA = cal_CurrentToDAC(150000);
+    uint16_t dacB = cal_CurrentToDAC(20000);
+    uint32_t loopWrites = test_Run(TEST_TICKS);
+    uint8_t ok = !loopWrites && dyn.running
+            && test_writes.n >= 2 * 5 * (TEST_TICKS - 1)
+            && !test_Square(0, dacA, dacB, 60, 140);
+    printf("5kHz 30%%: %u interrupt writes, %u periods, %u loop writes %s\n",
+            test_writes.n, dyn.periods, loopWrites, ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+
+    // new level A, applied at the end of a period
+    dyn.config.currentA = 180000;
+    uint32_t from = test_writes.n;
+    loopWrites = test_Run(TEST_TICKS);
+    dacA = cal_CurrentToDAC(180000);
+    uint32_t i;
+    for (i = from; i < test_writes.n; i++) {
+        if (test_writes.dac[i] == dacA)
+            break;
+    }
+    // the first write of the new table starts a period
+    ok = !loopWrites && i < test_writes.n && (i - from) % 2 == 0
+            && !test_Square(i, dacA, dacB, 60, 140);
+    printf("level A changed: applied after %u writes %s\n", i - from,
+            ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+
+    // 1kHz with 100us transitions
+    dyn.config.frequency = 1000;
+    dyn.config.duty = 50;
+    dyn.config.riseTime = 100;
+    dyn.config.fallTime = 100;
+    test_Run(5);
+    from = test_writes.n;
+    test_Run(TEST_TICKS);
+    uint32_t steps = 0;
+    for (i = from + 1; i < test_writes.n; i++) {
+        if (test_writes.dac[i] != dacA && test_writes.dac[i] != dacB)
+            steps++;
+    }
+    uint32_t expected = (TEST_TICKS - 1) * 2 * (100 / DYN_MIN_STEP_US - 1);
+    ok = steps >= expected && dyn.periods > 0;
+    printf("1kHz, 100us ramps: %u intermediate steps (expected >= %u) %s\n",
+            steps, expected, ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+
+    // turning the input off stops the interrupt and sets the DAC to 0
+    load.powerOn = 0;
+    test_Run(2);
+    from = test_writes.n;
+    loopWrites = test_Run(10);
+    ok = !dyn.running && test_writes.n == from && halStub.dac == 0;
+    printf("input off: running %u, DAC 0x%04x %s\n", dyn.running, halStub.dac,
+            ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+
+    // back to the constant current after disabling the dynamic mode
+    load.powerOn = 1;
+    test_Run(10);
+    dyn.enabled = 0;
+    test_Run(2);
+    ok = !dyn.running && halStub.dac == cal_CurrentToDAC(load.current);
+    printf("dynamic mode off: DAC 0x%04x (expected 0x%04x) %s\n", halStub.dac,
+            cal_CurrentToDAC(load.current), ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+    return failures;
+}
+
+int main(void) {
+    uint32_t failures = 0;
+    failures += test_Tables();
+    failures += test_Runtime();
+    printf("dynamicTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
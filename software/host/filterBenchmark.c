@@ -0,0 +1,213 @@
+/**
+ * \file
+ * \brief   Host benchmark for the measurement filters.
+ *
+ * Feeds ADC sample streams through acq_Filter() for every filter type
+ * and length and reports the time per sample, the noise reduction
+ * (standard deviation of the input divided by that of the outputs on a
+ * noisy constant input), the attenuation of 50Hz hum and the latency of
+ * a step in samples (until the output reaches 90% of the step).
+ *
+ * The noise reduction is measured on a recorded stream if a file with
+ * one ADC value per line is given, otherwise on a synthesized one.
+ *
+ * Usage: filterBenchmark [ADC stream file]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "acquisition.h"
+
+#define BENCH_SAMPLES           1000000
+// per channel sample rate of the acquisition (alternating channels)
+#define BENCH_SAMPLE_RATE       (1000000UL * ACQ_STEP_SAMPLES / ACQ_PERIOD_US / 2)
+#define BENCH_NOISE             8.0
+#define BENCH_STEP_LOW          10000
+#define BENCH_STEP_HIGH         40000
+
+static const char *bench_FilterNames[ACQ_NUM_FILTERS] = { "boxcar", "CIC",
+        "exp" };
+
+static uint16_t *bench_Stream;
+static uint32_t bench_StreamLength;
+
+static uint64_t bench_Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * \brief Gaussian noise with the given standard deviation
+ */
+static double bench_Noise(double sigma) {
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sigma * sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+static uint16_t bench_Clamp(double v) {
+    if (v < 0)
+        return 0;
+    if (v > 65535)
+        return 65535;
+    return (uint16_t) (v + 0.5);
+}
+
+static uint8_t bench_Load(const char *file) {
+    FILE *f = fopen(file, "r");
+    if (!f) {
+        perror(file);
+        return 0;
+    }
+    uint32_t size = 4096;
+    bench_Stream = malloc(size * sizeof(uint16_t));
+    bench_StreamLength = 0;
+    unsigned value;
+    while (fscanf(f, "%u", &value) == 1) {
+        if (bench_StreamLength == size) {
+            size *= 2;
+            bench_Stream = realloc(bench_Stream, size * sizeof(uint16_t));
+        }
+        bench_Stream[bench_StreamLength++] = value;
+    }
+    fclose(f);
+    return bench_StreamLength > 0;
+}
+
+static void bench_Synthesize(void) {
+    uint32_t i;
+    bench_StreamLength = BENCH_SAMPLES;
+    bench_Stream = malloc(BENCH_SAMPLES * sizeof(uint16_t));
+    for (i = 0; i < BENCH_SAMPLES; i++)
+        bench_Stream[i] = bench_Clamp(30000 + bench_Noise(BENCH_NOISE));
+}
+
+static double bench_StdDev(double sum, double sumSq, uint32_t n) {
+    double mean = sum / n;
+    return sqrt(sumSq / n - mean * mean);
+}
+
+/**
+ * \brief Standard deviation of the filter outputs divided by that of
+ * the input stream
+ */
+static double bench_NoiseReduction(uint8_t type, uint8_t shift) {
+    struct acqFilter f;
+    double inSum = 0, inSq = 0, outSum = 0, outSq = 0;
+    uint32_t i, outputs = 0;
+    acq_ResetFilter(&f);
+    for (i = 0; i < bench_StreamLength; i++) {
+        double in = bench_Stream[i];
+        inSum += in;
+        inSq += in * in;
+        if (acq_Filter(&f, type, shift, bench_Stream[i])
+                && i >= (2UL << shift) * 4) {
+            // skip the transient of the exponential filter
+            double out = f.result / (double) (1 << ACQ_FRACTION_BITS);
+            outSum += out;
+            outSq += out * out;
+            outputs++;
+        }
+    }
+    double out = bench_StdDev(outSum, outSq, outputs);
+    if (out == 0)
+        return INFINITY;
+    return bench_StdDev(inSum, inSq, bench_StreamLength) / out;
+}
+
+/**
+ * \brief Peak to peak amplitude of the filter outputs relative to the
+ * input for 50Hz hum
+ */
+static double bench_Hum(uint8_t type, uint8_t shift) {
+    struct acqFilter f;
+    double min = 65535, max = 0;
+    uint32_t i;
+    acq_ResetFilter(&f);
+    for (i = 0; i < BENCH_SAMPLE_RATE; i++) {
+        uint16_t adc = bench_Clamp(
+                30000 + 1000 * sin(2 * M_PI * 50 * i / BENCH_SAMPLE_RATE));
+        if (acq_Filter(&f, type, shift, adc) && i > BENCH_SAMPLE_RATE / 10) {
+            double out = f.result / (double) (1 << ACQ_FRACTION_BITS);
+            if (out < min)
+                min = out;
+            if (out > max)
+                max = out;
+        }
+    }
+    return (max - min) / 2000;
+}
+
+/**
+ * \brief Samples after a step until an output reaches 90% of the step
+ */
+static uint32_t bench_StepLatency(uint8_t type, uint8_t shift) {
+    struct acqFilter f;
+    uint32_t i;
+    acq_ResetFilter(&f);
+    // settle on the low level (the exponential filter needs a few time
+    // constants)
+    for (i = 0; i < (2UL << shift) * 16; i++)
+        acq_Filter(&f, type, shift, BENCH_STEP_LOW);
+    // the step may hit anywhere within a decimation period
+    uint32_t offset = rand() % (1 << shift);
+    for (i = 0; i < offset; i++)
+        acq_Filter(&f, type, shift, BENCH_STEP_LOW);
+    uint32_t threshold = (BENCH_STEP_LOW
+            + (BENCH_STEP_HIGH - BENCH_STEP_LOW) * 9 / 10) << ACQ_FRACTION_BITS;
+    for (i = 0; i < (2UL << shift) * 16; i++) {
+        if (acq_Filter(&f, type, shift, BENCH_STEP_HIGH)
+                && f.result >= threshold)
+            return i + 1;
+    }
+    return 0;
+}
+
+static double bench_Speed(uint8_t type, uint8_t shift) {
+    struct acqFilter f;
+    uint32_t i;
+    volatile uint32_t sink = 0;
+    acq_ResetFilter(&f);
+    uint64_t start = bench_Now();
+    for (i = 0; i < bench_StreamLength; i++) {
+        if (acq_Filter(&f, type, shift, bench_Stream[i]))
+            sink += f.result;
+    }
+    uint64_t stop = bench_Now();
+    (void) sink;
+    return (double) (stop - start) / bench_StreamLength;
+}
+
+int main(int argc, char **argv) {
+    uint8_t type, shift;
+    if (argc > 1) {
+        if (!bench_Load(argv[1]))
+            return 1;
+        printf("noise measured on %s (%u samples)\n", argv[1],
+                bench_StreamLength);
+    } else {
+        bench_Synthesize();
+        printf("noise measured on a synthesized stream (sigma %.1f LSB)\n",
+                BENCH_NOISE);
+    }
+    printf("%-7s %6s %10s %10s %10s %10s %10s\n", "filter", "length",
+            "ns/sample", "noise red", "50Hz", "latency", "latency");
+    printf("%-7s %6s %10s %10s %10s %10s %10s\n", "", "", "", "[x]", "[rel]",
+            "[samples]", "[ms]");
+    for (type = 0; type < ACQ_NUM_FILTERS; type++) {
+        for (shift = 0; shift <= ACQ_MAX_FILTER_SHIFT; shift += 2) {
+            uint32_t latency = bench_StepLatency(type, shift);
+            printf("%-7s %6u %10.2f %10.2f %10.3f %10u %10.2f\n",
+                    bench_FilterNames[type], 1 << shift,
+                    bench_Speed(type, shift), bench_NoiseReduction(type, shift),
+                    bench_Hum(type, shift), latency,
+                    latency * 1000.0 / BENCH_SAMPLE_RATE);
+        }
+    }
+    free(bench_Stream);
+    return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * \file
+ * \brief   Host test for the division free CR/CP current calculation.
+ *
+ * Compares common_Fraction()/common_ApplyFactor() against the 64 bit
+ * division load_update() used before, over the full range of
+ * resistances, powers and voltages. The results may deviate by one LSB
+ * (truncation) plus TEST_MAX_REL_ERROR.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "common.h"
+#include "settings.h"
+#include "loadFunctions.h"
+
+#define TEST_RANDOM_VALUES      2000000
+
+struct testResult {
+    // maximum deviation from the division in LSB
+    uint32_t maxError;
+    // values that are off by more than 1 LSB plus TEST_MAX_REL_ERROR
+    uint32_t failures;
+    uint32_t values;
+};
+
+// allowed relative error on top of one LSB for truncation
+#define TEST_MAX_REL_ERROR      1e-8
+
+static uint32_t test_Random(uint32_t min, uint32_t max) {
+    // log-uniform distribution, covers all decades equally
+    double r = (double) rand() / RAND_MAX;
+    double v = min * pow((double) max / min, r);
+    return v;
+}
+
+static void test_Compare(struct testResult *r, uint32_t result,
+        uint64_t expected) {
+    uint32_t error =
+            result > expected ? result - expected : expected - result;
+    if (error > r->maxError)
+        r->maxError = error;
+    if (error > 1 + expected * TEST_MAX_REL_ERROR)
+        r->failures++;
+    r->values++;
+}
+
+static void test_Reciprocal(struct testResult *r) {
+    uint32_t i;
+    for (i = 0; i < TEST_RANDOM_VALUES; i++) {
+        uint32_t x = test_Random(1, UINT32_MAX);
+        struct fixedFactor f;
+        common_Reciprocal(&f, x);
+        // compare 2^30 * x * (1/x) with 2^30
+        double product = ldexp((double) f.factor * x, 30 - f.shift);
+        test_Compare(r, product + 0.5, 1UL << 30);
+    }
+}
+
+static void test_CR(struct testResult *r) {
+    uint32_t i;
+    for (i = 0; i < TEST_RANDOM_VALUES; i++) {
+        uint32_t resistance = test_Random(LOAD_MINRESISTANCE_HIGHP,
+        LOAD_MAXRESISTANCE_LOWP);
+        uint32_t voltage = test_Random(1, LOAD_MAXVOLTAGE_LOWP);
+        struct fixedFactor f;
+        common_Fraction(&f, 1000, resistance);
+        uint64_t expected = ((uint64_t) voltage * 1000) / resistance;
+        test_Compare(r, common_ApplyFactor(&f, voltage), expected);
+    }
+}
+
+static void test_CP(struct testResult *r) {
+    uint32_t i;
+    for (i = 0; i < TEST_RANDOM_VALUES; i++) {
+        uint32_t power = test_Random(1, LOAD_MAXPOWER_HIGHP);
+        uint32_t voltage = test_Random(LOAD_CP_MIN_VOLTAGE,
+        LOAD_MAXVOLTAGE_LOWP);
+        struct fixedFactor f;
+        common_Fraction(&f, 1000000, voltage);
+        uint64_t expected = ((uint64_t) power * 1000000) / voltage;
+        test_Compare(r, common_ApplyFactor(&f, power), expected);
+    }
+}
+
+int main(void) {
+    const struct {
+        const char *name;
+        void (*test)(struct testResult *r);
+    } tests[] = { { "1/x [2^-30]", test_Reciprocal }, { "CR [uA]", test_CR },
+            { "CP [uA]", test_CP } };
+    uint8_t i;
+    uint32_t failures = 0;
+    srand(1);
+    printf("%-12s %9s %9s %9s\n", "calculation", "values", "max err",
+            "failures");
+    for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        struct testResult r = { 0, 0, 0 };
+        tests[i].test(&r);
+        printf("%-12s %9u %9u %9u\n", tests[i].name, r.values, r.maxError,
+                r.failures);
+        failures += r.failures;
+    }
+    printf("fractionTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
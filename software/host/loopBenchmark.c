@@ -0,0 +1,354 @@
+/**
+ * \file
+ * \brief   Host benchmark for the load control loop.
+ *
+ * Runs load_update() against the stub HAL for a number of ticks in
+ * several representative configurations and reports the distribution
+ * of the time spent per tick together with the number of bus
+ * transactions the firmware would have issued and the number of
+ * control mode/shunt selections. The background
+ * acquisition that runs between two ticks is timed separately.
+ *
+ * Usage: loopBenchmark [ticks per configuration]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "loadFunctions.h"
+#include "halStub.h"
+
+#define BENCH_DEFAULT_TICKS     2000000
+#define BENCH_WARMUP_TICKS      1000
+
+typedef struct {
+    const char *name;
+    void (*setup)(void);
+} benchConfig_t;
+
+static uint64_t bench_Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int bench_Compare(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*) a;
+    uint32_t y = *(const uint32_t*) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * \brief Puts the firmware into its power-on state
+ *
+ * Same initialization sequence as main(), with default settings and
+ * default calibration. The simulated source is a 12V supply with
+ * 100mOhm internal resistance.
+ */
+static void bench_Reset(void) {
+    halStub_ResetLoop();
+    halStub.adcNoise = 8;
+}
+
+static void bench_SetupOff(void) {
+    load.mode = FUNCTION_CC;
+    load.current = 100000;
+    load.powerOn = 0;
+}
+
+static void bench_SetupCC(void) {
+    load.mode = FUNCTION_CC;
+    load.current = 100000;
+    load.powerOn = 1;
+}
+
+static void bench_SetupCV(void) {
+    load.mode = FUNCTION_CV;
+    load.voltage = 5000000;
+    load.powerOn = 1;
+}
+
+static void bench_SetupCR(void) {
+    load.mode = FUNCTION_CR;
+    load.resistance = 100000;
+    load.powerOn = 1;
+}
+
+static void bench_SetupCP(void) {
+    load.mode = FUNCTION_CP;
+    load.power = 1000000;
+    load.powerOn = 1;
+}
+
+static void bench_SetupAnalogCR(void) {
+    bench_SetupCR();
+    settings.analogCRCP = 1;
+}
+
+static void bench_SetupAnalogCP(void) {
+    bench_SetupCP();
+    settings.analogCRCP = 1;
+}
+
+static void bench_SetupWaveform(void) {
+    bench_SetupCC();
+    waveform.form = WAVE_SINE;
+    waveform.param = &load.current;
+    waveform.paramNum = 0;
+    waveform.offset = 100000;
+    waveform.amplitude = 50000;
+    waveform.period = 100;
+}
+
+static void bench_SetupArbitrary(void) {
+    bench_SetupCC();
+    uint8_t i;
+    arbitrary.numPoints = ARB_MAX_POINTS;
+    arbitrary.sequenceLength = 1000;
+    for (i = 0; i < ARB_MAX_POINTS; i++) {
+        arbitrary.points[i].time = i * 50;
+        arbitrary.points[i].value = (i & 0x01) ? 150000 : 50000;
+        // first order hold is the more expensive interpolation
+        arbitrary.points[i].hold = 1;
+    }
+    arbitrary.param = &load.current;
+    arbitrary.paramNum = 0;
+    arbitrary.mode = ARB_CONTINUOUS;
+    arbitrary.status = ARB_RUNNING;
+    arbitrary.time = 0;
+}
+
+static void bench_SetupEvents(void) {
+    bench_SetupCC();
+    uint8_t i, j;
+    for (i = 0; i < EV_MAXEVENTS; i++) {
+        struct event *ev = &events.evlist[i];
+        if (i < EV_MAXTIMERS) {
+            // periodically retriggered timers toggling the trigger output
+            ev->srcType = EV_SRC_TIM_ZERO;
+            ev->srcTimerNum = i;
+            ev->effects[0].destType = EV_DEST_SET_TIMER;
+            ev->effects[0].destTimerNum = i;
+            ev->effects[0].destTimerValue = 2 + i;
+            ev->effects[1].destType =
+                    (i & 0x01) ? EV_DEST_TRIG_LOW : EV_DEST_TRIG_HIGH;
+        } else {
+            // parameter comparisons that are always true
+            ev->srcType = EV_SRC_PARAM_HIGHER;
+            ev->srcParam = (uint32_t*) &load.state.voltage;
+            ev->srcLimit = 1000000;
+            ev->effects[0].destType = EV_DEST_SET_PARAM;
+            ev->effects[0].destParam = (uint32_t*) &load.current;
+            ev->effects[0].destSetValue = 100000;
+        }
+        for (j = 2; j < EV_MAXEFFECTS; j++) {
+            ev->effects[j].destType = EV_DEST_LOAD_ON;
+        }
+    }
+}
+
+static void bench_SetupWorstCase(void) {
+    bench_SetupEvents();
+    load.mode = FUNCTION_CP;
+    load.power = 1000000;
+    waveform.form = WAVE_SINE;
+    waveform.param = &load.power;
+    waveform.paramNum = 3;
+    waveform.offset = 1000000;
+    waveform.amplitude = 500000;
+    waveform.period = 100;
+}
+
+static const benchConfig_t bench_Configs[] = {
+        { "input off", bench_SetupOff },
+        { "CC", bench_SetupCC },
+        { "CV", bench_SetupCV },
+        { "CR", bench_SetupCR },
+        { "CP", bench_SetupCP },
+        { "CR analog", bench_SetupAnalogCR },
+        { "CP analog", bench_SetupAnalogCP },
+        { "CC + sine waveform", bench_SetupWaveform },
+        { "CC + arbitrary seq", bench_SetupArbitrary },
+        { "CC + 10 events", bench_SetupEvents },
+        { "CP + wave + events", bench_SetupWorstCase } };
+
+#define BENCH_NUM_CONFIGS   (sizeof(bench_Configs) / sizeof(bench_Configs[0]))
+
+// profiler results of each configuration
+static struct profData bench_Profiles[BENCH_NUM_CONFIGS];
+
+static void bench_Run(const benchConfig_t *config, uint32_t *samples,
+        uint32_t ticks) {
+    uint32_t i;
+    bench_Reset();
+    config->setup();
+    for (i = 0; i < BENCH_WARMUP_TICKS; i++) {
+        halStub_Tick();
+        load_update();
+    }
+    halStub_ResetCounters();
+    prof_Reset();
+    uint64_t sum = 0;
+    uint64_t backgroundSum = 0;
+    for (i = 0; i < ticks; i++) {
+        uint64_t start = bench_Now();
+        halStub_Tick();
+        uint64_t tickStart = bench_Now();
+        load_update();
+        uint32_t duration = bench_Now() - tickStart;
+        samples[i] = duration;
+        sum += duration;
+        backgroundSum += tickStart - start;
+    }
+    qsort(samples, ticks, sizeof(uint32_t), bench_Compare);
+    printf(
+            "%-20s %7.1f %7u %7u %7u %8u %7.1f %6.2f %6.2f %6.2f %6.2f %7.2f "
+                    "%6.2f\n",
+            config->name, (double) sum / ticks, samples[ticks / 2],
+            samples[(uint64_t) ticks * 99 / 100],
+            samples[(uint64_t) ticks * 999 / 1000], samples[ticks - 1],
+            (double) backgroundSum / ticks,
+            (double) halStub.avrFrames / ticks,
+            (double) halStub.avrADCReads / ticks,
+            (double) halStub.dacWrites / ticks,
+            (double) halStub.adcConversions / ticks,
+            (double) halStub.waitus / ticks,
+            (double) halStub.modeSelects / ticks);
+    prof_GetData(&bench_Profiles[config - bench_Configs]);
+}
+
+/**
+ * \brief Prints the average cycles per stage as measured by the profiler
+ */
+static void bench_PrintProfiles(void) {
+    uint8_t i, j;
+    printf("\naverage cycles per stage (72MHz equivalent)\n%-20s", "");
+    for (j = 0; j < PROF_STAGE_NUM; j++)
+        printf(" %7s", prof_stageNames[j]);
+    printf(" %7s\n", "TICK");
+    for (i = 0; i < BENCH_NUM_CONFIGS; i++) {
+        printf("%-20s", bench_Configs[i].name);
+        for (j = 0; j < PROF_STAGE_NUM; j++)
+            printf(" %7u", prof_GetAverage(&bench_Profiles[i].stage[j]));
+        printf(" %7u\n", prof_GetAverage(&bench_Profiles[i].tick));
+    }
+}
+
+/**
+ * \brief Reads the cycle counter of the host CPU
+ *
+ * Counts nanoseconds on hosts without a time stamp counter.
+ */
+static uint64_t bench_Cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return bench_Now();
+#endif
+}
+
+/**
+ * \brief 64 bit division by the library routine
+ *
+ * The Cortex-M3 has no 64 bit divide and calls __aeabi_uldivmod. A 128
+ * bit division does the same on a 64 bit host (__udivti3), a 32 bit host
+ * calls __udivdi3 for the 64 bit division.
+ */
+static __attribute__((noinline)) uint32_t bench_LibraryDivide(uint64_t num,
+        uint32_t den) {
+#ifdef __SIZEOF_INT128__
+    return (unsigned __int128) num / den;
+#else
+    return num / den;
+#endif
+}
+
+/**
+ * \brief Compares the CR/CP current calculation with the 64 bit division
+ * it replaced
+ *
+ * The division is timed with the divide instruction of the host and with
+ * the library routine, which is what the Cortex-M3 runs.
+ */
+static void bench_Fraction(uint32_t ticks) {
+    uint32_t voltages[1024];
+    uint32_t i;
+    volatile uint32_t result;
+    srand(1);
+    for (i = 0; i < 1024; i++)
+        voltages[i] = LOAD_CP_MIN_VOLTAGE + rand() % 30000000;
+    // volatile, so the compiler can not replace the division
+    volatile uint32_t resistance = 100000;
+    volatile uint32_t power = 1000000;
+    uint64_t start[7];
+
+    start[0] = bench_Cycles();
+    for (i = 0; i < ticks; i++)
+        result = ((uint64_t) voltages[i & 1023] * 1000) / resistance;
+    start[1] = bench_Cycles();
+    for (i = 0; i < ticks; i++)
+        result = bench_LibraryDivide((uint64_t) voltages[i & 1023] * 1000,
+                resistance);
+    start[2] = bench_Cycles();
+    struct fixedFactor conductance;
+    common_Fraction(&conductance, 1000, resistance);
+    for (i = 0; i < ticks; i++)
+        result = common_ApplyFactor(&conductance, voltages[i & 1023]);
+    start[3] = bench_Cycles();
+    for (i = 0; i < ticks; i++)
+        result = ((uint64_t) power * 1000000) / voltages[i & 1023];
+    start[4] = bench_Cycles();
+    for (i = 0; i < ticks; i++)
+        result = bench_LibraryDivide((uint64_t) power * 1000000,
+                voltages[i & 1023]);
+    start[5] = bench_Cycles();
+    for (i = 0; i < ticks; i++) {
+        struct fixedFactor reciprocal;
+        common_Fraction(&reciprocal, 1000000, voltages[i & 1023]);
+        result = common_ApplyFactor(&reciprocal, power);
+    }
+    start[6] = bench_Cycles();
+    printf("\nCR/CP current calculation [host cycles]\n");
+    printf("%-20s %7s %7s %7s\n", "", "div", "libdiv", "fixed");
+    for (i = 0; i < 2; i++) {
+        const uint64_t *t = &start[3 * i];
+        printf("%-20s %7.1f %7.1f %7.1f\n", i ? "CP" : "CR",
+                (double) (t[1] - t[0]) / ticks, (double) (t[2] - t[1]) / ticks,
+                (double) (t[3] - t[2]) / ticks);
+    }
+    (void) result;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t ticks = BENCH_DEFAULT_TICKS;
+    if (argc > 1)
+        ticks = strtoul(argv[1], NULL, 0);
+    if (ticks == 0) {
+        fprintf(stderr, "usage: %s [ticks per configuration]\n", argv[0]);
+        return 1;
+    }
+    uint32_t *samples = malloc(ticks * sizeof(uint32_t));
+    if (!samples) {
+        fprintf(stderr, "unable to allocate sample buffer\n");
+        return 1;
+    }
+    printf("load_update() per tick, %u ticks per configuration\n", ticks);
+    printf("%-20s %7s %7s %7s %7s %8s %7s %6s %6s %6s %6s %7s %6s\n", "",
+            "mean", "p50", "p99", "p99.9", "max", "backgr", "AVRgpio",
+            "AVRadc", "DAC", "ADC", "wait", "mode");
+    printf("%-20s %7s %7s %7s %7s %8s %7s %6s %6s %6s %6s %7s %6s\n",
+            "configuration", "[ns]", "[ns]", "[ns]", "[ns]", "[ns]", "[ns]",
+            "/tick", "/tick", "/tick", "/tick", "[us]", "/tick");
+    uint8_t i;
+    for (i = 0; i < BENCH_NUM_CONFIGS; i++) {
+        bench_Run(&bench_Configs[i], samples, ticks);
+    }
+    bench_PrintProfiles();
+    bench_Fraction(ticks);
+    free(samples);
+    return 0;
+}
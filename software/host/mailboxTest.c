@@ -0,0 +1,122 @@
+/**
+ * \file
+ * \brief   Host test for the setpoint mailbox.
+ *
+ * Runs load_update() against the HAL stub and checks that
+ * - a published record is applied with all fields in the next tick
+ * - published records are limited to the ranges of the power mode
+ * - load_GetSetpoint() returns a pending record until it is applied
+ *   and the setpoint of the control loop afterwards
+ * - of several records published between two ticks the latest one is
+ *   applied, also after the sequence numbers wrapped
+ * - setpoints written directly during the tick are limited on the hot
+ *   path
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "loadFunctions.h"
+#include "halStub.h"
+
+static void test_Reset(void) {
+    halStub_ResetLoop();
+    load.powerOn = 1;
+}
+
+static void test_Tick(void) {
+    halStub_Tick();
+    halStub_ResetCounters();
+    load_update();
+}
+
+static uint8_t test_Applied(const struct loadSetpoint *s) {
+    return load.mode == s->mode && load.current == s->current
+            && load.voltage == s->voltage && load.resistance == s->resistance
+            && load.power == s->power;
+}
+
+static uint32_t test_Publish(void) {
+    uint32_t failures = 0;
+    test_Reset();
+    test_Tick();
+    struct loadSetpoint s = { FUNCTION_CV, 50000, 5000000, 10000, 1000000 };
+    load_PublishSetpoint(&s);
+    struct loadSetpoint pending;
+    load_GetSetpoint(&pending);
+    uint8_t ok = !test_Applied(&s) && !memcmp(&pending, &s, sizeof(s));
+    test_Tick();
+    struct loadSetpoint active;
+    load_GetSetpoint(&active);
+    ok = ok && test_Applied(&s) && !memcmp(&active, &s, sizeof(s))
+            && slew.value == s.voltage;
+    printf("record applied in the next tick: mode %u, %duA, %duV, %dmOhm, "
+            "%duW %s\n", load.mode, load.current, load.voltage,
+            load.resistance, load.power, ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+
+    // limited to the low power ranges
+    struct loadSetpoint high = { FUNCTION_CC, 100000000, 0, 0, -5 };
+    load_PublishSetpoint(&high);
+    test_Tick();
+    ok = load.mode == FUNCTION_CC
+            && load.current == (int32_t) settings.maxCurrent[0]
+            && load.voltage == (int32_t) settings.minVoltage[0]
+            && load.resistance == (int32_t) settings.minResistance[0]
+            && load.power == 0;
+    printf("limited record: %duA, %duV, %dmOhm, %duW %s\n", load.current,
+            load.voltage, load.resistance, load.power, ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+    return failures;
+}
+
+static uint32_t test_Latest(void) {
+    test_Reset();
+    test_Tick();
+    // more records than slots, the counters wrap during the sequence
+    load.mailbox.reserved = load.mailbox.published = load.mailbox.applied =
+            0xFFFFFFF8;
+    struct loadSetpoint s = { FUNCTION_CC, 0, 5000000, 10000, 1000000 };
+    uint32_t i;
+    uint8_t ok = 1;
+    for (i = 0; i < 3 * LOAD_SETPOINT_SLOTS; i++) {
+        s.current = 10000 + i * 1000;
+        load_PublishSetpoint(&s);
+        if (i % 5 == 4) {
+            test_Tick();
+            if (!test_Applied(&s))
+                ok = 0;
+        }
+    }
+    test_Tick();
+    ok = ok && test_Applied(&s) && load.mailbox.applied < 0x10
+            && halStub.dac == cal_CurrentToDAC(s.current);
+    printf("latest of %u records: %duA (expected %duA) %s\n",
+            3 * LOAD_SETPOINT_SLOTS, load.current, s.current, ok ? "" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static uint32_t test_HotPathLimit(void) {
+    test_Reset();
+    test_Tick();
+    // written directly like the waveforms and events do
+    load.mode = FUNCTION_CC;
+    load.current = 100000000;
+    test_Tick();
+    test_Tick();
+    uint16_t expected = cal_CurrentToDAC(settings.maxCurrent[0]);
+    uint8_t ok = halStub.dac == expected;
+    printf("direct write above the limit: DAC 0x%04x (expected 0x%04x) %s\n",
+            halStub.dac, expected, ok ? "" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+int main(void) {
+    uint32_t failures = 0;
+    failures += test_Publish();
+    failures += test_Latest();
+    failures += test_HotPathLimit();
+    printf("mailboxTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
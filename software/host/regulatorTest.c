@@ -0,0 +1,197 @@
+/**
+ * \file
+ * \brief   Host test for the digital CR/CP regulator.
+ *
+ * Runs load_update() against the plant model of the HAL stub (source
+ * with internal resistance, set current gain error, first order lag,
+ * discharging battery) and records the step response of the digital
+ * CR and CP modes.
+ *
+ * Each scenario is run with the default gains and without the PI part
+ * (pure feed-forward, the previous behaviour). The regulated scenarios
+ * must meet the steady state error, settling time and overshoot limits
+ * of the scenario.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "loadFunctions.h"
+#include "halStub.h"
+
+// ticks before the setpoint step and after it
+#define TEST_TICKS              500
+// error band for the settling time
+#define TEST_SETTLE_BAND        0.01
+// ticks at the end used for the steady state error
+#define TEST_STEADY_TICKS       100
+
+struct testResult {
+    // mean relative error over the last TEST_STEADY_TICKS
+    double steadyError;
+    // ticks after the step until the error stays within TEST_SETTLE_BAND
+    uint32_t settleTicks;
+    // maximum relative overshoot of the current after the step
+    double overshoot;
+    // maximum change of the set current between two ticks in uA
+    uint32_t maxSlope;
+};
+
+typedef struct {
+    const char *name;
+    // sets up the plant and the load before the input is turned on
+    void (*setup)(void);
+    // setpoint step after TEST_TICKS
+    void (*step)(void);
+    // limits for the regulated run
+    double maxSteadyError;
+    uint32_t maxSettleTicks;
+    double maxOvershoot;
+    // limit of the set current slope in uA per tick (0: no limit)
+    uint32_t maxSlope;
+} testCase_t;
+
+/**
+ * \brief Puts the firmware into its power-on state
+ *
+ * 12V source with 100mOhm internal resistance, the real current is 3%
+ * higher than calibrated and follows the DAC with a 2ms time constant.
+ */
+static void test_Reset(void) {
+    halStub_ResetLoop();
+    halStub.adcNoise = 8;
+    halStub.gainError = 30000;
+    halStub.lag = 2;
+}
+
+/**
+ * \brief Relative deviation of the drawn current from the setpoint
+ */
+static double test_Error(void) {
+    double V = halStub.voltage * 1e-6;
+    double I = halStub.current * 1e-6;
+    if (load.mode == FUNCTION_CR) {
+        double target = V / (load.resistance * 1e-3);
+        return (I - target) / target;
+    } else {
+        double target = load.power * 1e-6;
+        return (V * I - target) / target;
+    }
+}
+
+static void test_SetupCR(void) {
+    load.mode = FUNCTION_CR;
+    load.resistance = 100000;
+}
+
+static void test_StepCR(void) {
+    load.resistance = 80000;
+}
+
+static void test_SetupCP(void) {
+    load.mode = FUNCTION_CP;
+    load.power = 1200000;
+}
+
+static void test_StepCP(void) {
+    load.power = 1800000;
+}
+
+static void test_SetupBattery(void) {
+    test_SetupCP();
+    // 4.2V cell with 200mOhm, drops by 0.5V per As
+    halStub_SetSource(4200000, 200);
+    halStub.dischargeRate = 500000;
+    load.power = 400000;
+}
+
+static void test_StepBattery(void) {
+    load.power = 600000;
+}
+
+static void test_SetupRateLimit(void) {
+    test_SetupCR();
+    settings.regMaxRate = 2000;
+}
+
+static const testCase_t test_Cases[] = {
+        { "CR step", test_SetupCR, test_StepCR, 0.002, 30, 0.05, 0 },
+        { "CP step", test_SetupCP, test_StepCP, 0.002, 30, 0.05, 0 },
+        { "CP battery", test_SetupBattery, test_StepBattery, 0.005, 30, 0.05,
+                0 },
+        { "CR rate limit", test_SetupRateLimit, test_StepCR, 0.002, 60, 0.05,
+                2000 } };
+
+static void test_Run(const testCase_t *c, uint8_t regulated,
+        struct testResult *r) {
+    uint32_t i;
+    memset(r, 0, sizeof(*r));
+    test_Reset();
+    c->setup();
+    if (!regulated) {
+        settings.regKp = 0;
+        settings.regKi = 0;
+    }
+    load.powerOn = 1;
+    for (i = 0; i < TEST_TICKS; i++) {
+        halStub_Tick();
+        load_update();
+    }
+    c->step();
+    double finalCurrent = 0;
+    double peakCurrent = 0;
+    int32_t lastSet = 0;
+    for (i = 0; i < TEST_TICKS; i++) {
+        halStub_Tick();
+        load_update();
+        double err = test_Error();
+        if (fabs(err) > TEST_SETTLE_BAND)
+            r->settleTicks = i + 1;
+        if (i >= TEST_TICKS - TEST_STEADY_TICKS) {
+            r->steadyError += fabs(err) / TEST_STEADY_TICKS;
+            finalCurrent += (double) halStub.current / TEST_STEADY_TICKS;
+        }
+        if (halStub.current > peakCurrent)
+            peakCurrent = halStub.current;
+        // slope of the set current (the output of the regulator)
+        uint32_t slope = abs(reg.output - lastSet);
+        if (i && slope > r->maxSlope)
+            r->maxSlope = slope;
+        lastSet = reg.output;
+    }
+    r->overshoot = (peakCurrent - finalCurrent) / finalCurrent;
+    if (r->overshoot < 0)
+        r->overshoot = 0;
+}
+
+int main(void) {
+    uint8_t i;
+    uint32_t failures = 0;
+    printf("%-14s %-5s %10s %8s %10s %10s\n", "scenario", "reg", "steady err",
+            "settle", "overshoot", "slope");
+    printf("%-14s %-5s %10s %8s %10s %10s\n", "", "", "[%]", "[ms]", "[%]",
+            "[uA/ms]");
+    for (i = 0; i < sizeof(test_Cases) / sizeof(test_Cases[0]); i++) {
+        const testCase_t *c = &test_Cases[i];
+        uint8_t regulated;
+        for (regulated = 0; regulated < 2; regulated++) {
+            struct testResult r;
+            test_Run(c, regulated, &r);
+            uint8_t ok = 1;
+            if (regulated) {
+                ok = r.steadyError <= c->maxSteadyError
+                        && r.settleTicks <= c->maxSettleTicks
+                        && r.overshoot <= c->maxOvershoot
+                        && (!c->maxSlope || r.maxSlope <= c->maxSlope);
+            }
+            printf("%-14s %-5s %10.3f %8u %10.2f %10u %s\n", c->name,
+                    regulated ? "PI" : "ff", r.steadyError * 100,
+                    r.settleTicks, r.overshoot * 100, r.maxSlope,
+                    ok ? "" : "FAIL");
+            if (!ok)
+                failures++;
+        }
+    }
+    printf("regulatorTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
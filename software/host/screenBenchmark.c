@@ -0,0 +1,126 @@
+/**
+ * \file
+ * \brief   Host benchmark for the screen drawing primitives.
+ *
+ * Times the byte-wise primitives of screen.c against the per-pixel
+ * reference of screenReference.c on shapes the user interface draws
+ * and reports the time per call of both and the speedup.
+ *
+ * Usage: screenBenchmark [calls per shape]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "screenReference.h"
+
+#define BENCH_DEFAULT_CALLS     2000000
+
+typedef struct {
+    const char *name;
+    void (*draw)(uint32_t i);
+    void (*reference)(uint32_t i);
+} benchShape_t;
+
+static uint64_t bench_Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// frame of a soft button
+static void bench_SoftButton(uint32_t i) {
+    screen_VerticalLine(44, 55, 9);
+    screen_VerticalLine(83, 55, 9);
+    screen_HorizontalLine(45, 54, 38);
+}
+
+static void bench_SoftButtonRef(uint32_t i) {
+    screenRef_VerticalLine(44, 55, 9);
+    screenRef_VerticalLine(83, 55, 9);
+    screenRef_HorizontalLine(45, 54, 38);
+}
+
+// progress bar column of the characteristic tracing
+static void bench_ProgressBar(uint32_t i) {
+    screen_VerticalLine(3 + (i & 0x7F) % 121, 23, 18);
+}
+
+static void bench_ProgressBarRef(uint32_t i) {
+    screenRef_VerticalLine(3 + (i & 0x7F) % 121, 23, 18);
+}
+
+// frame of the snake game
+static void bench_Outline(uint32_t i) {
+    screen_Rectangle(2, 0, 125, 63);
+}
+
+static void bench_OutlineRef(uint32_t i) {
+    screenRef_Rectangle(2, 0, 125, 63);
+}
+
+// segment of a plotted curve (arbitrary sequence, characteristic)
+static void bench_CurveSegment(uint32_t i) {
+    uint8_t x = 1 + (i & 0x7F) % 127;
+    screen_Line(x - 1, (i * 7) % 54, x, (i * 13) % 54);
+}
+
+static void bench_CurveSegmentRef(uint32_t i) {
+    uint8_t x = 1 + (i & 0x7F) % 127;
+    screenRef_Line(x - 1, (i * 7) % 54, x, (i * 13) % 54);
+}
+
+static void bench_Diagonal(uint32_t i) {
+    screen_Line(0, (i & 0x0F), 127, 63 - (i & 0x0F));
+}
+
+static void bench_DiagonalRef(uint32_t i) {
+    screenRef_Line(0, (i & 0x0F), 127, 63 - (i & 0x0F));
+}
+
+static void bench_String(uint32_t i) {
+    screen_String6x8("1.2345A", 0, 3 + (i & 0x1F));
+}
+
+static void bench_StringRef(uint32_t i) {
+    const char *s = "1.2345A";
+    uint8_t x;
+    for (x = 0; *s; x += 6)
+        screenRef_Char6x8(*s++, x, 3 + (i & 0x1F));
+}
+
+static const benchShape_t bench_Shapes[] = {
+        { "soft button", bench_SoftButton, bench_SoftButtonRef },
+        { "progress column", bench_ProgressBar, bench_ProgressBarRef },
+        { "outline", bench_Outline, bench_OutlineRef },
+        { "curve segment", bench_CurveSegment, bench_CurveSegmentRef },
+        { "diagonal", bench_Diagonal, bench_DiagonalRef },
+        { "6x8 string at y", bench_String, bench_StringRef } };
+
+#define BENCH_NUM_SHAPES   (sizeof(bench_Shapes) / sizeof(bench_Shapes[0]))
+
+static double bench_Time(void (*draw)(uint32_t), uint32_t calls) {
+    uint32_t i;
+    memset(display.buffer, 0, sizeof(display.buffer));
+    uint64_t start = bench_Now();
+    for (i = 0; i < calls; i++)
+        draw(i);
+    return (double) (bench_Now() - start) / calls;
+}
+
+int main(int argc, char **argv) {
+    uint32_t calls = BENCH_DEFAULT_CALLS;
+    if (argc > 1)
+        calls = strtoul(argv[1], NULL, 0);
+    printf("%-18s %12s %12s %8s\n", "shape", "per-pixel", "byte-wise",
+            "speedup");
+    uint8_t s;
+    for (s = 0; s < BENCH_NUM_SHAPES; s++) {
+        double reference = bench_Time(bench_Shapes[s].reference, calls);
+        double fast = bench_Time(bench_Shapes[s].draw, calls);
+        printf("%-18s %9.1f ns %9.1f ns %7.1fx\n", bench_Shapes[s].name,
+                reference, fast, reference / fast);
+    }
+    return 0;
+}
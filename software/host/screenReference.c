@@ -0,0 +1,75 @@
+/**
+ * \file
+ * \brief   Per-pixel reference of the screen drawing primitives.
+ */
+#include <stdlib.h>
+
+#include "screenReference.h"
+
+void screenRef_VerticalLine(uint8_t x, uint8_t y, uint8_t length) {
+    uint8_t s = y;
+    for (; y < s + length; y++) {
+        screen_SetPixel(x, y, PIXEL_ON);
+    }
+}
+
+void screenRef_HorizontalLine(uint8_t x, uint8_t y, uint8_t length) {
+    uint8_t s = x;
+    for (; x < s + length; x++) {
+        screen_SetPixel(x, y, PIXEL_ON);
+    }
+}
+
+void screenRef_Line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
+    uint8_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    uint8_t dy = abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int8_t err = (dx > dy ? dx : -dy) / 2, e2;
+
+    for (;;) {
+        screen_SetPixel(x0, y0, PIXEL_ON);
+        if (x0 == x1 && y0 == y1)
+            break;
+        e2 = err;
+        if (e2 > -dx) {
+            err -= dy;
+            x0 += sx;
+        }
+        if (e2 < dy) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+void screenRef_Rectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2) {
+    uint8_t i;
+    for (i = x1; i <= x2; i++) {
+        screen_SetPixel(i, y1, PIXEL_ON);
+        screen_SetPixel(i, y2, PIXEL_ON);
+    }
+    for (i = y1 + 1; i < y2; i++) {
+        screen_SetPixel(x1, i, PIXEL_ON);
+        screen_SetPixel(x2, i, PIXEL_ON);
+    }
+}
+
+void screenRef_Char6x8(char c, uint8_t x, uint8_t y) {
+    uint8_t i, row;
+    for (i = 0; i < 6; i++) {
+        uint8_t column = font6x8[(uint8_t) c][i];
+        for (row = 0; row < 8; row++)
+            screen_SetPixel(x + i, y + row,
+                    (column & (1 << row)) ? PIXEL_ON : PIXEL_OFF);
+    }
+}
+
+void screenRef_Char12x16(char c, uint8_t x, uint8_t y) {
+    uint8_t i, row;
+    for (i = 0; i < 12; i++) {
+        uint16_t column = (uint8_t) font12x16[(uint8_t) c][i * 2 + 1]
+                | (uint8_t) font12x16[(uint8_t) c][i * 2] << 8;
+        for (row = 0; row < 16; row++)
+            screen_SetPixel(x + i, y + row,
+                    (column & (1 << row)) ? PIXEL_ON : PIXEL_OFF);
+    }
+}
@@ -0,0 +1,36 @@
+/**
+ * \file
+ * \brief   Per-pixel reference of the screen drawing primitives.
+ *
+ * The drawing primitives as they were before the byte-wise fast paths:
+ * every pixel is drawn with screen_SetPixel(). Used as the golden
+ * reference by screenTest and as the baseline by screenBenchmark.
+ */
+#ifndef SCREENREFERENCE_H_
+#define SCREENREFERENCE_H_
+
+#include "screen.h"
+
+// defined in screen.c
+extern const char font12x16[256][24];
+extern const char font6x8[256][6];
+
+void screenRef_VerticalLine(uint8_t x, uint8_t y, uint8_t length);
+
+void screenRef_HorizontalLine(uint8_t x, uint8_t y, uint8_t length);
+
+void screenRef_Line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+
+void screenRef_Rectangle(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2);
+
+/**
+ * \brief Draws a 6x8 character pixel by pixel at any y-coordinate
+ */
+void screenRef_Char6x8(char c, uint8_t x, uint8_t y);
+
+/**
+ * \brief Draws a 12x16 character pixel by pixel at any y-coordinate
+ */
+void screenRef_Char12x16(char c, uint8_t x, uint8_t y);
+
+#endif
@@ -0,0 +1,189 @@
+/**
+ * \file
+ * \brief   Host golden image test for the screen drawing primitives.
+ *
+ * Draws random lines, rectangles and characters into a random
+ * background with the byte-wise primitives of screen.c and with the
+ * per-pixel reference of screenReference.c and compares the display
+ * buffers. The coordinates include shapes that are partially or
+ * completely outside of the display. Characters at full pages must
+ * also match screen_FastChar6x8() and screen_FastChar12x16().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "screenReference.h"
+
+#define TEST_CASES      100000
+
+typedef enum {
+    TEST_VERTICAL,
+    TEST_HORIZONTAL,
+    TEST_LINE,
+    TEST_RECTANGLE,
+    TEST_CHAR6X8,
+    TEST_CHAR12X16,
+    TEST_NUM_PRIMITIVES
+} testPrimitive_t;
+
+static const char *test_Names[TEST_NUM_PRIMITIVES] = { "vertical line",
+        "horizontal line", "line", "rectangle", "6x8 character",
+        "12x16 character" };
+
+static uint8_t test_Background[1024];
+static uint8_t test_Golden[1024];
+
+/**
+ * \brief Draws one primitive with either implementation
+ *
+ * \param p Primitive to draw
+ * \param a Parameters of the primitive
+ * \param reference Use the per-pixel reference
+ */
+static void test_Draw(testPrimitive_t p, const uint8_t a[4],
+        uint8_t reference) {
+    switch (p) {
+    case TEST_VERTICAL:
+        if (reference)
+            screenRef_VerticalLine(a[0], a[1], a[2]);
+        else
+            screen_VerticalLine(a[0], a[1], a[2]);
+        break;
+    case TEST_HORIZONTAL:
+        if (reference)
+            screenRef_HorizontalLine(a[0], a[1], a[2]);
+        else
+            screen_HorizontalLine(a[0], a[1], a[2]);
+        break;
+    case TEST_LINE:
+        if (reference)
+            screenRef_Line(a[0], a[1], a[2], a[3]);
+        else
+            screen_Line(a[0], a[1], a[2], a[3]);
+        break;
+    case TEST_RECTANGLE:
+        if (reference)
+            screenRef_Rectangle(a[0], a[1], a[2], a[3]);
+        else
+            screen_Rectangle(a[0], a[1], a[2], a[3]);
+        break;
+    case TEST_CHAR6X8:
+        if (reference)
+            screenRef_Char6x8(a[3], a[0], a[1]);
+        else
+            screen_Char6x8(a[3], a[0], a[1]);
+        break;
+    case TEST_CHAR12X16:
+        if (reference)
+            screenRef_Char12x16(a[3], a[0], a[1]);
+        else
+            screen_Char12x16(a[3], a[0], a[1]);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * \brief Random parameters for a primitive
+ *
+ * x-coordinates range up to 159 and y-coordinates up to 79, so some
+ * shapes are clipped. The lengths keep the per-pixel loops of the
+ * reference from wrapping around.
+ */
+static void test_RandomArgs(testPrimitive_t p, uint8_t a[4]) {
+    a[0] = rand() % 160;
+    a[1] = rand() % 80;
+    switch (p) {
+    case TEST_VERTICAL:
+        a[2] = rand() % 140;
+        break;
+    case TEST_HORIZONTAL:
+        a[2] = rand() % 96;
+        break;
+    case TEST_LINE:
+        // the error term of the reference overflows for longer lines
+        a[0] = rand() % 128;
+        a[2] = rand() % 128;
+        a[3] = rand() % 80;
+        break;
+    case TEST_RECTANGLE:
+        a[2] = rand() % 160;
+        a[3] = rand() % 80;
+        break;
+    default:
+        a[3] = rand();
+        break;
+    }
+}
+
+static uint32_t test_Primitive(testPrimitive_t p) {
+    uint32_t mismatches = 0;
+    uint32_t i;
+    for (i = 0; i < TEST_CASES; i++) {
+        uint8_t a[4];
+        test_RandomArgs(p, a);
+        uint16_t j;
+        for (j = 0; j < 1024; j++)
+            test_Background[j] = rand();
+        memcpy(display.buffer, test_Background, 1024);
+        test_Draw(p, a, 1);
+        memcpy(test_Golden, display.buffer, 1024);
+        memcpy(display.buffer, test_Background, 1024);
+        test_Draw(p, a, 0);
+        if (memcmp(test_Golden, display.buffer, 1024)) {
+            if (!mismatches)
+                printf("%s (%u, %u, %u, %u) differs\n", test_Names[p], a[0],
+                        a[1], a[2], a[3]);
+            mismatches++;
+        }
+    }
+    printf("%-16s %6u cases, %u mismatches %s\n", test_Names[p], TEST_CASES,
+            mismatches, mismatches ? "FAIL" : "");
+    return mismatches ? 1 : 0;
+}
+
+/**
+ * \brief Compares the characters at full pages with the fast functions
+ */
+static uint32_t test_FullPages(void) {
+    uint32_t mismatches = 0;
+    uint16_t c;
+    for (c = 0; c < 256; c++) {
+        uint8_t page;
+        for (page = 0; page < 8; page++) {
+            uint8_t x = c % 128;
+            memset(display.buffer, 0x5A, 1024);
+            screen_FastChar6x8(c, x, page);
+            memcpy(test_Golden, display.buffer, 1024);
+            memset(display.buffer, 0x5A, 1024);
+            screen_Char6x8(c, x, page * 8);
+            if (memcmp(test_Golden, display.buffer, 1024))
+                mismatches++;
+            if (page == 7)
+                continue;
+            memset(display.buffer, 0x5A, 1024);
+            screen_FastChar12x16(c, x, page);
+            memcpy(test_Golden, display.buffer, 1024);
+            memset(display.buffer, 0x5A, 1024);
+            screen_Char12x16(c, x, page * 8);
+            if (memcmp(test_Golden, display.buffer, 1024))
+                mismatches++;
+        }
+    }
+    printf("characters at full pages: %u mismatches %s\n", mismatches,
+            mismatches ? "FAIL" : "");
+    return mismatches ? 1 : 0;
+}
+
+int main(void) {
+    uint32_t failures = 0;
+    srand(1);
+    testPrimitive_t p;
+    for (p = 0; p < TEST_NUM_PRIMITIVES; p++)
+        failures += test_Primitive(p);
+    failures += test_FullPages();
+    printf("screenTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+/**
+ * \file
+ * \brief   Host test for the DAC write elision and the setpoint cache.
+ *
+ * Runs load_update() against the HAL stub and checks that
+ * - a constant setpoint is only written again by the periodic refresh
+ * - changing the setpoint, the power mode or the calibration writes
+ *   the same DAC value the uncached calculation produces
+ * - hal_ForceDACUpdate() makes the next write go through
+ * - the profiler reports the written and skipped DAC updates
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "loadFunctions.h"
+#include "halStub.h"
+
+#define TEST_TICKS              10000
+
+static void test_Reset(void) {
+    halStub_ResetLoop();
+    load.mode = FUNCTION_CC;
+    load.current = 1000000;
+    load.powerOn = 1;
+}
+
+/**
+ * \brief Runs one tick and returns the DAC transfers it did
+ */
+static uint32_t test_Tick(void) {
+    halStub_Tick();
+    halStub_ResetCounters();
+    load_update();
+    return halStub.dacWrites;
+}
+
+/**
+ * \brief Returns the DAC value of a setpoint without the cache
+ */
+static uint16_t test_Uncached(void (*set)(uint32_t), uint32_t value) {
+    calSetpoint.function = CAL_SETPOINT_NONE;
+    hal_ForceDACUpdate();
+    set(value);
+    return halStub.dac;
+}
+
+/**
+ * \brief Checks that a change is written with the uncached value
+ *
+ * \param name Description of the change
+ * \return number of failures
+ */
+static uint32_t test_Change(const char *name, void (*set)(uint32_t),
+        uint32_t value) {
+    uint32_t writes = test_Tick();
+    uint16_t dac = halStub.dac;
+    uint16_t expected = test_Uncached(set, value);
+    // the following tick must not write again
+    uint32_t again = test_Tick();
+    uint8_t ok = writes == 1 && dac == expected && !again;
+    printf("%-24s DAC 0x%04x (expected 0x%04x), %u write(s) %s\n", name, dac,
+            expected, writes, ok ? "" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static uint32_t test_SteadyState(void) {
+    uint32_t failures = 0;
+    uint32_t i, writes = 0;
+    test_Reset();
+    test_Tick();
+    for (i = 0; i < TEST_TICKS; i++)
+        writes += test_Tick();
+    uint32_t expected = TEST_TICKS / LOAD_DAC_REFRESH_INTERVAL;
+    uint8_t ok = writes == expected;
+    printf("constant setpoint: %u DAC writes in %u ticks (expected %u) %s\n",
+            writes, TEST_TICKS, expected, ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+
+    struct profData d;
+    prof_GetData(&d);
+    ok = d.dacWrites + d.dacSkipped == TEST_TICKS + 1
+            && d.dacWrites == expected + 1;
+    printf("profiler: %u written, %u skipped (%.1f%%) %s\n", d.dacWrites,
+            d.dacSkipped, 100.0 * d.dacSkipped / (d.dacWrites + d.dacSkipped),
+            ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+    return failures;
+}
+
+static uint32_t test_Changes(void) {
+    uint32_t failures = 0;
+    test_Reset();
+    test_Tick();
+    test_Tick();
+
+    load.current = 100000;
+    failures += test_Change("current 100mA", cal_setCurrent, load.current);
+
+    settings.powerMode = 1;
+    failures += test_Change("high power mode", cal_setCurrent, load.current);
+
+    // shunt factor 1% off
+    calData.shuntFactor = calData.shuntFactor * 101 / 100;
+    cal_UpdateCoefficients();
+    failures += test_Change("new calibration", cal_setCurrent, load.current);
+
+    load.mode = FUNCTION_CV;
+    load.voltage = 5000000;
+    failures += test_Change("CV 5V", cal_setVoltage, load.voltage);
+
+    settings.analogCRCP = 1;
+    load.mode = FUNCTION_CR;
+    load.resistance = 10000;
+    failures += test_Change("analog CR 10R", cal_setResistance,
+            load.resistance);
+
+    load.mode = FUNCTION_CP;
+    load.power = 5000000;
+    failures += test_Change("analog CP 5W", cal_setPower, load.power);
+
+    // a forced update writes the unchanged value once
+    hal_ForceDACUpdate();
+    uint32_t writes = test_Tick();
+    writes += test_Tick();
+    uint8_t ok = writes == 1;
+    printf("forced update: %u write(s) %s\n", writes, ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+    return failures;
+}
+
+int main(void) {
+    uint32_t failures = 0;
+    failures += test_SteadyState();
+    failures += test_Changes();
+    printf("setpointTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,180 @@
+/**
+ * \file
+ * \brief   Host test for the setpoint slew rate limiter.
+ *
+ * Runs load_update() against the HAL stub and checks that
+ * - the set current ramps with the configured rate and the DAC follows
+ *   the ramp in every tick
+ * - the progress rises monotonically to 100%
+ * - a rate of 0 applies changes as a step
+ * - the voltage ramps down from the maximum voltage in CV mode
+ * - a new target during a ramp continues from the current setpoint
+ * - turning the input off and changing the mode restart the ramp at
+ *   the idle setpoint
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "loadFunctions.h"
+#include "halStub.h"
+
+// set current ramp: 100mA at 1mA/ms
+#define TEST_CURRENT            100000
+#define TEST_CURRENT_RATE       1000
+// set voltage ramp: down to 5V at 10mV/ms
+#define TEST_VOLTAGE            5000000
+#define TEST_VOLTAGE_RATE       10000
+
+static void test_Reset(void) {
+    halStub_ResetLoop();
+    settings.slewRate[SETTINGS_SLEW_CURRENT] = TEST_CURRENT_RATE;
+    settings.slewRate[SETTINGS_SLEW_VOLTAGE] = TEST_VOLTAGE_RATE;
+    load.mode = FUNCTION_CC;
+    load.current = TEST_CURRENT;
+    load.powerOn = 1;
+}
+
+static void test_Tick(void) {
+    halStub_Tick();
+    halStub_ResetCounters();
+    load_update();
+}
+
+/**
+ * \brief Moves a value towards a target by at most a rate
+ */
+static int32_t test_Step(int32_t value, int32_t target, int32_t rate) {
+    if (target > value)
+        return target - value > rate ? value + rate : target;
+    return value - target > rate ? value - rate : target;
+}
+
+static uint32_t test_CurrentRamp(void) {
+    uint32_t failures = 0;
+    test_Reset();
+    int32_t expected = 0;
+    uint32_t ticks = 0, wrongDAC = 0, wrongValue = 0;
+    uint8_t progress = 0, monotonic = 1;
+    while (ticks < 2 * TEST_CURRENT / TEST_CURRENT_RATE) {
+        test_Tick();
+        ticks++;
+        expected = test_Step(expected, TEST_CURRENT, TEST_CURRENT_RATE);
+        if (slew.value != expected)
+            wrongValue++;
+        if (halStub.dac != cal_CurrentToDAC(expected))
+            wrongDAC++;
+        if (slew_Progress() < progress)
+            monotonic = 0;
+        progress = slew_Progress();
+        if (slew.value == TEST_CURRENT)
+            break;
+    }
+    uint8_t ok = ticks == TEST_CURRENT / TEST_CURRENT_RATE && !wrongValue
+            && !wrongDAC && monotonic && progress == 100 && !error.code;
+    printf("CC 0 -> %uuA at %uuA/ms: %u ticks (expected %u), %u wrong "
+            "setpoints, %u wrong DAC values, progress %u%% %s\n",
+            TEST_CURRENT, TEST_CURRENT_RATE, ticks,
+            TEST_CURRENT / TEST_CURRENT_RATE, wrongValue, wrongDAC, progress,
+            ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+
+    // new target during the ramp
+    load.current = 20000;
+    uint32_t i;
+    for (i = 0; i < 30; i++)
+        test_Tick();
+    load.current = TEST_CURRENT;
+    test_Tick();
+    int32_t before = slew.value;
+    load.current = 10000;
+    test_Tick();
+    ok = slew.value == before - TEST_CURRENT_RATE
+            && halStub.dac == cal_CurrentToDAC(slew.value)
+            && slew.start == before && slew_Progress() < 10;
+    printf("new target at %duA: %duA, progress %u%% %s\n", before, slew.value,
+            slew_Progress(), ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+    return failures;
+}
+
+static uint32_t test_Step0(void) {
+    test_Reset();
+    settings.slewRate[SETTINGS_SLEW_CURRENT] = 0;
+    test_Tick();
+    uint8_t ok = slew.value == TEST_CURRENT
+            && halStub.dac == cal_CurrentToDAC(TEST_CURRENT)
+            && slew_Progress() == 100;
+    printf("rate 0: %duA after one tick %s\n", slew.value, ok ? "" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static uint32_t test_VoltageRamp(void) {
+    test_Reset();
+    load.mode = FUNCTION_CV;
+    load.voltage = TEST_VOLTAGE;
+    int32_t expected = settings.maxVoltage[settings.powerMode];
+    uint32_t ticks = 0, wrong = 0;
+    uint32_t limit = 2 * (expected - TEST_VOLTAGE) / TEST_VOLTAGE_RATE;
+    while (ticks < limit) {
+        test_Tick();
+        ticks++;
+        expected = test_Step(expected, TEST_VOLTAGE, TEST_VOLTAGE_RATE);
+        if (slew.value != expected)
+            wrong++;
+        if (slew.value == TEST_VOLTAGE)
+            break;
+    }
+    uint32_t start = settings.maxVoltage[settings.powerMode];
+    uint32_t ticksExpected = (start - TEST_VOLTAGE + TEST_VOLTAGE_RATE - 1)
+            / TEST_VOLTAGE_RATE;
+    uint8_t ok = ticks == ticksExpected && !wrong;
+    printf("CV %uuV -> %uuV at %uuV/ms: %u ticks (expected %u), %u wrong "
+            "setpoints %s\n", start, TEST_VOLTAGE, TEST_VOLTAGE_RATE, ticks,
+            ticksExpected, wrong, ok ? "" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+static uint32_t test_Restart(void) {
+    uint32_t failures = 0;
+    uint32_t i;
+    test_Reset();
+    for (i = 0; i < 50; i++)
+        test_Tick();
+    // the input is off for one tick
+    load.powerOn = 0;
+    test_Tick();
+    load.powerOn = 1;
+    test_Tick();
+    uint8_t ok = slew.value == TEST_CURRENT_RATE
+            && halStub.dac == cal_CurrentToDAC(TEST_CURRENT_RATE);
+    printf("input off and on: %duA %s\n", slew.value, ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+
+    // CV starts at the maximum voltage
+    for (i = 0; i < 50; i++)
+        test_Tick();
+    load.mode = FUNCTION_CV;
+    load.voltage = TEST_VOLTAGE;
+    test_Tick();
+    int32_t expected = settings.maxVoltage[settings.powerMode]
+            - TEST_VOLTAGE_RATE;
+    ok = slew.value == expected && slew.mode == FUNCTION_CV;
+    printf("mode change to CV: %duV (expected %duV) %s\n", slew.value,
+            expected, ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+    return failures;
+}
+
+int main(void) {
+    uint32_t failures = 0;
+    failures += test_CurrentRamp();
+    failures += test_Step0();
+    failures += test_VoltageRamp();
+    failures += test_Restart();
+    printf("slewTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
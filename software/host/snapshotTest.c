@@ -0,0 +1,212 @@
+/**
+ * \file
+ * \brief   Host stress test for the measurement snapshots.
+ *
+ * load_update() runs with a set current that changes every tick and
+ * records the measurements of every tick, first from a timer signal
+ * that interrupts the reader like the timer 2 interrupt does on the
+ * target, then in a thread next to several reader threads. The readers
+ * copy the snapshot with load_GetSnapshot() as fast as they can. Every
+ * copy must be the measurement set of a single tick:
+ * - all fields equal the recorded measurements of the tick given by the
+ *   sample counter
+ * - the power matches voltage and current of the same copy
+ * - the sample counter and the sums never decrease
+ * A further thread calls load_GetAverageAndReset() and checks that the
+ * averages stay within the range of the set current.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "loadFunctions.h"
+#include "halStub.h"
+
+#define TEST_TICKS              200000
+// ticks and their period for the interrupt-like phase
+#define TEST_SIGNAL_TICKS       50000
+#define TEST_SIGNAL_PERIOD_US   20
+#define TEST_READERS            3
+// the set current ramps between these in uA
+#define TEST_MIN_CURRENT        10000
+#define TEST_MAX_CURRENT        110000
+
+static volatile uint8_t test_running;
+
+// measurements of every tick, indexed by the sample counter
+static struct loadSnapshot test_truth[TEST_SIGNAL_TICKS + TEST_TICKS + 20];
+static volatile uint32_t test_truthSamples;
+// the timer signal stops after this sample
+static uint32_t test_signalEnd;
+
+struct readerResult {
+    uint32_t reads;
+    uint32_t checked;
+    uint32_t torn;
+    uint32_t backwards;
+};
+
+static void test_Reset(void) {
+    halStub_ResetLoop();
+    load.mode = FUNCTION_CC;
+    load.current = TEST_MIN_CURRENT;
+    load.powerOn = 1;
+}
+
+/**
+ * \brief Runs one tick and records its measurements
+ */
+static void test_Tick(void) {
+    uint32_t i = load.state.nsamples;
+    load.current = TEST_MIN_CURRENT
+            + (i % 1000) * ((TEST_MAX_CURRENT - TEST_MIN_CURRENT) / 1000);
+    halStub_Tick();
+    halStub_ResetCounters();
+    load_update();
+    test_truth[load.state.nsamples] = load.state;
+    __sync_synchronize();
+    test_truthSamples = load.state.nsamples;
+}
+
+static void test_Signal(int sig) {
+    (void) sig;
+    if (!test_running)
+        return;
+    test_Tick();
+    if (load.state.nsamples >= test_signalEnd)
+        test_running = 0;
+}
+
+static void* test_Writer(void *arg) {
+    uint32_t i;
+    (void) arg;
+    for (i = 0; i < TEST_TICKS; i++)
+        test_Tick();
+    test_running = 0;
+    return NULL;
+}
+
+static uint8_t test_Equal(const struct loadSnapshot *a,
+        const struct loadSnapshot *b) {
+    return a->current == b->current && a->voltage == b->voltage
+            && a->power == b->power && a->temp1 == b->temp1
+            && a->temp2 == b->temp2 && a->currentSum == b->currentSum
+            && a->voltageSum == b->voltageSum && a->powerSum == b->powerSum
+            && a->nsamples == b->nsamples;
+}
+
+static void* test_Reader(void *arg) {
+    struct readerResult *r = arg;
+    struct loadSnapshot last;
+    memset(&last, 0, sizeof(last));
+    while (test_running) {
+        struct loadSnapshot s;
+        load_GetSnapshot(&s);
+        r->reads++;
+        if (s.nsamples <= test_truthSamples) {
+            __sync_synchronize();
+            r->checked++;
+            if (!test_Equal(&s, &test_truth[s.nsamples]))
+                r->torn++;
+        }
+        if (s.power != (int32_t) ((uint64_t) s.voltage * s.current / 1000000UL)
+                || (s.nsamples && s.currentSum < (uint64_t) s.current))
+            r->torn++;
+        if (s.nsamples < last.nsamples || s.currentSum < last.currentSum
+                || s.voltageSum < last.voltageSum
+                || s.powerSum < last.powerSum)
+            r->backwards++;
+        last = s;
+    }
+    return NULL;
+}
+
+static void* test_Averager(void *arg) {
+    struct readerResult *r = arg;
+    while (test_running) {
+        uint32_t current, voltage, power;
+        load_GetAverageAndReset(&current, &voltage, &power);
+        r->reads++;
+        // allows for the gain error and the lag of the modeled load
+        if (current > TEST_MAX_CURRENT + TEST_MAX_CURRENT / 10
+                || voltage > 12000000)
+            r->torn++;
+    }
+    return NULL;
+}
+
+static uint32_t test_Report(const char *name, struct readerResult *r,
+        uint8_t checked) {
+    uint8_t ok = r->reads && !r->torn && !r->backwards
+            && (!checked || r->checked);
+    printf("%-10s %9u reads, %9u checked, %u inconsistent, %u backwards %s\n",
+            name, r->reads, r->checked, r->torn, r->backwards,
+            ok ? "" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+/**
+ * \brief Reads while a timer signal runs the ticks
+ */
+static uint32_t test_Interrupted(void) {
+    struct readerResult result;
+    memset(&result, 0, sizeof(result));
+    test_signalEnd = load.state.nsamples + TEST_SIGNAL_TICKS;
+    test_running = 1;
+    signal(SIGALRM, test_Signal);
+    struct itimerval period = { { 0, TEST_SIGNAL_PERIOD_US }, { 0,
+            TEST_SIGNAL_PERIOD_US } };
+    setitimer(ITIMER_REAL, &period, NULL);
+    test_Reader(&result);
+    memset(&period, 0, sizeof(period));
+    setitimer(ITIMER_REAL, &period, NULL);
+    signal(SIGALRM, SIG_IGN);
+    return test_Report("interrupt", &result, 1);
+}
+
+/**
+ * \brief Reads from several threads while another one runs the ticks
+ */
+static uint32_t test_Threads(void) {
+    uint32_t failures = 0;
+    uint32_t i;
+    pthread_t writer, readers[TEST_READERS], averager;
+    struct readerResult results[TEST_READERS + 1];
+    memset(results, 0, sizeof(results));
+    test_running = 1;
+    for (i = 0; i < TEST_READERS; i++)
+        pthread_create(&readers[i], NULL, test_Reader, &results[i]);
+    pthread_create(&averager, NULL, test_Averager, &results[TEST_READERS]);
+    pthread_create(&writer, NULL, test_Writer, NULL);
+    pthread_join(writer, NULL);
+    for (i = 0; i < TEST_READERS; i++)
+        pthread_join(readers[i], NULL);
+    pthread_join(averager, NULL);
+    for (i = 0; i < TEST_READERS; i++)
+        failures += test_Report("thread", &results[i], 1);
+    failures += test_Report("averager", &results[TEST_READERS], 0);
+    return failures;
+}
+
+int main(void) {
+    uint32_t failures = 0;
+    test_Reset();
+    // a few ticks to settle the modeled load
+    uint32_t i;
+    for (i = 0; i < 10; i++)
+        test_Tick();
+    failures += test_Interrupted();
+    failures += test_Threads();
+    uint32_t expected = 10 + TEST_SIGNAL_TICKS + TEST_TICKS;
+    uint8_t ok = load.powerOn && !error.code
+            && load.snapshot.data.nsamples == expected;
+    printf("%u samples (expected %u), error code 0x%x %s\n",
+            load.snapshot.data.nsamples, expected, error.code,
+            ok ? "" : "FAIL");
+    if (!ok)
+        failures++;
+    printf("snapshotTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}
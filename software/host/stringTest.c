@@ -0,0 +1,66 @@
+/**
+ * \file
+ * \brief   Host test for the number parsing of the communication.
+ *
+ * Compares string_toInt() against strtol(s, NULL, 0) of the host C
+ * library, limited to 32 bits, for fixed corner cases and random
+ * numbers in all bases.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "stringFunctions.h"
+
+#define TEST_RANDOM_VALUES      1000000
+
+static uint32_t test_failures;
+
+static int32_t test_Expected(const char *s) {
+    long value = strtol(s, NULL, 0);
+    if (value > INT32_MAX)
+        return INT32_MAX;
+    if (value < INT32_MIN)
+        return INT32_MIN;
+    return value;
+}
+
+static void test_Compare(const char *s) {
+    int32_t result = string_toInt(s);
+    int32_t expected = test_Expected(s);
+    if (result != expected) {
+        if (test_failures < 10)
+            printf("\"%s\": %d (expected %d)\n", s, result, expected);
+        test_failures++;
+    }
+}
+
+int main(void) {
+    const char *cases[] = { "", "0", "-0", "+0", "123", "-123", "+123",
+            "  42", "\t\n-7", "42abc", "abc", "-", "+", "0x", "0x1F", "0XfF",
+            "-0x10", "0xg", "010", "-017", "08", "09", "2147483647",
+            "2147483648", "-2147483648", "-2147483649", "99999999999999",
+            "-99999999999999", "0x7fffffff", "0x80000000", "0xffffffffff",
+            "037777777777", "1000 100", "1e5", "--1", "+-1" };
+    uint32_t i;
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        test_Compare(cases[i]);
+    srand(1);
+    for (i = 0; i < TEST_RANDOM_VALUES; i++) {
+        // up to 40 bits, some of them are out of range
+        int64_t value = ((int64_t) rand() << 9) ^ rand();
+        value >>= rand() % 40;
+        if (rand() & 1)
+            value = -value;
+        const char *formats[] = { "%lld", "0x%llx", "0%llo" };
+        uint8_t base = rand() % 3;
+        char buf[32];
+        if (value < 0 && base)
+            snprintf(buf, sizeof(buf), base == 1 ? "-0x%llx" : "-0%llo",
+                    (long long) -value);
+        else
+            snprintf(buf, sizeof(buf), formats[base], (long long) value);
+        test_Compare(buf);
+    }
+    printf("stringTest: %u failures\n", test_failures);
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,350 @@
+/**
+ * \file
+ * \brief   Host stub for the analog board HAL.
+ *
+ * Keeps the AVR GPIO handling of the real HAL (it is pure logic) and
+ * replaces all bit-banged transfers with a model of a voltage source
+ * with internal resistance connected to the load. The model only sees
+ * the AVR pins that were committed with hal_UpdateAVRGPIOs().
+ */
+#include <stdlib.h>
+#include <math.h>
+#include "currentSink.h"
+#include "calibration.h"
+#include "settings.h"
+#include "common.h"
+#include "timer.h"
+#include "halStub.h"
+
+GPIO_TypeDef host_GPIOA, host_GPIOB, host_GPIOC, host_GPIOD;
+
+void halStub_SetSource(int32_t uV, int32_t mOhm) {
+    halStub.sourceVoltage = uV;
+    halStub.sourceResistance = mOhm;
+    halStub.voltage = uV;
+    halStub.current = 0;
+    halStub.charge = 0;
+    halStub.lagCurrent = 0;
+    halStub.modelTime = timer.ms;
+}
+
+void halStub_ResetCounters(void) {
+    halStub.avrFrames = 0;
+    halStub.avrADCReads = 0;
+    halStub.dacWrites = 0;
+    halStub.dacDirectWrites = 0;
+    halStub.adcConversions = 0;
+    halStub.waitus = 0;
+    halStub.modeSelects = 0;
+    halStub.displayCommands = 0;
+    halStub.displayWrites = 0;
+}
+
+/**
+ * \brief Updates the modeled terminal voltage and current
+ *
+ * Uses the set tables of the active calibration to convert the DAC
+ * value back into a physical setpoint. The plant effects (gain error,
+ * lag, battery discharge) are applied on top of this static model.
+ */
+static void halStub_UpdateModel(void) {
+    int32_t current, voltage;
+    uint8_t mode = halStub.avrPins & (HAL_GPIO_MODE_A | HAL_GPIO_MODE_B);
+    // the low shunt scales the current the analog loop regulates
+    double shunt = settings.powerMode ? calData.shuntFactor / 100.0 : 1.0;
+    // open circuit voltage of a discharging battery
+    int32_t sourceVoltage = halStub.sourceVoltage
+            - halStub.charge * halStub.dischargeRate;
+    if (sourceVoltage < 0)
+        sourceVoltage = 0;
+    double Vs = sourceVoltage * 1e-6;
+    double Rs = halStub.sourceResistance * 1e-3;
+    if (mode == (HAL_GPIO_MODE_A | HAL_GPIO_MODE_B)) {
+        // CR mode: I = G * V with V = Vs - I * Rs
+        double G = common_Map(halStub.dac, calData.conductanceSetTable[0][0],
+                calData.conductanceSetTable[1][0],
+                calData.conductanceSetTable[0][1],
+                calData.conductanceSetTable[1][1]) * 1e-6 * shunt;
+        if (G < 0)
+            G = 0;
+        double I = Vs * G / (1 + Rs * G);
+        current = I * 1e6;
+    } else if (mode == HAL_GPIO_MODE_B) {
+        // CP mode: P = I * (Vs - I * Rs), the upper voltage solution
+        double P = common_Map(halStub.dac, calData.powerSetTable[0][0],
+                calData.powerSetTable[1][0], calData.powerSetTable[0][1],
+                calData.powerSetTable[1][1]) * 1e-6 * shunt;
+        if (P < 0)
+            P = 0;
+        double disc = Vs * Vs - 4 * Rs * P;
+        // above the maximum power the source collapses to Vs / 2
+        double I;
+        if (Rs > 0)
+            I = (Vs - (disc > 0 ? sqrt(disc) : 0)) / (2 * Rs);
+        else
+            I = Vs > 0 ? P / Vs : 0;
+        current = I * 1e6;
+    } else if (mode == HAL_GPIO_MODE_A) {
+        // CV mode: the load pulls the terminal down to the set voltage
+        voltage = common_Map(halStub.dac, calData.voltageSetTable[0][0],
+                calData.voltageSetTable[1][0], calData.voltageSetTable[0][1],
+                calData.voltageSetTable[1][1]);
+        if (voltage > sourceVoltage)
+            voltage = sourceVoltage;
+        if (voltage < 0)
+            voltage = 0;
+        current = ((int64_t) (sourceVoltage - voltage) * 1000)
+                / halStub.sourceResistance;
+    } else {
+        current = common_Map(halStub.dac, calData.currentSetTable[0][0],
+                calData.currentSetTable[1][0], calData.currentSetTable[0][1],
+                calData.currentSetTable[1][1]);
+        if (settings.powerMode)
+            current = ((int64_t) current * calData.shuntFactor) / 100;
+        // the real set current deviates from the calibration
+        current += ((int64_t) current * halStub.gainError) / 1000000;
+        if (current < 0)
+            current = 0;
+    }
+    // advance the time dependent part of the model once per millisecond
+    while (halStub.modelTime != timer.ms) {
+        halStub.modelTime++;
+        if (halStub.lag)
+            halStub.lagCurrent += (current - halStub.lagCurrent) / halStub.lag;
+        // uA for one millisecond in As
+        halStub.charge += halStub.current * 1e-9;
+    }
+    if (halStub.lag)
+        current = halStub.lagCurrent;
+    // the source can't deliver more than its short circuit current
+    int32_t maxCurrent = ((int64_t) sourceVoltage * 1000)
+            / halStub.sourceResistance;
+    if (current > maxCurrent)
+        current = maxCurrent;
+    voltage = sourceVoltage
+            - ((int64_t) current * halStub.sourceResistance) / 1000;
+    halStub.voltage = voltage;
+    halStub.current = current;
+}
+
+void hal_currentSinkInit(void) {
+    hal_ForceDACUpdate();
+    hal_setDAC(0);
+}
+
+void hal_SetChipSelect(uint8_t cs) {
+}
+
+void hal_SetAVRGPIO(uint8_t gpio) {
+    hal.AVRgpio |= gpio;
+}
+void hal_ClearAVRGPIO(uint8_t gpio) {
+    hal.AVRgpio &= ~gpio;
+}
+
+void hal_UpdateAVRGPIOs(void) {
+    if (hal.AVRgpio != halStub.avrPins) {
+        // only update when there is actually a pinchange
+        halStub.avrPins = hal.AVRgpio;
+        halStub.avrFrames++;
+    }
+}
+
+uint16_t hal_ReadAVRADC(uint8_t channel) {
+    int32_t raw = 0;
+    halStub.avrADCReads++;
+    switch (channel) {
+    case HAL_AVR_ADC_TEMP1:
+    case HAL_AVR_ADC_TEMP2:
+        // 30 degree celsius
+        raw = 61;
+        break;
+    case HAL_AVR_ADC_P5V:
+        raw = 225;
+        break;
+    case HAL_AVR_ADC_P15V:
+        raw = 763;
+        break;
+    case HAL_AVR_ADC_N15V:
+        raw = 585;
+        break;
+    }
+    raw += halStub.avrADCOffset[channel & 0x0F];
+    if (raw < 0)
+        raw = 0;
+    else if (raw > 0x3FF)
+        raw = 0x3FF;
+    return raw;
+}
+
+void hal_ReadAVRADCAsync(uint8_t channel, void (*done)(uint16_t)) {
+    // the transfer completes immediately
+    done(hal_ReadAVRADC(channel));
+}
+
+uint8_t hal_ReadTemperature(uint8_t temp) {
+    if (temp == HAL_TEMP1)
+        return hal_ConvertTemperature(hal_ReadAVRADC(HAL_AVR_ADC_TEMP1));
+    else
+        return hal_ConvertTemperature(hal_ReadAVRADC(HAL_AVR_ADC_TEMP2));
+}
+
+uint8_t hal_ConvertTemperature(uint16_t raw) {
+    return ((uint32_t) raw * 125 / 256) & 0xFF;
+}
+
+int16_t hal_ReadVoltageRail(uint8_t rail) {
+    switch (rail) {
+    case HAL_RAIL_P5V:
+        return hal_ConvertVoltageRail(rail, hal_ReadAVRADC(HAL_AVR_ADC_P5V));
+    case HAL_RAIL_P15V:
+        return hal_ConvertVoltageRail(rail, hal_ReadAVRADC(HAL_AVR_ADC_P15V));
+    case HAL_RAIL_N15V:
+        return hal_ConvertVoltageRail(rail, hal_ReadAVRADC(HAL_AVR_ADC_N15V));
+    }
+    return 0;
+}
+
+int16_t hal_ConvertVoltageRail(uint8_t rail, uint16_t raw) {
+    switch (rail) {
+    case HAL_RAIL_P5V:
+        return raw ? 1126400 / raw : 0;
+    case HAL_RAIL_P15V:
+        return (int32_t) raw * 492 / 25;
+    case HAL_RAIL_N15V:
+        return -((1829 - (int32_t) raw) * 603 / 50);
+    }
+    return 0;
+}
+
+void hal_setDAC(uint16_t dac) {
+    if (hal.DACvalid && hal.DACvalue == dac) {
+        hal.DACskipped++;
+        return;
+    }
+    hal.DACvalue = dac;
+    hal.DACvalid = 1;
+    hal.DACwrites++;
+    halStub.dacWrites++;
+    halStub.dac = dac;
+}
+
+void hal_setDACDirect(uint16_t dac) {
+    halStub.dacDirectWrites++;
+    halStub.dac = dac;
+    if (halStub.dacDirectTrace)
+        halStub.dacDirectTrace(dac);
+}
+
+void hal_ForceDACUpdate(void) {
+    hal.DACvalid = 0;
+}
+
+void hal_setFan(uint8_t en) {
+}
+
+uint16_t hal_ConvertADC(void) {
+    int32_t value;
+    int32_t (*table)[2];
+    halStub_UpdateModel();
+    if (halStub.avrPins & HAL_GPIO_ANALOG_MUX) {
+        value = halStub.voltage;
+        table = calData.voltageSenseTable;
+    } else {
+        value = halStub.current;
+        if (settings.powerMode)
+            value = ((int64_t) value * 100) / calData.shuntFactor;
+        table = calData.currentSenseTable;
+    }
+    int32_t sample = common_Map(value, table[0][1], table[1][1], table[0][0],
+            table[1][0]);
+    if (halStub.adcNoise)
+        sample += (rand() % halStub.adcNoise) - halStub.adcNoise / 2;
+    if (sample < 0)
+        sample = 0;
+    else if (sample > UINT16_MAX)
+        sample = UINT16_MAX;
+    halStub.adcConversions++;
+    return sample;
+}
+
+void hal_ConvertADCDual(uint16_t adc[2]) {
+    // the model has a converter on both data lines
+    uint8_t pins = halStub.avrPins;
+    halStub.avrPins &= ~HAL_GPIO_ANALOG_MUX;
+    adc[HAL_ADC_CURRENT] = hal_ConvertADC();
+    halStub.avrPins |= HAL_GPIO_ANALOG_MUX;
+    adc[HAL_ADC_VOLTAGE] = hal_ConvertADC();
+    halStub.avrPins = pins;
+    halStub.adcConversions--;
+}
+
+void hal_CheckADCStability(uint16_t min, uint16_t max) {
+}
+
+uint16_t hal_getADC(uint32_t nsamples) {
+    uint32_t i;
+    uint64_t buf = 0;
+    for (i = 0; i < nsamples; i++) {
+        buf += hal_ConvertADC();
+    }
+    return buf / nsamples;
+}
+
+void hal_SetControlMode(uint8_t mode) {
+    halStub.modeSelects++;
+    switch (mode) {
+    case HAL_MODE_CC:
+        hal_ClearAVRGPIO(HAL_GPIO_MODE_A);
+        hal_ClearAVRGPIO(HAL_GPIO_MODE_B);
+        break;
+    case HAL_MODE_CV:
+        hal_SetAVRGPIO(HAL_GPIO_MODE_A);
+        hal_ClearAVRGPIO(HAL_GPIO_MODE_B);
+        break;
+    case HAL_MODE_CR:
+        hal_SetAVRGPIO(HAL_GPIO_MODE_A);
+        hal_SetAVRGPIO(HAL_GPIO_MODE_B);
+        break;
+    case HAL_MODE_CP:
+        hal_ClearAVRGPIO(HAL_GPIO_MODE_A);
+        hal_SetAVRGPIO(HAL_GPIO_MODE_B);
+        break;
+    }
+}
+
+void hal_SelectShunt(uint8_t shunt) {
+    halStub.modeSelects++;
+    switch (shunt) {
+    case HAL_SHUNT_NONE:
+        hal_SetAVRGPIO(HAL_GPIO_SHUNT_EN1);
+        hal_SetAVRGPIO(HAL_GPIO_SHUNT_EN2);
+        hal_SetAVRGPIO(HAL_GPIO_SHUNTSEL);
+        break;
+    case HAL_SHUNT_R01:
+        hal_ClearAVRGPIO(HAL_GPIO_SHUNT_EN1);
+        hal_SetAVRGPIO(HAL_GPIO_SHUNT_EN2);
+        hal_SetAVRGPIO(HAL_GPIO_SHUNTSEL);
+        break;
+    case HAL_SHUNT_1R:
+        hal_SetAVRGPIO(HAL_GPIO_SHUNT_EN1);
+        hal_ClearAVRGPIO(HAL_GPIO_SHUNT_EN2);
+        hal_ClearAVRGPIO(HAL_GPIO_SHUNTSEL);
+        break;
+    }
+}
+
+void hal_SelectADCChannel(uint8_t channel) {
+    switch (channel) {
+    case HAL_ADC_CURRENT:
+        hal_ClearAVRGPIO(HAL_GPIO_ANALOG_MUX);
+        break;
+    case HAL_ADC_VOLTAGE:
+        hal_SetAVRGPIO(HAL_GPIO_ANALOG_MUX);
+        break;
+    }
+}
+
+uint8_t hal_isStable(void) {
+    return 1;
+}
@@ -0,0 +1,115 @@
+/**
+ * \file
+ * \brief   Host stub for the display GPIOs.
+ *
+ * GPIO_WriteBit() updates the output data register of the host ports.
+ * Stores to the bit set/reset registers can't be observed on the host,
+ * they take effect at the next halStub_ApplyGPIO() call instead. It is
+ * called from GPIO_WriteBit(), during the enable pulse (see
+ * timer_waitCycles()) and after each step of the transfer. The HAL
+ * writes each of them at most once in between. The enable
+ * line is high after the pulse has started, thus a pending reset of it
+ * is a falling edge that happened before the other pending stores.
+ *
+ * The falling edge of the enable line strobes the data bus into a
+ * model of the two KS0108 controllers, which keeps their RAM, page and
+ * address pointers in halStub and counts the transferred commands and
+ * data bytes. The pin mapping is that of the board, it deliberately
+ * doesn't use the macros of the display HAL.
+ */
+#include "display.h"
+#include "halStub.h"
+
+/**
+ * \brief Reads the data bus DB0-DB7 from the port outputs
+ */
+static uint8_t halStub_DisplayBus(void) {
+    uint8_t data = 0;
+    if (GPIOB->ODR & GPIO_Pin_3)
+        data |= 0x01;
+    if (GPIOA->ODR & GPIO_Pin_15)
+        data |= 0x02;
+    if (GPIOC->ODR & GPIO_Pin_10)
+        data |= 0x04;
+    if (GPIOC->ODR & GPIO_Pin_11)
+        data |= 0x08;
+    if (GPIOC->ODR & GPIO_Pin_12)
+        data |= 0x10;
+    if (GPIOA->ODR & GPIO_Pin_12)
+        data |= 0x20;
+    if (GPIOA->ODR & GPIO_Pin_11)
+        data |= 0x40;
+    if (GPIOA->ODR & GPIO_Pin_10)
+        data |= 0x80;
+    return data;
+}
+
+/**
+ * \brief Executes the command or data write on the display bus
+ */
+static void halStub_DisplayStrobe(void) {
+    // writes only, reads are not modeled
+    if (GPIOB->ODR & GPIO_Pin_4)
+        return;
+    uint8_t data = halStub_DisplayBus();
+    uint8_t isData = (GPIOB->ODR & GPIO_Pin_5) ? 1 : 0;
+    if (isData)
+        halStub.displayWrites++;
+    else
+        halStub.displayCommands++;
+    uint8_t half;
+    for (half = 0; half < 2; half++) {
+        // CS1 (PA9) selects the left, CS2 (PA8) the right half
+        if (!(GPIOA->ODR & (half ? GPIO_Pin_8 : GPIO_Pin_9)))
+            continue;
+        if (isData) {
+            halStub.panel[halStub.panelPage[half] * 128 + half * 64
+                    + halStub.panelAddress[half]] = data;
+            halStub.panelAddress[half] = (halStub.panelAddress[half] + 1)
+                    & 0x3F;
+        } else if ((data & 0xC0) == DISPLAY_SET_ADDRESS) {
+            halStub.panelAddress[half] = data & 0x3F;
+        } else if ((data & 0xF8) == DISPLAY_SET_PAGE) {
+            halStub.panelPage[half] = data & 0x07;
+        }
+    }
+}
+
+/**
+ * \brief Applies the pending bit set/reset register stores of a port
+ */
+static void halStub_ApplyBSRR(GPIO_TypeDef *port) {
+    port->ODR &= ~((port->BSRR >> 16) | port->BRR);
+    port->ODR |= port->BSRR & 0xFFFF;
+    port->BSRR = 0;
+    port->BRR = 0;
+}
+
+void halStub_ApplyGPIO(void) {
+    uint8_t strobe = (GPIOD->ODR & GPIO_Pin_2)
+            && (((GPIOD->BSRR >> 16) | GPIOD->BRR) & GPIO_Pin_2);
+    if (strobe)
+        halStub_DisplayStrobe();
+    halStub_ApplyBSRR(GPIOA);
+    halStub_ApplyBSRR(GPIOB);
+    halStub_ApplyBSRR(GPIOC);
+    halStub_ApplyBSRR(GPIOD);
+}
+
+void GPIO_WriteBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, BitAction BitVal) {
+    halStub_ApplyGPIO();
+    uint8_t strobe = GPIOx == GPIOD && (GPIO_Pin & GPIO_Pin_2)
+            && (GPIOx->ODR & GPIO_Pin_2) && BitVal == Bit_RESET;
+    if (BitVal == Bit_SET)
+        GPIOx->ODR |= GPIO_Pin;
+    else
+        GPIOx->ODR &= ~GPIO_Pin;
+    if (strobe)
+        halStub_DisplayStrobe();
+}
+
+void GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_InitStruct) {
+}
+
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState) {
+}
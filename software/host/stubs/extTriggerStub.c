@@ -0,0 +1,20 @@
+/**
+ * \file
+ * \brief   Host stub for the external trigger HAL.
+ */
+#include "extTrigger.h"
+
+static uint8_t triggerOut;
+
+void hal_triggerInit(void) {
+    triggerOut = 0;
+}
+
+void hal_setTriggerOut(uint8_t state) {
+    triggerOut = state;
+}
+
+uint8_t hal_getTriggerIn(void) {
+    // loop trigger out back to trigger in
+    return triggerOut;
+}
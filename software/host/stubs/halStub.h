@@ -0,0 +1,108 @@
+/**
+ * \file
+ * \brief   Host stub hardware abstraction layer header file.
+ *
+ * Replaces the analog board, timer and trigger HAL with a simple
+ * software model. The model also counts every bus transaction and
+ * requested busy-wait, so the benchmark can report them per tick.
+ */
+#ifndef HALSTUB_H_
+#define HALSTUB_H_
+
+#include <stdint.h>
+
+struct {
+    // simulated source connected to the load input
+    // open circuit voltage in uV
+    int32_t sourceVoltage;
+    // internal resistance in mOhm
+    int32_t sourceResistance;
+    // peak-to-peak ADC noise in LSB
+    uint16_t adcNoise;
+    // deviation of the real from the calibrated CC current in ppm
+    int32_t gainError;
+    // time constant of the current in ms (0: follows immediately)
+    uint16_t lag;
+    // drop of the open circuit voltage in uV per As (battery)
+    int32_t dischargeRate;
+    // added to the AVR ADC results, indexed by HAL_AVR_ADC_*
+    int16_t avrADCOffset[16];
+
+    // model state
+    uint16_t dac;
+    // pin state of the AVR (last frame sent by hal_UpdateAVRGPIOs)
+    uint8_t avrPins;
+    int32_t voltage;
+    int32_t current;
+    double lagCurrent;
+    // charge drawn from the source in As
+    double charge;
+    // timer.ms of the last model step
+    uint32_t modelTime;
+
+    // time in us of the running resp. next call of the compare function
+    uint64_t compareTime;
+    // called for every DAC value written by hal_setDACDirect()
+    void (*dacDirectTrace)(uint16_t dac);
+
+    // KS0108 display model: RAM content (same layout as display.buffer),
+    // page and address pointer of both controllers
+    uint8_t panel[1024];
+    uint8_t panelPage[2];
+    uint8_t panelAddress[2];
+
+    // transaction counters (reset by the benchmark driver)
+    uint32_t avrFrames;
+    uint32_t avrADCReads;
+    uint32_t dacWrites;
+    uint32_t dacDirectWrites;
+    uint32_t adcConversions;
+    uint32_t waitus;
+    // calls of hal_SetControlMode() and hal_SelectShunt()
+    uint32_t modeSelects;
+    // commands and data bytes strobed into the display
+    uint32_t displayCommands;
+    uint32_t displayWrites;
+} halStub;
+
+/**
+ * \brief Sets up the simulated source
+ *
+ * \param uV    Open circuit voltage in uV
+ * \param mOhm  Internal resistance in mOhm
+ */
+void halStub_SetSource(int32_t uV, int32_t mOhm);
+
+/**
+ * \brief Clears all transaction counters
+ */
+void halStub_ResetCounters(void);
+
+/**
+ * \brief Advances the system time by one millisecond
+ *
+ * Runs the SysTick function (background acquisition) as often as it
+ * would be called in one millisecond.
+ */
+void halStub_Tick(void);
+
+/**
+ * \brief Applies the pending bit set/reset register stores of the
+ * display ports
+ *
+ * A falling edge of the enable line strobes the data bus as it was
+ * before the pending stores.
+ */
+void halStub_ApplyGPIO(void);
+
+/**
+ * \brief Puts the control loop into its power-on state
+ *
+ * Clears the load, error, event, regulator and HAL state as well as the
+ * stub state and runs the initialization of main() with default
+ * settings and default calibration. The simulated source is a 12V
+ * supply with 100mOhm internal resistance, the input is off.
+ */
+void halStub_ResetLoop(void);
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * \file
+ * \brief   Host replacement for the STM32F10x device header.
+ *
+ * Only provides the register layouts and pin definitions that are
+ * referenced from headers of the control loop. Peripherals are plain
+ * structs in host memory, so register accesses compile and run but
+ * have no effect.
+ */
+#ifndef STM32F10X_H_
+#define STM32F10X_H_
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t CRL;
+    volatile uint32_t CRH;
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+    volatile uint32_t BSRR;
+    volatile uint32_t BRR;
+    volatile uint32_t LCKR;
+} GPIO_TypeDef;
+
+typedef struct {
+    volatile uint16_t SR;
+    volatile uint16_t CNT;
+    volatile uint16_t ARR;
+    volatile uint16_t PSC;
+} TIM_TypeDef;
+
+#define TIM_SR_UIF          ((uint16_t)0x0001)
+
+typedef enum {
+    Bit_RESET = 0, Bit_SET
+} BitAction;
+
+typedef enum {
+    DISABLE = 0, ENABLE
+} FunctionalState;
+
+typedef enum {
+    GPIO_Speed_10MHz = 1, GPIO_Speed_2MHz, GPIO_Speed_50MHz
+} GPIOSpeed_TypeDef;
+
+typedef enum {
+    GPIO_Mode_Out_PP = 0x10
+} GPIOMode_TypeDef;
+
+typedef struct {
+    uint16_t GPIO_Pin;
+    GPIOSpeed_TypeDef GPIO_Speed;
+    GPIOMode_TypeDef GPIO_Mode;
+} GPIO_InitTypeDef;
+
+extern GPIO_TypeDef host_GPIOA, host_GPIOB, host_GPIOC, host_GPIOD;
+extern TIM_TypeDef host_TIM1;
+
+#define GPIOA               (&host_GPIOA)
+#define GPIOB               (&host_GPIOB)
+#define GPIOC               (&host_GPIOC)
+#define GPIOD               (&host_GPIOD)
+#define TIM1                (&host_TIM1)
+
+#define GPIO_Pin_0          ((uint16_t)0x0001)
+#define GPIO_Pin_1          ((uint16_t)0x0002)
+#define GPIO_Pin_2          ((uint16_t)0x0004)
+#define GPIO_Pin_3          ((uint16_t)0x0008)
+#define GPIO_Pin_4          ((uint16_t)0x0010)
+#define GPIO_Pin_5          ((uint16_t)0x0020)
+#define GPIO_Pin_6          ((uint16_t)0x0040)
+#define GPIO_Pin_7          ((uint16_t)0x0080)
+#define GPIO_Pin_8          ((uint16_t)0x0100)
+#define GPIO_Pin_9          ((uint16_t)0x0200)
+#define GPIO_Pin_10         ((uint16_t)0x0400)
+#define GPIO_Pin_11         ((uint16_t)0x0800)
+#define GPIO_Pin_12         ((uint16_t)0x1000)
+#define GPIO_Pin_13         ((uint16_t)0x2000)
+#define GPIO_Pin_14         ((uint16_t)0x4000)
+#define GPIO_Pin_15         ((uint16_t)0x8000)
+
+#define RCC_APB2Periph_GPIOA    ((uint32_t)0x00000004)
+#define RCC_APB2Periph_GPIOB    ((uint32_t)0x00000008)
+#define RCC_APB2Periph_GPIOC    ((uint32_t)0x00000010)
+#define RCC_APB2Periph_GPIOD    ((uint32_t)0x00000020)
+
+// no interrupts on the host
+#define __disable_irq()
+#define __enable_irq()
+#define __NVIC_PRIO_BITS    4
+#define __get_BASEPRI()     ((uint32_t) 0)
+#define __set_BASEPRI(x)    ((void) (x))
+
+void GPIO_WriteBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, BitAction BitVal);
+void GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_InitStruct);
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState);
+
+#define FLASH_FLAG_BSY      ((uint32_t)0x00000001)
+#define FLASH_FLAG_EOP      ((uint32_t)0x00000020)
+#define FLASH_FLAG_PGERR    ((uint32_t)0x00000004)
+#define FLASH_FLAG_WRPRTERR ((uint32_t)0x00000010)
+
+void FLASH_Unlock(void);
+void FLASH_Lock(void);
+void FLASH_ClearFlag(uint32_t FLASH_FLAG);
+
+#endif
@@ -0,0 +1,10 @@
+/**
+ * \file
+ * \brief   Host replacement for the standard peripheral library config.
+ */
+#ifndef STM32F10X_CONF_H_
+#define STM32F10X_CONF_H_
+
+#include "stm32f10x.h"
+
+#endif
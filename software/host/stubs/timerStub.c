@@ -0,0 +1,153 @@
+/**
+ * \file
+ * \brief   Host stub for the timer HAL.
+ *
+ * timer.ms is advanced by halStub_Tick() once per simulated tick,
+ * which also runs the SysTick function for the elapsed millisecond.
+ * Busy-waits return immediately, their requested duration is
+ * accumulated in halStub.waitus instead. The cycle wait of the display
+ * enable pulse applies the pending GPIO stores instead.
+ *
+ * The compare function (timer_SetupCompareFunction) is called at its
+ * scheduled times within the elapsed millisecond as well, its current
+ * time in us is available in halStub.compareTime. The step function
+ * (timer_SetupStepFunction) is called as often as its interval fits
+ * into the millisecond.
+ *
+ * halStub_ResetLoop() is the common test fixture: it puts the control
+ * loop back into its power-on state.
+ *
+ * The cycle counter is derived from the monotonic host clock and
+ * scaled to the 72MHz core clock of the firmware.
+ */
+#include <string.h>
+#include <time.h>
+#include "timer.h"
+#include "loadFunctions.h"
+#include "halStub.h"
+
+TIM_TypeDef host_TIM1;
+
+// SysTick function calls per millisecond
+static uint32_t sysTickCalls;
+// step function calls per millisecond
+static uint32_t stepCalls;
+
+void timer_Init(void) {
+    timer.ms = 0;
+}
+
+uint32_t timer_GetCycles(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    return ns * 72 / 1000;
+}
+
+uint32_t timer_GetTimeus(void) {
+    return timer.ms * 1000 + TIM1->CNT;
+}
+
+void timer_waitms(uint16_t ms) {
+    halStub.waitus += (uint32_t) ms * 1000;
+}
+
+void timer_waitus(uint16_t us) {
+    halStub.waitus += us;
+}
+
+void timer_waitCycles(uint32_t cycles) {
+    halStub_ApplyGPIO();
+}
+
+uint32_t timer_SetTimeout(uint32_t ms) {
+    return timer.ms + ms;
+}
+
+uint8_t timer_TimeoutElapsed(uint32_t timeout) {
+    if (timeout <= timer.ms)
+        return 1;
+    else
+        return 0;
+}
+
+uint8_t timer_SetupPeriodicFunction(uint8_t timerNumber, uint32_t period,
+        void (*callback)(), uint8_t priority) {
+    if (timerNumber < 2 || timerNumber > 4)
+        return 1;
+    timer.callbacks[timerNumber - 2] = callback;
+    return 0;
+}
+
+uint8_t timer_SetupSysTickFunction(uint32_t period, void (*callback)(),
+        uint8_t priority) {
+    timer.sysTickCallback = callback;
+    sysTickCalls = 72000 / period;
+    return 0;
+}
+
+uint8_t timer_SetupCompareFunction(uint32_t delay, uint32_t (*callback)(void),
+        uint8_t priority) {
+    if (priority > 15 || delay < 2)
+        return 1;
+    timer.compareCallback = callback;
+    halStub.compareTime = (uint64_t) timer.ms * 1000 + delay;
+    return 0;
+}
+
+void timer_StopCompareFunction(void) {
+    timer.compareCallback = NULL;
+}
+
+uint8_t timer_SetupStepFunction(uint16_t interval, uint8_t (*callback)(void)) {
+    timer.stepCallback = callback;
+    stepCalls = interval ? 1000 / interval : 1000;
+    return 0;
+}
+
+void halStub_Tick(void) {
+    uint32_t i;
+    if (timer.sysTickCallback) {
+        for (i = 0; i < sysTickCalls; i++)
+            timer.sysTickCallback();
+    }
+    while (timer.compareCallback
+            && halStub.compareTime < (uint64_t) (timer.ms + 1) * 1000) {
+        uint32_t us = timer.compareCallback();
+        if (!us) {
+            timer.compareCallback = NULL;
+            break;
+        }
+        halStub.compareTime += us;
+    }
+    for (i = 0; timer.stepCallback && i < stepCalls; i++) {
+        if (!timer.stepCallback())
+            timer.stepCallback = NULL;
+        halStub_ApplyGPIO();
+    }
+    timer.ms++;
+}
+
+void halStub_ResetLoop(void) {
+    memset(&load, 0, sizeof(load));
+    memset(&error, 0, sizeof(error));
+    memset(&events, 0, sizeof(events));
+    memset(&characteristic, 0, sizeof(characteristic));
+    memset(&halStub, 0, sizeof(halStub));
+    memset(&hal, 0, sizeof(hal));
+    memset(&reg, 0, sizeof(reg));
+    timer.ms = 0;
+    settings_Init();
+    cal_setDefaultCalibration();
+    cal.active = 0;
+    events_Init();
+    waveform_Init();
+    arb_Init();
+    acq_Init();
+    tele_Init();
+    dyn_Init();
+    slew_Reset();
+    load_Init();
+    stats_Reset();
+    halStub_SetSource(12000000, 100);
+}
@@ -0,0 +1,67 @@
+/**
+ * \file
+ * \brief   Host stubs for user interface and flash functions.
+ *
+ * The control loop links against the menu, front panel, uart and
+ * flash functions through the calibration, event and settings
+ * modules. None of them are used during the benchmark.
+ */
+#include "menu.h"
+#include "uart.h"
+#include "frontPanel.h"
+#include "flash.h"
+
+void FLASH_Unlock(void) {
+}
+
+void FLASH_Lock(void) {
+}
+
+void FLASH_ClearFlag(uint32_t FLASH_FLAG) {
+}
+
+uint8_t hal_FlashErasePage(uint32_t address) {
+    return 0;
+}
+
+uint8_t hal_FlashProgramWord(uint32_t address, uint32_t data) {
+    return 0;
+}
+
+uint8_t hal_FlashBusy(void) {
+    return 0;
+}
+
+void hal_frontPanelUpdate(void) {
+}
+
+void hal_setEncoderSensitivity(uint8_t n) {
+}
+
+uint32_t hal_getButton(void) {
+    return 0;
+}
+
+int32_t hal_getEncoderMovement(void) {
+    return 0;
+}
+
+void uart_Init(uint32_t baud) {
+}
+
+void uart_writeByte(uint8_t b) {
+}
+
+void uart_writeString(const char *s) {
+}
+
+uint8_t menu_getInputValue(uint32_t *value, char *descr, uint32_t min,
+        uint32_t max, const char *unit1e0, const char *unit1e3,
+        const char *unit1e6) {
+    return 0;
+}
+
+int8_t menu_ItemChooseDialog(const char *title, const char **items,
+        uint8_t nitems, uint8_t startitem) {
+    return -1;
+}
@@ -0,0 +1,108 @@
+/**
+ * \file
+ * \brief   Host test for the AVR telemetry scheduler.
+ *
+ * Runs load_update() against the HAL stub and checks that
+ * - no tick starts more than one AVR ADC conversion
+ * - every channel is converted at its configured rate
+ * - the hot path reads the cached temperatures
+ * - a supply rail that leaves its range during operation raises
+ *   LOAD_ERROR_SUPPLY_RAIL and turns the input off
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "loadFunctions.h"
+#include "halStub.h"
+
+#define TEST_TICKS              10000
+// ticks the rail may be out of range before the error must be reported
+// (filter settling plus error duration)
+#define TEST_RAIL_TICKS         1000
+
+static void test_Reset(void) {
+    halStub_ResetLoop();
+    load.mode = FUNCTION_CC;
+    load.current = 1000000;
+    load.powerOn = 1;
+}
+
+/**
+ * \brief Runs one tick and returns the AVR ADC conversions it started
+ */
+static uint32_t test_Tick(void) {
+    halStub_Tick();
+    halStub_ResetCounters();
+    load_update();
+    return halStub.avrADCReads;
+}
+
+static uint32_t test_Rates(void) {
+    uint32_t failures = 0;
+    uint32_t i, maxReads = 0;
+    uint32_t start[TELE_NUM_CHANNELS];
+    test_Reset();
+    tele_SetPeriod(TELE_P5V, 10);
+    for (i = 0; i < TELE_NUM_CHANNELS; i++)
+        start[i] = tele.ch[i].conversions;
+    for (i = 0; i < TEST_TICKS; i++) {
+        uint32_t reads = test_Tick();
+        if (reads > maxReads)
+            maxReads = reads;
+    }
+    printf("%-8s %8s %10s %10s %8s\n", "channel", "period", "expected",
+            "converted", "value");
+    for (i = 0; i < TELE_NUM_CHANNELS; i++) {
+        const char *names[TELE_NUM_CHANNELS] = { "temp1", "temp2", "+5V",
+                "+15V", "-15V" };
+        uint32_t expected = TEST_TICKS / tele.ch[i].period;
+        uint32_t converted = tele.ch[i].conversions - start[i];
+        // the round-robin may delay a conversion by a few ticks
+        uint8_t ok = converted + 5 >= expected && converted <= expected;
+        printf("%-8s %8u %10u %10u %8d %s\n", names[i], tele.ch[i].period,
+                expected, converted, tele_GetValue(i), ok ? "" : "FAIL");
+        if (!ok)
+            failures++;
+    }
+    printf("max. AVR ADC conversions per tick: %u\n", maxReads);
+    if (maxReads > 1)
+        failures++;
+    // the direct conversion the hot path used before
+    uint8_t temp = hal_ReadTemperature(HAL_TEMP1);
+    if (load.state.temp1 != temp || load.state.temp2 != temp
+            || !tele_RailsOK() || error.code) {
+        printf("temperatures %u/%u, error code 0x%x FAIL\n", load.state.temp1,
+                load.state.temp2, error.code);
+        failures++;
+    }
+    return failures;
+}
+
+static uint32_t test_RailFailure(void) {
+    uint32_t i;
+    test_Reset();
+    for (i = 0; i < 100; i++)
+        test_Tick();
+    // +15V drops to about 12V
+    halStub.avrADCOffset[HAL_AVR_ADC_P15V] = -150;
+    for (i = 0; i < TEST_RAIL_TICKS; i++) {
+        test_Tick();
+        if (error.code & (1UL << (LOAD_ERROR_SUPPLY_RAIL - 1)))
+            break;
+    }
+    // the input is switched off in the tick after the error
+    test_Tick();
+    uint8_t ok = i < TEST_RAIL_TICKS && !load.powerOn;
+    printf("+15V at %dmV: error after %u ticks, input %s %s\n",
+            tele_GetValue(TELE_P15V), i, load.powerOn ? "on" : "off",
+            ok ? "" : "FAIL");
+    return ok ? 0 : 1;
+}
+
+int main(void) {
+    uint32_t failures = 0;
+    failures += test_Rates();
+    failures += test_RailFailure();
+    printf("telemetryTest: %u failures\n", failures);
+    return failures ? 1 : 0;
+}